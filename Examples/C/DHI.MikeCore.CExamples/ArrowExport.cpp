@@ -0,0 +1,612 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "ArrowExport.h"
+
+#include <CppUnitTestLogger.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+typedef std::vector<std::pair<std::string, std::string>> KeyValues;
+
+/**
+ * Minimal flatbuffer builder, as needed for the Arrow IPC metadata.
+ *
+ * Objects are first collected as nodes, and then serialized front to back:
+ * Each table is written with its vtable in front of it, and objects referenced
+ * from a table or vector are written after it, such that all offsets point
+ * forward as required by the flatbuffer format.
+ */
+struct FbBuilder
+{
+  struct Field
+  {
+    int      id;        ///< Field id, order in flatbuffer schema, union fields count as two
+    int      size;      ///< Size of scalar, 4 for references
+    uint64_t value;     ///< Scalar value
+    int      ref;       ///< Referenced node, -1 for scalars
+  };
+  struct Node
+  {
+    enum Kind { Table, String, OffsetVector, StructVector } kind = Table;
+    std::vector<Field> fields;  ///< Fields of table
+    std::string        bytes;   ///< Content of string or struct vector
+    uint32_t           count = 0; ///< Number of structs in struct vector
+    std::vector<int>   refs;    ///< Nodes referenced by offset vector
+  };
+  std::vector<Node> nodes;
+
+  int AddNode(Node::Kind kind)
+  {
+    nodes.push_back(Node());
+    nodes.back().kind = kind;
+    return (int)nodes.size() - 1;
+  }
+  int Table() { return AddNode(Node::Table); }
+  void Scalar(int table, int id, int size, uint64_t value) { nodes[table].fields.push_back({ id, size, value, -1 }); }
+  void Ref(int table, int id, int ref) { nodes[table].fields.push_back({ id, 4, 0, ref }); }
+  int String(const std::string& s)
+  {
+    int n = AddNode(Node::String);
+    nodes[n].bytes = s;
+    return n;
+  }
+  int Vector(const std::vector<int>& refs)
+  {
+    int n = AddNode(Node::OffsetVector);
+    nodes[n].refs = refs;
+    return n;
+  }
+  int StructVector(const void* data, size_t struct_size, uint32_t count)
+  {
+    int n = AddNode(Node::StructVector);
+    if (count > 0)
+      nodes[n].bytes.assign((const char*)data, struct_size * count);
+    nodes[n].count = count;
+    return n;
+  }
+
+  /** Serialize with the given root table. The size of the result is a multiple of 8 */
+  std::vector<uint8_t> Finish(int root)
+  {
+    std::vector<uint8_t> buf(4, 0);
+    uint32_t root_pos = (uint32_t)Write(buf, root);
+    memcpy(&buf[0], &root_pos, 4);
+    Pad(buf, 8);
+    return buf;
+  }
+
+private:
+  static void Pad(std::vector<uint8_t>& buf, size_t align)
+  {
+    while (buf.size() % align)
+      buf.push_back(0);
+  }
+  static void Append(std::vector<uint8_t>& buf, const void* data, size_t size)
+  {
+    buf.insert(buf.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+  }
+  static void PutOffset(std::vector<uint8_t>& buf, size_t field_pos, size_t target_pos)
+  {
+    uint32_t offset = (uint32_t)(target_pos - field_pos);
+    memcpy(&buf[field_pos], &offset, 4);
+  }
+
+  size_t Write(std::vector<uint8_t>& buf, int n)
+  {
+    const Node& node = nodes[n];
+    size_t pos;
+    switch (node.kind)
+    {
+    case Node::String:
+    {
+      Pad(buf, 4);
+      pos = buf.size();
+      uint32_t len = (uint32_t)node.bytes.size();
+      Append(buf, &len, 4);
+      Append(buf, node.bytes.data(), len);
+      buf.push_back(0);
+      return pos;
+    }
+    case Node::StructVector:
+    {
+      // Structs are 8 byte aligned, the length precedes them
+      Pad(buf, 4);
+      if ((buf.size() + 4) % 8)
+        buf.insert(buf.end(), 4, 0);
+      pos = buf.size();
+      Append(buf, &node.count, 4);
+      Append(buf, node.bytes.data(), node.bytes.size());
+      return pos;
+    }
+    case Node::OffsetVector:
+    {
+      Pad(buf, 4);
+      pos = buf.size();
+      uint32_t count = (uint32_t)node.refs.size();
+      Append(buf, &count, 4);
+      buf.insert(buf.end(), 4 * count, 0);
+      for (uint32_t i = 0; i < count; i++)
+        PutOffset(buf, pos + 4 + 4 * i, Write(buf, node.refs[i]));
+      return pos;
+    }
+    default:
+      break;
+    }
+
+    // Table: Lay out fields after the vtable offset, largest first, for alignment
+    std::vector<Field> fields = node.fields;
+    for (size_t i = 1; i < fields.size(); i++)
+      for (size_t j = i; j > 0 && fields[j].size > fields[j - 1].size; j--)
+        std::swap(fields[j], fields[j - 1]);
+    int num_ids = 0;
+    std::vector<uint16_t> field_offsets(fields.size());
+    uint16_t table_size = 4;
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+      table_size = (uint16_t)((table_size + fields[i].size - 1) / fields[i].size * fields[i].size);
+      field_offsets[i] = table_size;
+      table_size += (uint16_t)fields[i].size;
+      if (fields[i].id >= num_ids)
+        num_ids = fields[i].id + 1;
+    }
+
+    // vtable: size of vtable, size of table, offset of each field, 0 if not present
+    std::vector<uint16_t> vtable(2 + num_ids, 0);
+    vtable[0] = (uint16_t)(2 * vtable.size());
+    vtable[1] = table_size;
+    for (size_t i = 0; i < fields.size(); i++)
+      vtable[2 + fields[i].id] = field_offsets[i];
+    Pad(buf, 2);
+    size_t vtable_pos = buf.size();
+    Append(buf, vtable.data(), 2 * vtable.size());
+
+    Pad(buf, 8);
+    pos = buf.size();
+    buf.insert(buf.end(), table_size, 0);
+    int32_t vtable_offset = (int32_t)(pos - vtable_pos);
+    memcpy(&buf[pos], &vtable_offset, 4);
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+      if (fields[i].ref < 0)
+        memcpy(&buf[pos + field_offsets[i]], &fields[i].value, fields[i].size);
+    }
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+      if (fields[i].ref >= 0)
+        PutOffset(buf, pos + field_offsets[i], Write(buf, fields[i].ref));
+    }
+    return pos;
+  }
+};
+
+
+/*
+ * Arrow IPC format constants, see Schema.fbs, Message.fbs and File.fbs of the Arrow format
+ */
+static const int ArrowMetadataV5          = 4;
+static const int ArrowMessageSchema       = 1;
+static const int ArrowMessageRecordBatch  = 3;
+static const int ArrowTypeInt             = 2;
+static const int ArrowTypeFloatingPoint   = 3;
+static const int ArrowTypeTimestamp       = 10;
+static const int ArrowPrecisionSingle     = 1;
+static const int ArrowPrecisionDouble     = 2;
+static const int ArrowTimeUnitMillisecond = 1;
+
+/** Column of exported Arrow file */
+struct ArrowColumn
+{
+  std::string name;
+  int         type;           ///< ArrowTypeInt, ArrowTypeFloatingPoint or ArrowTypeTimestamp
+  int         byte_width;     ///< 4 or 8
+  KeyValues   metadata;
+};
+
+/** Arrow Block struct of file footer */
+struct ArrowBlock
+{
+  int64_t offset;
+  int32_t metadata_length;
+  int32_t padding;
+  int64_t body_length;
+};
+
+/** Arrow FieldNode and Buffer structs of record batch */
+struct ArrowPair
+{
+  int64_t first;
+  int64_t second;
+};
+
+static int FbKeyValues(FbBuilder& fb, const KeyValues& kvs)
+{
+  std::vector<int> refs;
+  for (size_t i = 0; i < kvs.size(); i++)
+  {
+    int kv = fb.Table();
+    fb.Ref(kv, 0, fb.String(kvs[i].first));
+    fb.Ref(kv, 1, fb.String(kvs[i].second));
+    refs.push_back(kv);
+  }
+  return fb.Vector(refs);
+}
+
+static int FbSchema(FbBuilder& fb, const std::vector<ArrowColumn>& columns, const KeyValues& metadata)
+{
+  std::vector<int> fields;
+  for (size_t i = 0; i < columns.size(); i++)
+  {
+    const ArrowColumn& col = columns[i];
+    int type = fb.Table();
+    if (col.type == ArrowTypeInt)
+    {
+      fb.Scalar(type, 0, 4, col.byte_width * 8);   // bitWidth
+      fb.Scalar(type, 1, 1, 1);                    // is_signed
+    }
+    else if (col.type == ArrowTypeFloatingPoint)
+      fb.Scalar(type, 0, 2, col.byte_width == 4 ? ArrowPrecisionSingle : ArrowPrecisionDouble);
+    else
+      fb.Scalar(type, 0, 2, ArrowTimeUnitMillisecond);
+
+    int field = fb.Table();
+    fb.Ref(field, 0, fb.String(col.name));         // name
+    fb.Scalar(field, 1, 1, 1);                     // nullable
+    fb.Scalar(field, 2, 1, col.type);              // type_type
+    fb.Ref(field, 3, type);                        // type
+    fb.Ref(field, 5, fb.Vector(std::vector<int>())); // children
+    if (!col.metadata.empty())
+      fb.Ref(field, 6, FbKeyValues(fb, col.metadata));
+    fields.push_back(field);
+  }
+  int schema = fb.Table();
+  fb.Scalar(schema, 0, 2, 0);                      // endianness, little
+  fb.Ref(schema, 1, fb.Vector(fields));
+  fb.Ref(schema, 2, FbKeyValues(fb, metadata));
+  return schema;
+}
+
+/** Build Message table around header */
+static std::vector<uint8_t> FbMessage(FbBuilder& fb, int header_type, int header, int64_t body_length)
+{
+  int message = fb.Table();
+  fb.Scalar(message, 0, 2, ArrowMetadataV5);       // version
+  fb.Scalar(message, 1, 1, header_type);           // header_type
+  fb.Ref(message, 2, header);                      // header
+  fb.Scalar(message, 3, 8, body_length);           // bodyLength
+  return fb.Finish(message);
+}
+
+/** Writes to file, keeping track of file position and errors */
+struct ArrowFileWriter
+{
+  FILE*   fp;
+  int64_t pos = 0;
+  bool    ok = true;
+
+  void Write(const void* data, size_t size)
+  {
+    if (size > 0 && ok)
+      ok = fwrite(data, 1, size, fp) == size;
+    pos += size;
+  }
+  void Pad8()
+  {
+    static const char zeros[8] = { 0 };
+    Write(zeros, (8 - pos % 8) % 8);
+  }
+  /** Write encapsulated message, returns metadata length including prefix */
+  int32_t WriteMessage(const std::vector<uint8_t>& metadata)
+  {
+    int32_t prefix[2] = { -1, (int32_t)metadata.size() };
+    Write(prefix, 8);
+    Write(metadata.data(), metadata.size());
+    return (int32_t)(8 + metadata.size());
+  }
+};
+
+static std::string ToString(double v)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.17g", v);
+  return buf;
+}
+
+/** Spatial axis of item, as "type dimensions origin spacing" */
+static std::string DfsItemAxisString(LPITEM item)
+{
+  LONG    eum_unit;
+  LPCTSTR eum_unit_str;
+  LONG    j, k, l;
+  float   x0, y0, z0, dx, dy, dz;
+  char    buf[256];
+  SpaceAxisType axis_type = dfsGetItemAxisType(item);
+  switch (axis_type)
+  {
+  case F_EQ_AXIS_D0:
+    return "EqD0";
+  case F_EQ_AXIS_D1:
+    dfsGetItemAxisEqD1(item, &eum_unit, &eum_unit_str, &j, &x0, &dx);
+    snprintf(buf, sizeof(buf), "EqD1 %ld %g %g", (long)j, x0, dx);
+    return buf;
+  case F_EQ_AXIS_D2:
+    dfsGetItemAxisEqD2(item, &eum_unit, &eum_unit_str, &j, &k, &x0, &y0, &dx, &dy);
+    snprintf(buf, sizeof(buf), "EqD2 %ld %ld %g %g %g %g", (long)j, (long)k, x0, y0, dx, dy);
+    return buf;
+  case F_EQ_AXIS_D3:
+    dfsGetItemAxisEqD3(item, &eum_unit, &eum_unit_str, &j, &k, &l, &x0, &y0, &z0, &dx, &dy, &dz);
+    snprintf(buf, sizeof(buf), "EqD3 %ld %ld %ld %g %g %g %g %g %g", (long)j, (long)k, (long)l, x0, y0, z0, dx, dy, dz);
+    return buf;
+  default:
+    snprintf(buf, sizeof(buf), "%d", (int)axis_type);
+    return buf;
+  }
+}
+
+/** Header information of dfs file as schema metadata */
+static KeyValues DfsHeaderMetadata(LPHEAD pdfs)
+{
+  KeyValues kvs;
+  static const char* taxis_names[] = { "Undefined", "TimeEquidistant", "TimeNonEquidistant", "CalendarEquidistant", "CalendarNonEquidistant" };
+  TimeAxisType taxis_type;
+  LPCTSTR start_date = nullptr, start_time = nullptr;
+  double tstart = 0, tstep = 0, tspan = 0;
+  long num_timesteps, neum_unit, index;
+  GetDfsTimeAxis(pdfs, &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  if (dfsGetFileTitle(pdfs))
+    kvs.push_back({ "dfs.file_title", dfsGetFileTitle(pdfs) });
+  kvs.push_back({ "dfs.time_axis", taxis_names[taxis_type <= F_CAL_NEQ_AXIS ? taxis_type : 0] });
+  if (taxis_type == F_CAL_EQ_AXIS || taxis_type == F_CAL_NEQ_AXIS)
+    kvs.push_back({ "dfs.start_date_time", std::string(start_date) + " " + start_time });
+  kvs.push_back({ "dfs.time_start", ToString(tstart) });
+  kvs.push_back({ "dfs.time_step", ToString(tstep) });
+  kvs.push_back({ "dfs.time_unit", ToString(neum_unit) });
+  kvs.push_back({ "dfs.num_timesteps", ToString(num_timesteps) });
+
+  LPCTSTR projection_id;
+  double lon0, lat0, orientation;
+  if (dfsGetGeoInfoType(pdfs) == F_UTM_PROJECTION && GetDfsGeoInfo(pdfs, &projection_id, &lon0, &lat0, &orientation) == F_NO_ERROR)
+  {
+    kvs.push_back({ "dfs.projection", projection_id });
+    kvs.push_back({ "dfs.lon0", ToString(lon0) });
+    kvs.push_back({ "dfs.lat0", ToString(lat0) });
+    kvs.push_back({ "dfs.orientation", ToString(orientation) });
+  }
+
+  // Custom blocks, e.g. "MIKE_FM" with mesh sizes of dfsu files
+  LPBLOCK customblock_ptr;
+  long rc = dfsGetCustomBlockRef(pdfs, &customblock_ptr);
+  while (rc == F_NO_ERROR && customblock_ptr)
+  {
+    SimpleType csdata_type;
+    LPCTSTR name;
+    LONG size;
+    void* data;
+    rc = dfsGetCustomBlock(customblock_ptr, &csdata_type, &name, &size, &data, &customblock_ptr);
+    if (rc != F_NO_ERROR)
+      break;
+    std::string values;
+    for (int i = 0; i < size; i++)
+    {
+      if (i > 0)
+        values += " ";
+      if (csdata_type == UFS_INT)
+        values += ToString(((int*)data)[i]);
+      else if (csdata_type == UFS_FLOAT)
+        values += ToString(((float*)data)[i]);
+      else if (csdata_type == UFS_DOUBLE)
+        values += ToString(((double*)data)[i]);
+    }
+    kvs.push_back({ std::string("dfs.custom_block.") + name, values });
+  }
+  return kvs;
+}
+
+/** Set validity bitmap from delete values, returns number of nulls */
+template <typename T>
+static int64_t ArrowValidity(const T* data, int64_t n, T delete_value, std::vector<uint8_t>& validity)
+{
+  validity.assign((n + 7) / 8, 0);
+  int64_t null_count = 0;
+  for (int64_t i = 0; i < n; i++)
+  {
+    int valid = data[i] != delete_value;
+    validity[i >> 3] |= (uint8_t)(valid << (i & 7));
+    null_count += 1 - valid;
+  }
+  return null_count;
+}
+
+long ExportDfsToArrow(LPCTSTR dfsFilename, LPCTSTR arrowFilename)
+{
+  LPHEAD pdfs;
+  LPFILE fpdfs;
+  long rc = dfsFileRead(dfsFilename, &pdfs, &fpdfs);
+  CheckRc(rc, "Error opening file");
+
+  long num_items = dfsGetNoOfItems(pdfs);
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  TimeAxisType taxis_type = GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+  bool calendar = taxis_type == F_CAL_EQ_AXIS || taxis_type == F_CAL_NEQ_AXIS;
+  bool equidistant = taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS;
+  TimeAxisType t;
+  LPCTSTR start_date, start_time;
+  double tstart = 0, tstep, tspan;
+  long n, neum_unit, index;
+  GetDfsTimeAxis(pdfs, &t, &n, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+  DeleteValues delVals;
+  GetDfsDeleteVals(pdfs, &delVals);
+
+  // Columns: time, element and one column for each item
+  std::vector<ArrowColumn> columns;
+  columns.push_back({ "time", calendar ? ArrowTypeTimestamp : ArrowTypeFloatingPoint, 8, KeyValues() });
+  columns.push_back({ "element", ArrowTypeInt, 4, KeyValues() });
+  std::vector<SimpleType> item_datatypes(num_items);
+  int64_t num_elmts = 0;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LONG          item_type;
+    LPCTSTR       item_type_str;
+    LPCTSTR       item_name;
+    LONG          item_unit;
+    LPCTSTR       item_unit_str;
+    SimpleType    item_datatype;
+    LPITEM item = dfsItemD(pdfs, i_item);
+    rc = dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+    CheckRc(rc, "Error reading dynamic item info");
+    item_datatypes[i_item - 1] = item_datatype;
+    if (i_item == 1)
+      num_elmts = dfsGetItemElements(item);
+    if (dfsGetItemElements(item) != num_elmts)
+    {
+      LOG("All items must have the same number of elements: %s", dfsFilename);
+      rc = -1;
+    }
+    if (item_datatype != UFS_FLOAT && item_datatype != UFS_DOUBLE && item_datatype != UFS_INT)
+    {
+      LOG("Item data type not supported, item %d: %s", i_item, dfsFilename);
+      rc = -1;
+    }
+    KeyValues metadata;
+    metadata.push_back({ "dfs.eum_type", item_type_str });
+    metadata.push_back({ "dfs.eum_type_id", ToString(item_type) });
+    metadata.push_back({ "dfs.eum_unit", item_unit_str });
+    metadata.push_back({ "dfs.eum_unit_id", ToString(item_unit) });
+    metadata.push_back({ "dfs.axis", DfsItemAxisString(item) });
+    columns.push_back({ item_name, item_datatype == UFS_INT ? ArrowTypeInt : ArrowTypeFloatingPoint,
+                        item_datatype == UFS_DOUBLE ? 8 : 4, metadata });
+  }
+
+  FILE* fp = nullptr;
+  if (rc == F_NO_ERROR && !(fp = fopen(arrowFilename, "wb")))
+  {
+    LOG("Could not open file for writing: %s", arrowFilename);
+    rc = -1;
+  }
+  if (rc != F_NO_ERROR)
+  {
+    dfsFileClose(pdfs, &fpdfs);
+    dfsHeaderDestroy(&pdfs);
+    return -1;
+  }
+
+  ArrowFileWriter writer;
+  writer.fp = fp;
+  writer.Write("ARROW1\0\0", 8);
+  KeyValues metadata = DfsHeaderMetadata(pdfs);
+  {
+    FbBuilder fb;
+    writer.WriteMessage(FbMessage(fb, ArrowMessageSchema, FbSchema(fb, columns, metadata), 0));
+  }
+
+  // Buffers for one time step. Item data is read into 8 byte aligned buffers, and written as is.
+  std::vector<double>  time_data(num_elmts);
+  std::vector<int64_t> timestamp_data(num_elmts);
+  std::vector<int32_t> element_data(num_elmts);
+  for (int64_t i = 0; i < num_elmts; i++)
+    element_data[i] = (int32_t)i;
+  std::vector<std::vector<double>>  item_data(num_items);
+  std::vector<std::vector<uint8_t>> validity(num_items);
+  std::vector<int64_t> null_counts(num_items);
+  for (int i = 0; i < num_items; i++)
+    item_data[i].resize((num_elmts * columns[2 + i].byte_width + 7) / 8);
+
+  std::vector<ArrowBlock> blocks;
+  rc = dfsFindTimeStep(pdfs, fpdfs, 0);
+  CheckRc(rc, "Error finding time step");
+  for (long i_tstep = 0; i_tstep < num_timesteps && writer.ok; i_tstep++)
+  {
+    double time = 0;
+    for (int i_item = 1; i_item <= num_items; i_item++)
+    {
+      rc = dfsReadItemTimeStep(pdfs, fpdfs, &time, item_data[i_item - 1].data());
+      CheckRc(rc, "Error reading dynamic item data");
+      void* data = item_data[i_item - 1].data();
+      if (item_datatypes[i_item - 1] == UFS_FLOAT)
+        null_counts[i_item - 1] = ArrowValidity((float*)data, num_elmts, delVals.deleteF, validity[i_item - 1]);
+      else if (item_datatypes[i_item - 1] == UFS_DOUBLE)
+        null_counts[i_item - 1] = ArrowValidity((double*)data, num_elmts, delVals.deleteD, validity[i_item - 1]);
+      else
+        null_counts[i_item - 1] = ArrowValidity((int*)data, num_elmts, delVals.deleteInt, validity[i_item - 1]);
+    }
+    // Equidistant axes return the time step index, non-equidistant the time from the start of the file
+    double time_sec = equidistant ? start_sec + i_tstep * tstep_sec : start_sec + (time - tstart) * unit_sec;
+    const void* time_ptr;
+    if (calendar)
+    {
+      for (int64_t i = 0; i < num_elmts; i++)
+        timestamp_data[i] = (int64_t)(time_sec * 1000.0 + (time_sec >= 0 ? 0.5 : -0.5));
+      time_ptr = timestamp_data.data();
+    }
+    else
+    {
+      for (int64_t i = 0; i < num_elmts; i++)
+        time_data[i] = time_sec;
+      time_ptr = time_data.data();
+    }
+
+    // Body buffers: validity and values of each column, each padded to 8 bytes
+    std::vector<ArrowPair>   nodes;
+    std::vector<ArrowPair>   buffers;
+    std::vector<const void*> buffer_data;
+    int64_t body_length = 0;
+    for (size_t c = 0; c < columns.size(); c++)
+    {
+      int64_t null_count = c < 2 ? 0 : null_counts[c - 2];
+      nodes.push_back({ num_elmts, null_count });
+      int64_t validity_length = null_count > 0 ? (num_elmts + 7) / 8 : 0;
+      buffers.push_back({ body_length, validity_length });
+      buffer_data.push_back(null_count > 0 ? validity[c - 2].data() : nullptr);
+      body_length += (validity_length + 7) / 8 * 8;
+      const void* values = c == 0 ? time_ptr : c == 1 ? (const void*)element_data.data() : (const void*)item_data[c - 2].data();
+      buffers.push_back({ body_length, num_elmts * columns[c].byte_width });
+      buffer_data.push_back(values);
+      body_length += (num_elmts * columns[c].byte_width + 7) / 8 * 8;
+    }
+
+    FbBuilder fb;
+    int batch = fb.Table();
+    fb.Scalar(batch, 0, 8, num_elmts);             // length
+    fb.Ref(batch, 1, fb.StructVector(nodes.data(), sizeof(ArrowPair), (uint32_t)nodes.size()));
+    fb.Ref(batch, 2, fb.StructVector(buffers.data(), sizeof(ArrowPair), (uint32_t)buffers.size()));
+    ArrowBlock block = { writer.pos, 0, 0, body_length };
+    block.metadata_length = writer.WriteMessage(FbMessage(fb, ArrowMessageRecordBatch, batch, body_length));
+    for (size_t b = 0; b < buffers.size(); b++)
+    {
+      writer.Write(buffer_data[b], (size_t)buffers[b].second);
+      writer.Pad8();
+    }
+    blocks.push_back(block);
+  }
+
+  // End of stream marker and footer
+  int32_t eos[2] = { -1, 0 };
+  writer.Write(eos, 8);
+  FbBuilder fb;
+  int footer = fb.Table();
+  fb.Scalar(footer, 0, 2, ArrowMetadataV5);        // version
+  fb.Ref(footer, 1, FbSchema(fb, columns, metadata));
+  fb.Ref(footer, 2, fb.StructVector(nullptr, sizeof(ArrowBlock), 0));
+  fb.Ref(footer, 3, fb.StructVector(blocks.data(), sizeof(ArrowBlock), (uint32_t)blocks.size()));
+  std::vector<uint8_t> footer_data = fb.Finish(footer);
+  int32_t footer_length = (int32_t)footer_data.size();
+  writer.Write(footer_data.data(), footer_data.size());
+  writer.Write(&footer_length, 4);
+  writer.Write("ARROW1", 6);
+
+  bool ok = writer.ok;
+  if (fclose(fp) != 0)
+    ok = false;
+  if (!ok)
+    LOG("Error writing file: %s", arrowFilename);
+  rc = dfsFileClose(pdfs, &fpdfs);
+  rc = dfsHeaderDestroy(&pdfs);
+  return ok ? F_NO_ERROR : -1;
+}
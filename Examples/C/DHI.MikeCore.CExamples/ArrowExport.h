@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+/**
+ * Export the dynamic items of a dfs file to an Arrow IPC file (Feather v2),
+ * readable by e.g. pyarrow.feather.read_table, without any Arrow library dependency.
+ *
+ * The file is written as one record batch per time step, such that memory usage is
+ * bounded by one time step of all items. Columns are:
+ *  - "time": Timestamp in milliseconds for calendar axes, otherwise seconds since start, as float64.
+ *  - "element": Zero based element index within the item, int32.
+ *  - One column per dynamic item: float32, float64 or int32, as the item data type.
+ *    Delete values are written as nulls, in the validity bitmap of the column.
+ *
+ * Item buffers are written to file directly as read from the dfs file.
+ * Time axis, projection and custom blocks (e.g. dfsu mesh sizes) are stored as schema
+ * metadata, EUM type, unit and spatial axis of each item as field metadata.
+ *
+ * All items must have the same number of elements.
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long ExportDfsToArrow(LPCTSTR dfsFilename, LPCTSTR arrowFilename);
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "ArrowExport.h"
+#include <CppUnitTest.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(ArrowExport_tests)
+  {
+  public:
+
+    /// Export OresundHD.dfs2 to Arrow, and check record batches against the dfs file
+    TEST_METHOD(ExportDfs2ToArrowTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_C.arrow");
+
+      long rc = ExportDfsToArrow(inputFullPath, outputFullPath);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+
+      FILE* fp = fopen(outputFullPath, "rb");
+      Assert::IsNotNull(fp);
+      std::vector<uint8_t> file;
+      uint8_t buf[65536];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        file.insert(file.end(), buf, buf + n);
+      fclose(fp);
+      Assert::AreEqual(0, memcmp(&file[0], "ARROW1", 6));
+      Assert::AreEqual(0, memcmp(&file[file.size() - 6], "ARROW1", 6));
+
+      // Footer: one record batch per time step
+      int32_t footer_length = Get<int32_t>(&file[file.size() - 10]);
+      const uint8_t* footer = FbRoot(&file[file.size() - 10 - footer_length]);
+      const uint8_t* blocks = FbRef(FbField(footer, 3));
+      Assert::AreEqual((uint32_t)13, Get<uint32_t>(blocks));
+
+      // Record batch of time step 2
+      const uint8_t* block = blocks + 4 + 2 * 24;
+      int64_t offset = Get<int64_t>(block);
+      int32_t metadata_length = Get<int32_t>(block + 8);
+      Assert::AreEqual(-1, Get<int32_t>(&file[offset]));
+      const uint8_t* message = FbRoot(&file[offset + 8]);
+      Assert::AreEqual((uint8_t)3, *FbField(message, 1));
+      const uint8_t* batch = FbRef(FbField(message, 2));
+      Assert::AreEqual((int64_t)71 * 91, Get<int64_t>(FbField(batch, 0)));
+
+      // Columns are time, element and the 3 items. Buffers are validity and values of each column.
+      const uint8_t* nodes = FbRef(FbField(batch, 1));
+      const uint8_t* buffers = FbRef(FbField(batch, 2));
+      Assert::AreEqual((uint32_t)5, Get<uint32_t>(nodes));
+      Assert::AreEqual((uint32_t)10, Get<uint32_t>(buffers));
+      int64_t null_count = Get<int64_t>(nodes + 4 + 2 * 16 + 8);
+      int64_t values_offset = Get<int64_t>(buffers + 4 + 5 * 16);
+      const uint8_t* body = &file[offset + metadata_length];
+      const float* values = (const float*)(body + values_offset);
+      Assert::AreEqual(11.3634329f, values[71 * 4 + 3]);
+
+      // Values and nulls must match the dfs file
+      LPHEAD pdfs;
+      LPFILE fpdfs;
+      rc = dfsFileRead(inputFullPath, &pdfs, &fpdfs);
+      CheckRc(rc, "Error opening file");
+      std::vector<float> data(71 * 91);
+      double time;
+      rc = dfsFindItemDynamic(pdfs, fpdfs, 2, 1);
+      CheckRc(rc, "Error finding item-timestep");
+      rc = dfsReadItemTimeStep(pdfs, fpdfs, &time, data.data());
+      CheckRc(rc, "Error reading item-timestep");
+      float delete_value = dfsGetDeleteValFloat(pdfs);
+      int64_t expected_null_count = 0;
+      for (size_t i = 0; i < data.size(); i++)
+        if (data[i] == delete_value)
+          expected_null_count++;
+      Assert::AreEqual(expected_null_count, null_count);
+      Assert::AreEqual(0, memcmp(values, data.data(), data.size() * sizeof(float)));
+      rc = dfsFileClose(pdfs, &fpdfs);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+    template <typename T>
+    static T Get(const uint8_t* p)
+    {
+      T v;
+      memcpy(&v, p, sizeof(T));
+      return v;
+    }
+
+    /// Root table of flatbuffer
+    static const uint8_t* FbRoot(const uint8_t* fb)
+    {
+      return fb + Get<uint32_t>(fb);
+    }
+
+    /// Field of flatbuffer table, NULL if not present
+    static const uint8_t* FbField(const uint8_t* table, int id)
+    {
+      const uint8_t* vtable = table - Get<int32_t>(table);
+      if (4 + 2 * id >= Get<uint16_t>(vtable))
+        return nullptr;
+      uint16_t offset = Get<uint16_t>(vtable + 4 + 2 * id);
+      return offset ? table + offset : nullptr;
+    }
+
+    /// Object referenced by offset field
+    static const uint8_t* FbRef(const uint8_t* field)
+    {
+      return field + Get<uint32_t>(field);
+    }
+
+  };
+}
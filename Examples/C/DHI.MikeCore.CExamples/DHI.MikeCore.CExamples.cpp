@@ -1,9 +1,26 @@
 #include "pch.h"
 #include <iostream>
+#include <vector>
 #include "eum.h"
 #include "dfsio.h"
 #include "ExampleDfs.h"
 #include "ExampleDfsu.h"
+#include "Util.h"
+#include "DfsDiff.h"
+#include "DfsMerge.h"
+#include "DfsConcat.h"
+#include "MeshExport.h"
+#include "ArrowExport.h"
+#include "DfsArchive.h"
+#include "DfsTiles.h"
+#include "DfsTranspose.h"
+#include "DfsPyramid.h"
+#include "DfsTimeSeries.h"
+#include "DfsValueType.h"
+#include "DfsUnits.h"
+#include "DfsServer.h"
+#include "DfsSplit.h"
+#include "MeshRenumber.h"
 
 
 int LastIndexOf(LPCTSTR s1, char c)
@@ -36,6 +53,249 @@ int main(unsigned int argc, _TCHAR  **argv)
     exit(-1);
   }
 
+  // Difference between two dfs files: Write diff file, or report only
+  if (_strcmpi(argv[1], "-dfsDiff") == 0 || _strcmpi(argv[1], "-dfsCompare") == 0)
+  {
+    bool compare = _strcmpi(argv[1], "-dfsCompare") == 0;
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsDiff file1 file2 [diffFile]\n", argv[0]);
+      printf("        %s -dfsCompare file1 file2 [absTol] [relTol]\n", argv[0]);
+      exit(-1);
+    }
+    DfsDiffOptions options;
+    LPCTSTR filediff = NULL;
+    if (compare)
+    {
+      // Compare only, stop at first difference
+      options.summary_only = true;
+      if (argc > 4) options.abs_tol = atof(argv[4]);
+      if (argc > 5) options.rel_tol = atof(argv[5]);
+    }
+    else if (argc > 4)
+      filediff = argv[4];
+    DfsDiffResult result;
+    if (DfsDiff(argv[2], argv[3], filediff, options, &result) != F_NO_ERROR)
+      return -1;
+    LogDfsDiffResult(argv[2], result);
+    printf("%s\n", result.equal ? "Files are equal" : "Files differ");
+    return result.equal ? 0 : -5;
+  }
+
+  // Merge items of two or more dfs files
+  if (_strcmpi(argv[1], "-dfsMerge") == 0)
+  {
+    if (argc < 5)
+    {
+      printf("Usage:  %s -dfsMerge outMergeFile file1 file2 [file3] ...\n", argv[0]);
+      exit(-1);
+    }
+    MergeDfsFileItems(argv[2], (LPCTSTR*)&argv[3], argc - 3);
+    return 0;
+  }
+
+  // Concatenate two or more dfs files in time
+  if (_strcmpi(argv[1], "-dfsConcat") == 0)
+  {
+    if (argc < 5)
+    {
+      printf("Usage:  %s -dfsConcat outFile file1 file2 [file3] ...\n", argv[0]);
+      exit(-1);
+    }
+    return DfsConcatFiles(argv[2], (LPCTSTR*)&argv[3], argc - 3) == F_NO_ERROR ? 0 : -1;
+  }
+
+  // Export mesh of dfsu file, optionally with element values
+  if (_strcmpi(argv[1], "-dfsuExport") == 0)
+  {
+    MeshExportFormat format = MeshExportGnuplot;
+    if (argc >= 5 && _strcmpi(argv[4], "csv") == 0)
+      format = MeshExportCsv;
+    else if (argc >= 5 && _strcmpi(argv[4], "wkt") == 0)
+      format = MeshExportWkt;
+    else if (argc >= 5 && _strcmpi(argv[4], "bin") == 0)
+      format = MeshExportBinary;
+    else if (argc < 5 || _strcmpi(argv[4], "gnuplot") != 0)
+    {
+      printf("Usage:  %s -dfsuExport dfsuFile outFile gnuplot|csv|wkt|bin [itemNumber [timestep]]\n", argv[0]);
+      exit(-1);
+    }
+    int item_number = argc >= 6 ? atoi(argv[5]) : 0;
+    long tstep = argc >= 7 ? atol(argv[6]) : 0;
+    return ExportDfsuMesh(argv[2], argv[3], format, item_number, tstep) == F_NO_ERROR ? 0 : -1;
+  }
+
+  // Export dfs file to Arrow IPC file
+  if (_strcmpi(argv[1], "-dfsArrow") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsArrow dfsFile arrowFile\n", argv[0]);
+      exit(-1);
+    }
+    return ExportDfsToArrow(argv[2], argv[3]) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsArchive") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsArchive dfsFile archiveFile\n", argv[0]);
+      exit(-1);
+    }
+    return DfsArchiveWrite(argv[2], argv[3]) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsRestore") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsRestore archiveFile dfsFile\n", argv[0]);
+      exit(-1);
+    }
+    return DfsArchiveRestore(argv[2], argv[3]) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsTiles") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsTiles dfsFile tileFile [tileJ tileK [tileL]]\n", argv[0]);
+      exit(-1);
+    }
+    int tile_j = argc > 5 ? atoi(argv[4]) : 64;
+    int tile_k = argc > 5 ? atoi(argv[5]) : 64;
+    int tile_l = argc > 6 ? atoi(argv[6]) : 1;
+    return DfsTilesWrite(argv[2], argv[3], tile_j, tile_k, tile_l) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsTranspose") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsTranspose dfsFile cellFile [memoryMB]\n", argv[0]);
+      exit(-1);
+    }
+    size_t memory_mb = argc > 4 ? atoi(argv[4]) : 256;
+    return DfsTransposeWrite(argv[2], argv[3], memory_mb << 20) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsPyramid") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsPyramid dfs2File outPrefix [numLevels]\n", argv[0]);
+      exit(-1);
+    }
+    int num_levels = argc > 4 ? atoi(argv[4]) : 0;
+    return DfsPyramidBuild(argv[2], argv[3], num_levels) >= 0 ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsExtract") == 0)
+  {
+    if (argc < 6)
+    {
+      printf("Usage:  %s -dfsExtract dfsFile outFile firstTimestep lastTimestep [stride]\n", argv[0]);
+      exit(-1);
+    }
+    DfsTimeWindow window;
+    window.start = atol(argv[4]);
+    window.end = atol(argv[5]);
+    window.stride = argc > 6 ? atol(argv[6]) : 1;
+    return CopyDfsFileTimeWindow(argv[2], argv[3], window) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfs0Resample") == 0)
+  {
+    if (argc < 5)
+    {
+      printf("Usage:  %s -dfs0Resample dfs0File outFile tstepSeconds [linear|forward|backward]\n", argv[0]);
+      exit(-1);
+    }
+    DfsInterpolationType interp_type = DfsInterpLinear;
+    if (argc > 5 && _strcmpi(argv[5], "forward") == 0)
+      interp_type = DfsInterpStepForward;
+    else if (argc > 5 && _strcmpi(argv[5], "backward") == 0)
+      interp_type = DfsInterpStepBackward;
+    return DfsTimeSeriesResampleFile(argv[2], argv[3], atof(argv[4]), interp_type) >= 0 ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfs0ValueType") == 0)
+  {
+    const char* names[] = { "instantaneous", "accumulated", "stepaccumulated", "backward", "forward" };
+    int to = -1;
+    for (int i = 0; i < 5 && argc > 4; i++)
+      if (_strcmpi(argv[4], names[i]) == 0)
+        to = i;
+    if (to < 0)
+    {
+      printf("Usage:  %s -dfs0ValueType dfs0File outFile instantaneous|accumulated|stepaccumulated|backward|forward [rateSeconds]\n", argv[0]);
+      exit(-1);
+    }
+    double rate_seconds = argc > 5 ? atof(argv[5]) : 3600;
+    return DfsConvertValueTypeFile(argv[2], argv[3], (DataValueType)to, rate_seconds) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsConvertUnit") == 0)
+  {
+    if (argc < 5)
+    {
+      printf("Usage:  %s -dfsConvertUnit dfsFile outFile unitId [itemNumber]\n", argv[0]);
+      exit(-1);
+    }
+    LPHEAD pdfs;
+    LPFILE fp;
+    long rc = dfsFileRead(argv[2], &pdfs, &fp);
+    CheckRc(rc, "Error opening file");
+    long num_items = dfsGetNoOfItems(pdfs);
+    rc = dfsFileClose(pdfs, &fp);
+    rc = dfsHeaderDestroy(&pdfs);
+    // All items, or only the given item. Items of other quantities are not converted
+    int i_item = argc > 5 ? atoi(argv[5]) : 0;
+    std::vector<long> to_units(num_items, 0);
+    for (int i = 1; i <= num_items; i++)
+      if (i_item == 0 || i == i_item)
+        to_units[i - 1] = atol(argv[4]);
+    return CopyDfsFileConvertUnits(argv[2], argv[3], to_units.data()) > 0 ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsServe") == 0)
+  {
+    if (argc < 3)
+    {
+      printf("Usage:  %s -dfsServe rootFolder [port] [numWorkers]\n", argv[0]);
+      exit(-1);
+    }
+    DfsServer server;
+    if (!DfsServerStart(&server, argv[2], argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoi(argv[4]) : 4))
+      return -1;
+    printf("Serving %s on http://127.0.0.1:%d/, press Enter to stop\n", argv[2], server.port);
+    getchar();
+    DfsServerStop(&server);
+    return 0;
+  }
+
+  if (_strcmpi(argv[1], "-dfsSplit") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsSplit dfsFile outPrefix\n", argv[0]);
+      exit(-1);
+    }
+    return DfsSplitFile(argv[2], DfsSplitPerItem(argv[2], argv[3])) == F_NO_ERROR ? 0 : -1;
+  }
+
+  if (_strcmpi(argv[1], "-dfsuRenumber") == 0)
+  {
+    if (argc < 4)
+    {
+      printf("Usage:  %s -dfsuRenumber dfsuFile outFile [rcm|hilbert]\n", argv[0]);
+      exit(-1);
+    }
+    MeshRenumberMethod method = (argc > 4 && _strcmpi(argv[4], "hilbert") == 0) ? MeshRenumberHilbert : MeshRenumberRcm;
+    return RenumberDfsuFile(argv[2], argv[3], method) == F_NO_ERROR ? 0 : -1;
+  }
+
   // Test that EUM library is available	
   LPCTSTR baseUnitStr;
   LONG baseUnit;
@@ -0,0 +1,585 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsArchive.h"
+
+#include <CppUnitTestLogger.h>
+#include <string.h>
+#include <string>
+
+
+/** Archive file header, at the start of the archive */
+struct DfsArchiveHeader
+{
+  char     magic[8];          ///< "DFSARCH1"
+  uint32_t num_items;
+  uint32_t num_timesteps;
+  uint64_t skeleton_offset;   ///< Skeleton dfs file, header and static items
+  uint64_t skeleton_size;
+  uint64_t index_offset;      ///< Item widths, followed by chunk index
+  uint64_t reserved[3];
+};
+
+static const char DfsArchiveMagic[8] = { 'D', 'F', 'S', 'A', 'R', 'C', 'H', '1' };
+
+/** Plane storage modes */
+enum { PlaneRaw = 0, PlaneConstant = 1, PlaneRans = 2 };
+
+/*
+ * Order-0 rANS entropy coder, byte-wise renormalization, 32 bit state.
+ */
+static const uint32_t RansProbBits  = 12;
+static const uint32_t RansProbScale = 1 << RansProbBits;
+static const uint32_t RansLow       = 1u << 23;
+
+/** Scale symbol counts to frequencies summing to RansProbScale, all present symbols at least 1 */
+static void RansNormalize(const uint32_t* counts, size_t total, uint32_t* freqs)
+{
+  uint32_t sum = 0;
+  for (int s = 0; s < 256; s++)
+  {
+    freqs[s] = 0;
+    if (counts[s])
+    {
+      freqs[s] = (uint32_t)((uint64_t)counts[s] * RansProbScale / total);
+      if (freqs[s] == 0)
+        freqs[s] = 1;
+      sum += freqs[s];
+    }
+  }
+  // Give or take the rounding difference from the most frequent symbols
+  while (sum != RansProbScale)
+  {
+    int max_s = 0;
+    for (int s = 1; s < 256; s++)
+      if (freqs[s] > freqs[max_s])
+        max_s = s;
+    if (sum < RansProbScale)
+    {
+      freqs[max_s] += RansProbScale - sum;
+      sum = RansProbScale;
+    }
+    else
+    {
+      uint32_t dec = sum - RansProbScale < freqs[max_s] - 1 ? sum - RansProbScale : freqs[max_s] - 1;
+      freqs[max_s] -= dec;
+      sum -= dec;
+    }
+  }
+}
+
+static void PutVarint(std::vector<uint8_t>& out, uint32_t v)
+{
+  while (v >= 0x80)
+  {
+    out.push_back((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((uint8_t)v);
+}
+
+static bool GetVarint(const uint8_t*& p, const uint8_t* end, uint32_t* v)
+{
+  *v = 0;
+  for (int shift = 0; p < end && shift < 32; shift += 7)
+  {
+    uint8_t b = *p++;
+    *v |= (uint32_t)(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+/** Encode one plane of n bytes, appending mode byte and data to out */
+static void EncodePlane(const uint8_t* in, size_t n, std::vector<uint8_t>& out)
+{
+  uint32_t counts[256] = { 0 };
+  for (size_t i = 0; i < n; i++)
+    counts[in[i]]++;
+  int num_symbols = 0;
+  for (int s = 0; s < 256; s++)
+    if (counts[s])
+      num_symbols++;
+  if (num_symbols <= 1)
+  {
+    out.push_back(PlaneConstant);
+    out.push_back(n > 0 ? in[0] : 0);
+    return;
+  }
+
+  uint32_t freqs[256], cum[257];
+  RansNormalize(counts, n, freqs);
+  cum[0] = 0;
+  for (int s = 0; s < 256; s++)
+    cum[s + 1] = cum[s] + freqs[s];
+
+  // Encode backwards, into end of temporary buffer
+  std::vector<uint8_t> tmp(n + n / 2 + 16);
+  uint8_t* end = tmp.data() + tmp.size();
+  uint8_t* p = end;
+  uint32_t x = RansLow;
+  for (size_t i = n; i-- > 0; )
+  {
+    uint32_t f = freqs[in[i]];
+    uint32_t x_max = ((RansLow >> RansProbBits) << 8) * f;
+    while (x >= x_max)
+    {
+      if (p == tmp.data() + 4)
+      {
+        // Incompressible, store raw
+        out.push_back(PlaneRaw);
+        out.insert(out.end(), in, in + n);
+        return;
+      }
+      *--p = (uint8_t)x;
+      x >>= 8;
+    }
+    x = ((x / f) << RansProbBits) + (x % f) + cum[in[i]];
+  }
+  p -= 4;
+  memcpy(p, &x, 4);
+  size_t payload = end - p;
+
+  // Frequency table: bitmap of present symbols and the frequencies
+  size_t start = out.size();
+  out.push_back(PlaneRans);
+  uint8_t bitmap[32] = { 0 };
+  for (int s = 0; s < 256; s++)
+    if (freqs[s])
+      bitmap[s >> 3] |= (uint8_t)(1 << (s & 7));
+  out.insert(out.end(), bitmap, bitmap + 32);
+  for (int s = 0; s < 256; s++)
+    if (freqs[s])
+      PutVarint(out, freqs[s] - 1);
+  PutVarint(out, (uint32_t)payload);
+  if (out.size() - start + payload >= n + 1)
+  {
+    out.resize(start);
+    out.push_back(PlaneRaw);
+    out.insert(out.end(), in, in + n);
+    return;
+  }
+  out.insert(out.end(), p, end);
+}
+
+/** Decode one plane of n bytes. Returns false if data is corrupt */
+static bool DecodePlane(const uint8_t*& p, const uint8_t* end, uint8_t* out, size_t n)
+{
+  if (p >= end)
+    return false;
+  uint8_t mode = *p++;
+  if (mode == PlaneConstant)
+  {
+    if (p >= end)
+      return false;
+    memset(out, *p++, n);
+    return true;
+  }
+  if (mode == PlaneRaw)
+  {
+    if ((size_t)(end - p) < n)
+      return false;
+    memcpy(out, p, n);
+    p += n;
+    return true;
+  }
+  if (mode != PlaneRans || end - p < 32)
+    return false;
+
+  const uint8_t* bitmap = p;
+  p += 32;
+  uint32_t freqs[256], cum[257];
+  cum[0] = 0;
+  for (int s = 0; s < 256; s++)
+  {
+    freqs[s] = 0;
+    if (bitmap[s >> 3] & (1 << (s & 7)))
+    {
+      // Frequencies are bounded, such that the cumulative frequencies can not wrap around
+      if (!GetVarint(p, end, &freqs[s]) || freqs[s] >= RansProbScale)
+        return false;
+      freqs[s]++;
+    }
+    cum[s + 1] = cum[s] + freqs[s];
+    if (cum[s + 1] > RansProbScale)
+      return false;
+  }
+  uint32_t payload;
+  if (cum[256] != RansProbScale || !GetVarint(p, end, &payload) || (uint32_t)(end - p) < payload || payload < 4)
+    return false;
+  std::vector<uint8_t> slot2sym(RansProbScale);
+  for (int s = 0; s < 256; s++)
+    memset(&slot2sym[cum[s]], s, freqs[s]);
+
+  const uint8_t* q = p;
+  const uint8_t* q_end = p + payload;
+  uint32_t x;
+  memcpy(&x, q, 4);
+  q += 4;
+  for (size_t i = 0; i < n; i++)
+  {
+    uint32_t slot = x & (RansProbScale - 1);
+    uint8_t s = slot2sym[slot];
+    out[i] = s;
+    x = freqs[s] * (x >> RansProbBits) + slot - cum[s];
+    while (x < RansLow)
+    {
+      if (q >= q_end)
+        return false;
+      x = (x << 8) | *q++;
+    }
+  }
+  p = q_end;
+  return true;
+}
+
+/** Value predictors, XOR or difference with previous value */
+enum { PredictXor = 0, PredictDelta = 1 };
+
+/** Predict each value from the previous value, and shuffle residual bytes into one plane per byte */
+template <typename T>
+static void PredictDeltaShuffle(const uint8_t* in, size_t n, uint8_t* planes)
+{
+  T prev = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    T v;
+    memcpy(&v, in + i * sizeof(T), sizeof(T));
+    T r = v - prev;
+    prev = v;
+    for (size_t b = 0; b < sizeof(T); b++)
+      planes[b * n + i] = (uint8_t)(r >> (8 * b));
+  }
+}
+
+template <typename T>
+static void UnshuffleDelta(const uint8_t* planes, size_t n, uint8_t* out)
+{
+  T prev = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    T r = 0;
+    for (size_t b = 0; b < sizeof(T); b++)
+      r |= (T)planes[b * n + i] << (8 * b);
+    prev += r;
+    memcpy(out + i * sizeof(T), &prev, sizeof(T));
+  }
+}
+
+static void PredictXorShuffle(const uint8_t* in, size_t n, int width, uint8_t* planes)
+{
+  for (int b = 0; b < width; b++)
+  {
+    uint8_t* plane = &planes[b * n];
+    uint8_t prev = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      uint8_t v = in[i * width + b];
+      plane[i] = v ^ prev;
+      prev = v;
+    }
+  }
+}
+
+static void UnshuffleXor(const uint8_t* planes, size_t n, int width, uint8_t* out)
+{
+  for (int b = 0; b < width; b++)
+  {
+    const uint8_t* plane = &planes[b * n];
+    uint8_t prev = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      prev ^= plane[i];
+      out[i * width + b] = prev;
+    }
+  }
+}
+
+size_t DfsArchiveEncodeChunk(const void* data, size_t size, int width, std::vector<uint8_t>& out)
+{
+  if (width < 1 || size % width != 0)
+    width = 1;
+  size_t n = size / width;
+  const uint8_t* in = (const uint8_t*)data;
+  std::vector<uint8_t> planes(size);
+
+  // XOR prediction, which works for any data type
+  size_t start = out.size();
+  out.push_back(PredictXor);
+  PredictXorShuffle(in, n, width, planes.data());
+  for (int b = 0; b < width; b++)
+    EncodePlane(&planes[b * n], n, out);
+
+  // Difference of 4 and 8 byte values as integers, usually better for smooth float fields
+  if (width == 4 || width == 8)
+  {
+    std::vector<uint8_t> delta_out;
+    delta_out.push_back(PredictDelta);
+    if (width == 4)
+      PredictDeltaShuffle<uint32_t>(in, n, planes.data());
+    else
+      PredictDeltaShuffle<uint64_t>(in, n, planes.data());
+    for (int b = 0; b < width; b++)
+      EncodePlane(&planes[b * n], n, delta_out);
+    if (delta_out.size() < out.size() - start)
+    {
+      out.resize(start);
+      out.insert(out.end(), delta_out.begin(), delta_out.end());
+    }
+  }
+  return out.size() - start;
+}
+
+bool DfsArchiveDecodeChunk(const uint8_t* comp, size_t comp_size, int width, void* data, size_t size)
+{
+  if (width < 1 || size % width != 0)
+    width = 1;
+  size_t n = size / width;
+  const uint8_t* p = comp;
+  const uint8_t* end = comp + comp_size;
+  if (p >= end)
+    return false;
+  uint8_t predictor = *p++;
+  if (predictor != PredictXor && !(predictor == PredictDelta && (width == 4 || width == 8)))
+    return false;
+
+  std::vector<uint8_t> planes(size);
+  for (int b = 0; b < width; b++)
+  {
+    if (!DecodePlane(p, end, &planes[b * n], n))
+      return false;
+  }
+  if (predictor == PredictXor)
+    UnshuffleXor(planes.data(), n, width, (uint8_t*)data);
+  else if (width == 4)
+    UnshuffleDelta<uint32_t>(planes.data(), n, (uint8_t*)data);
+  else
+    UnshuffleDelta<uint64_t>(planes.data(), n, (uint8_t*)data);
+  return p == end;
+}
+
+/** Copy n bytes from one file to another */
+static bool DfsArchiveCopyBytes(FILE* from, FILE* to, uint64_t n)
+{
+  std::vector<char> buf(1 << 20);
+  while (n > 0)
+  {
+    size_t len = n < buf.size() ? (size_t)n : buf.size();
+    if (fread(buf.data(), 1, len, from) != len || fwrite(buf.data(), 1, len, to) != len)
+      return false;
+    n -= len;
+  }
+  return true;
+}
+
+long DfsArchiveWrite(LPCTSTR dfsFilename, LPCTSTR archiveFilename)
+{
+  LPHEAD pdfs, pdfsWr;
+  LPFILE fp, fpWr;
+  long rc = dfsFileRead(dfsFilename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfs);
+
+  // Skeleton file: Header, dynamic item definitions and static items, no time steps
+  std::string skeletonFilename = std::string(archiveFilename) + ".skeleton.tmp";
+  long num_timesteps = CreateDfsHeaderFromSource(pdfs, &pdfsWr, num_items);
+  CopyDfsDynamicItemInfo(pdfs, pdfsWr, num_items);
+  rc = dfsFileCreate(skeletonFilename.c_str(), pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating skeleton file");
+  CopyDfsStaticItems(pdfs, fp, pdfsWr, fpWr);
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing skeleton file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+
+  DfsArchiveHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DfsArchiveMagic, 8);
+  header.num_items = num_items;
+  header.num_timesteps = num_timesteps;
+  header.skeleton_offset = sizeof(header);
+
+  FILE* fa = fopen(archiveFilename, "wb");
+  FILE* fs = fopen(skeletonFilename.c_str(), "rb");
+  bool ok = fa && fs;
+  if (ok)
+  {
+    _fseeki64(fs, 0, SEEK_END);
+    header.skeleton_size = _ftelli64(fs);
+    _fseeki64(fs, 0, SEEK_SET);
+    ok = fwrite(&header, sizeof(header), 1, fa) == 1 && DfsArchiveCopyBytes(fs, fa, header.skeleton_size);
+  }
+  if (fs)
+    fclose(fs);
+  remove(skeletonFilename.c_str());
+
+  // Compress all item-timesteps
+  std::vector<uint32_t> item_widths(num_items);
+  long max_bytes = 0;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LPITEM item = dfsItemD(pdfs, i_item);
+    long num_elmts = dfsGetItemElements(item);
+    item_widths[i_item - 1] = num_elmts > 0 ? dfsGetItemBytes(item) / num_elmts : 1;
+    if (dfsGetItemBytes(item) > max_bytes)
+      max_bytes = dfsGetItemBytes(item);
+  }
+  std::vector<double> data(max_bytes / sizeof(double) + 1);
+  std::vector<uint8_t> comp;
+  std::vector<DfsArchiveChunk> index;
+  uint64_t pos = header.skeleton_offset + header.skeleton_size;
+  if (ok)
+  {
+    rc = dfsFindTimeStep(pdfs, fp, 0);
+    CheckRc(rc, "Error finding time step");
+  }
+  for (long i_tstep = 0; i_tstep < num_timesteps && ok; i_tstep++)
+  {
+    for (int i_item = 1; i_item <= num_items && ok; i_item++)
+    {
+      DfsArchiveChunk chunk;
+      rc = dfsReadItemTimeStep(pdfs, fp, &chunk.time, data.data());
+      CheckRc(rc, "Error reading dynamic item data");
+      chunk.raw_size = dfsGetItemBytes(dfsItemD(pdfs, i_item));
+      comp.clear();
+      chunk.comp_size = (uint32_t)DfsArchiveEncodeChunk(data.data(), chunk.raw_size, item_widths[i_item - 1], comp);
+      chunk.offset = pos;
+      ok = fwrite(comp.data(), 1, comp.size(), fa) == comp.size();
+      pos += comp.size();
+      index.push_back(chunk);
+    }
+  }
+
+  // Chunk index at the end, and update header with its location
+  header.index_offset = pos;
+  if (ok)
+    ok = fwrite(item_widths.data(), sizeof(uint32_t), num_items, fa) == (size_t)num_items &&
+         fwrite(index.data(), sizeof(DfsArchiveChunk), index.size(), fa) == index.size() &&
+         _fseeki64(fa, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, fa) == 1;
+  if (fa && fclose(fa) != 0)
+    ok = false;
+  if (!ok)
+    LOG("Error writing archive file: %s", archiveFilename);
+
+  rc = dfsFileClose(pdfs, &fp);
+  rc = dfsHeaderDestroy(&pdfs);
+  return ok ? F_NO_ERROR : -1;
+}
+
+bool DfsArchiveOpen(DfsArchiveReader* reader, LPCTSTR archiveFilename)
+{
+  DfsArchiveHeader header;
+  reader->fp = fopen(archiveFilename, "rb");
+  bool ok = reader->fp && fread(&header, sizeof(header), 1, reader->fp) == 1 &&
+            memcmp(header.magic, DfsArchiveMagic, 8) == 0;
+  if (ok)
+  {
+    reader->num_items = header.num_items;
+    reader->num_timesteps = header.num_timesteps;
+    reader->skeleton_offset = header.skeleton_offset;
+    reader->skeleton_size = header.skeleton_size;
+    reader->item_widths.resize(header.num_items);
+    reader->index.resize((size_t)header.num_items * header.num_timesteps);
+    ok = _fseeki64(reader->fp, header.index_offset, SEEK_SET) == 0 &&
+         fread(reader->item_widths.data(), sizeof(uint32_t), header.num_items, reader->fp) == header.num_items &&
+         fread(reader->index.data(), sizeof(DfsArchiveChunk), reader->index.size(), reader->fp) == reader->index.size();
+  }
+  if (!ok)
+  {
+    LOG("Not a valid archive file: %s", archiveFilename);
+    DfsArchiveClose(reader);
+  }
+  return ok;
+}
+
+long DfsArchiveReadItemTimeStep(DfsArchiveReader* reader, long tstep, int item, double* time, void* data)
+{
+  if (tstep < 0 || tstep >= (long)reader->num_timesteps)
+    return F_FAIL_ILLEGEAL_TSTEP;
+  if (item < 1 || item > (int)reader->num_items)
+    return F_FAIL_ILLEGEAL_ITEM;
+  const DfsArchiveChunk& chunk = reader->index[(size_t)tstep * reader->num_items + item - 1];
+  reader->buffer.resize(chunk.comp_size);
+  if (_fseeki64(reader->fp, chunk.offset, SEEK_SET) != 0 ||
+      fread(reader->buffer.data(), 1, chunk.comp_size, reader->fp) != chunk.comp_size)
+    return F_ERR_READ;
+  if (!DfsArchiveDecodeChunk(reader->buffer.data(), chunk.comp_size, reader->item_widths[item - 1], data, chunk.raw_size))
+    return F_ERR_DATA;
+  *time = chunk.time;
+  return F_NO_ERROR;
+}
+
+void DfsArchiveClose(DfsArchiveReader* reader)
+{
+  if (reader->fp)
+    fclose(reader->fp);
+  reader->fp = nullptr;
+  reader->index.clear();
+  reader->item_widths.clear();
+}
+
+long DfsArchiveRestore(LPCTSTR archiveFilename, LPCTSTR dfsFilename)
+{
+  DfsArchiveReader reader;
+  if (!DfsArchiveOpen(&reader, archiveFilename))
+    return -1;
+
+  // Extract skeleton dfs file
+  std::string skeletonFilename = std::string(dfsFilename) + ".skeleton.tmp";
+  FILE* fs = fopen(skeletonFilename.c_str(), "wb");
+  bool ok = fs && _fseeki64(reader.fp, reader.skeleton_offset, SEEK_SET) == 0 &&
+            DfsArchiveCopyBytes(reader.fp, fs, reader.skeleton_size);
+  if (fs && fclose(fs) != 0)
+    ok = false;
+  if (!ok)
+  {
+    LOG("Error extracting skeleton file: %s", skeletonFilename.c_str());
+    DfsArchiveClose(&reader);
+    remove(skeletonFilename.c_str());
+    return -1;
+  }
+
+  // Create file from skeleton, and write all item-timesteps
+  LPHEAD pdfsIn, pdfsWr;
+  LPFILE fpIn, fpWr;
+  long rc = dfsFileRead(skeletonFilename.c_str(), &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening skeleton file");
+  long num_items = dfsGetNoOfItems(pdfsIn);
+  CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+  rc = dfsFileCreate(dfsFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating file");
+  CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
+
+  long max_bytes = 0;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+    if (dfsGetItemBytes(dfsItemD(pdfsIn, i_item)) > max_bytes)
+      max_bytes = dfsGetItemBytes(dfsItemD(pdfsIn, i_item));
+  std::vector<double> data(max_bytes / sizeof(double) + 1);
+  for (long i_tstep = 0; i_tstep < (long)reader.num_timesteps && rc == F_NO_ERROR; i_tstep++)
+  {
+    for (int i_item = 1; i_item <= num_items && rc == F_NO_ERROR; i_item++)
+    {
+      double time;
+      rc = DfsArchiveReadItemTimeStep(&reader, i_tstep, i_item, &time, data.data());
+      if (rc == F_NO_ERROR)
+      {
+        rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time, data.data());
+        CheckRc(rc, "Error writing dynamic item data");
+      }
+    }
+  }
+  if (rc != F_NO_ERROR)
+    LOG("Error reading archive file: %s", archiveFilename);
+
+  long rc2 = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc2, "Error closing file");
+  rc2 = dfsHeaderDestroy(&pdfsWr);
+  rc2 = dfsFileClose(pdfsIn, &fpIn);
+  rc2 = dfsHeaderDestroy(&pdfsIn);
+  remove(skeletonFilename.c_str());
+  DfsArchiveClose(&reader);
+  return rc == F_NO_ERROR ? F_NO_ERROR : -1;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+ * Compressed archive of a dfs file.
+ *
+ * The archive contains a skeleton dfs file, with header, dynamic item definitions and
+ * static items but no time steps, followed by one compressed chunk per item-timestep
+ * and a chunk index allowing random access to any item-timestep.
+ *
+ * Each chunk is compressed losslessly: Each value is predicted from the previous value,
+ * by XOR or by integer difference of the value bits, whichever compresses best. The bytes
+ * of the residuals are shuffled into one plane per byte of the value, and each plane is
+ * entropy coded with an order-0 rANS coder, or stored as is if that is smaller.
+ */
+
+/** Index entry of one item-timestep chunk in the archive */
+struct DfsArchiveChunk
+{
+  uint64_t offset;      ///< Offset of compressed chunk in archive file
+  uint32_t comp_size;   ///< Size of compressed chunk
+  uint32_t raw_size;    ///< Size of item-timestep data, in bytes
+  double   time;        ///< Time as returned by dfsReadItemTimeStep
+};
+
+/** Archive opened for reading */
+struct DfsArchiveReader
+{
+  FILE*    fp = nullptr;
+  uint32_t num_items = 0;
+  uint32_t num_timesteps = 0;
+  uint64_t skeleton_offset = 0;
+  uint64_t skeleton_size = 0;
+  std::vector<uint32_t>        item_widths;  ///< Size of one element of each item, in bytes
+  std::vector<DfsArchiveChunk> index;        ///< Chunk of (tstep, item) at index[tstep * num_items + item - 1]
+  std::vector<uint8_t>         buffer;       ///< Compressed data buffer
+};
+
+/**
+ * Compress data of size bytes, consisting of elements of width bytes, appending the result to out.
+ * Returns size of compressed data.
+ */
+size_t DfsArchiveEncodeChunk(const void* data, size_t size, int width, std::vector<uint8_t>& out);
+
+/**
+ * Decompress chunk of comp_size bytes into data, of size bytes and element width as when compressed.
+ * Returns false if chunk is corrupt.
+ */
+bool DfsArchiveDecodeChunk(const uint8_t* comp, size_t comp_size, int width, void* data, size_t size);
+
+/**
+ * Transcode a dfs file to a compressed archive.
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long DfsArchiveWrite(LPCTSTR dfsFilename, LPCTSTR archiveFilename);
+
+/**
+ * Restore the dfs file from an archive. Header and static items are copied
+ * from the skeleton dfs file in the archive, using the CopyDfs* helpers.
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long DfsArchiveRestore(LPCTSTR archiveFilename, LPCTSTR dfsFilename);
+
+/** Open archive for random access reads. Returns false on failure */
+bool DfsArchiveOpen(DfsArchiveReader* reader, LPCTSTR archiveFilename);
+
+/**
+ * Read one item-timestep, time step zero based and item one based, as dfsReadItemTimeStep.
+ * Returns F_NO_ERROR on success.
+ */
+long DfsArchiveReadItemTimeStep(DfsArchiveReader* reader, long tstep, int item, double* time, void* data);
+
+void DfsArchiveClose(DfsArchiveReader* reader);
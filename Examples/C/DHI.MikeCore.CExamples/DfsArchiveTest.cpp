@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsArchive.h"
+#include "DfsDiff.h"
+#include <CppUnitTest.h>
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsArchive_tests)
+  {
+  public:
+
+    /// Archive OresundHD.dfs2, read from the archive and restore it
+    TEST_METHOD(ArchiveDfs2Test)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char archiveFullPath[_MAX_PATH];
+      snprintf(archiveFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_C.dfsa");
+      char restoredFullPath[_MAX_PATH];
+      snprintf(restoredFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Crestored.dfs2");
+
+      long rc = DfsArchiveWrite(inputFullPath, archiveFullPath);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::IsTrue(FileSize(archiveFullPath) < FileSize(inputFullPath));
+
+      // Random access read of one item-timestep
+      DfsArchiveReader reader;
+      Assert::IsTrue(DfsArchiveOpen(&reader, archiveFullPath));
+      Assert::AreEqual((uint32_t)3, reader.num_items);
+      Assert::AreEqual((uint32_t)13, reader.num_timesteps);
+      std::vector<float> data(71 * 91);
+      double time;
+      rc = DfsArchiveReadItemTimeStep(&reader, 2, 1, &time, data.data());
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::AreEqual(2.0, time);
+      Assert::AreEqual(11.3634329f, data[71 * 4 + 3]);
+      rc = DfsArchiveReadItemTimeStep(&reader, 13, 1, &time, data.data());
+      Assert::AreEqual((long)F_FAIL_ILLEGEAL_TSTEP, rc);
+      DfsArchiveClose(&reader);
+
+      // Restored file must be identical to the original
+      rc = DfsArchiveRestore(archiveFullPath, restoredFullPath);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      DfsDiffOptions options;
+      options.summary_only = true;
+      DfsDiffResult result;
+      rc = DfsDiff(inputFullPath, restoredFullPath, nullptr, options, &result);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::IsTrue(result.equal);
+      Assert::AreEqual(13L, result.num_timesteps);
+    }
+
+    /// Encode and decode synthetic data, which must come back bit-exact
+    TEST_METHOD(ArchiveCodecTest)
+    {
+      std::vector<float> smooth(10000);
+      for (size_t i = 0; i < smooth.size(); i++)
+        smooth[i] = (i % 7 == 0) ? 1e-35f : (float)sin(0.001 * i);
+      std::vector<double> constant(5000, 3.25);
+
+      std::vector<uint8_t> comp;
+      size_t comp_size = DfsArchiveEncodeChunk(smooth.data(), smooth.size() * sizeof(float), sizeof(float), comp);
+      Assert::AreEqual(comp.size(), comp_size);
+      Assert::IsTrue(comp_size < smooth.size() * sizeof(float));
+      std::vector<float> smooth2(smooth.size());
+      Assert::IsTrue(DfsArchiveDecodeChunk(comp.data(), comp_size, sizeof(float), smooth2.data(), smooth2.size() * sizeof(float)));
+      Assert::AreEqual(0, memcmp(smooth.data(), smooth2.data(), smooth.size() * sizeof(float)));
+      // Truncated data must be rejected
+      Assert::IsFalse(DfsArchiveDecodeChunk(comp.data(), comp_size / 2, sizeof(float), smooth2.data(), smooth2.size() * sizeof(float)));
+
+      comp.clear();
+      comp_size = DfsArchiveEncodeChunk(constant.data(), constant.size() * sizeof(double), sizeof(double), comp);
+      Assert::IsTrue(comp_size < 100);
+      std::vector<double> constant2(constant.size());
+      Assert::IsTrue(DfsArchiveDecodeChunk(comp.data(), comp_size, sizeof(double), constant2.data(), constant2.size() * sizeof(double)));
+      Assert::AreEqual(0, memcmp(constant.data(), constant2.data(), constant.size() * sizeof(double)));
+
+      // Frequencies of symbol 0 and 1, 0xFFFFFFFF and 4097, wrap around to sum to the 4096 scale, and must be rejected
+      std::vector<uint8_t> crafted = { 0, 2, 0x03 };
+      crafted.resize(2 + 32, 0);
+      std::vector<uint8_t> freqs = { 0xFE, 0xFF, 0xFF, 0xFF, 0x0F, 0x80, 0x20, 4, 0, 0, 0x80, 0 };
+      crafted.insert(crafted.end(), freqs.begin(), freqs.end());
+      uint8_t bytes[16];
+      Assert::IsFalse(DfsArchiveDecodeChunk(crafted.data(), crafted.size(), 1, bytes, sizeof(bytes)));
+    }
+
+    static long long FileSize(LPCTSTR filename)
+    {
+      FILE* fp = fopen(filename, "rb");
+      Assert::IsNotNull(fp);
+      _fseeki64(fp, 0, SEEK_END);
+      long long size = _ftelli64(fp);
+      fclose(fp);
+      return size;
+    }
+
+  };
+}
@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsuUtil.h"
+#include "DfsCache.h"
+
+#include <CppUnitTestLogger.h>
+#include <list>
+#include <unordered_map>
+
+
+/** Cache state: Entries by path, and paths in least recently used order, front being the most recent */
+struct DfsCache
+{
+  std::mutex mtx;
+  std::list<std::string> lru;
+  struct Entry
+  {
+    std::shared_ptr<DfsCachedFile> file;
+    std::list<std::string>::iterator lru_pos;
+  };
+  std::unordered_map<std::string, Entry> entries;
+  size_t budget = (size_t)1 << 30;
+  DfsCacheStats stats;
+};
+
+static DfsCache dfsCache;
+
+DfsCachedFile::~DfsCachedFile()
+{
+  if (has_mesh)
+    CleanupMeshGeometry(&mesh);
+  if (pdfs)
+  {
+    dfsFileClose(pdfs, &fp);
+    dfsHeaderDestroy(&pdfs);
+  }
+}
+
+/** Open file, read the static item catalog and the mesh. Returns nullptr on errors */
+static std::shared_ptr<DfsCachedFile> DfsCacheLoad(const std::string& path, std::filesystem::file_time_type mtime)
+{
+  auto file = std::make_shared<DfsCachedFile>();
+  file->path = path;
+  file->mtime = mtime;
+  long rc = dfsFileRead(path.c_str(), &file->pdfs, &file->fp);
+  if (rc != F_NO_ERROR)
+  {
+    LOG("Error opening file %s (%li - %s)\n", path.c_str(), rc, GetRCString(rc));
+    file->pdfs = nullptr;
+    return nullptr;
+  }
+
+  // Catalog of static items
+  LONG error;
+  LPVECTOR pvec;
+  while ((pvec = dfsStaticRead(file->fp, &error)) != NULL)
+  {
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    DfsStaticItemInfo info;
+    LPITEM static_item = dfsItemS(pvec);
+    rc = dfsGetItemInfo(static_item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &info.datatype);
+    info.name = item_name;
+    info.item_type = item_type;
+    info.item_unit = item_unit;
+    info.num_elmts = dfsGetItemElements(static_item);
+    file->static_items.push_back(info);
+    dfsStaticDestroy(&pvec);
+  }
+  DfsHandlePoolInit(&file->handles, path.c_str());
+  file->bytes = sizeof(DfsCachedFile) + file->static_items.size() * sizeof(DfsStaticItemInfo);
+
+  // Mesh of dfsu files, reading the static items again
+  if (IsDfsu2D(file->pdfs))
+  {
+    rc = dfsFindBlockStatic(file->pdfs, file->fp);
+    CheckRc(rc, "Error finding static items");
+    ReadDfsuGeometry(file->pdfs, file->fp, &file->mesh);
+    file->has_mesh = true;
+    ComputeMeshMetrics(file->mesh, &file->metrics);
+    const MeshGeometry& mesh = file->mesh;
+    file->bytes += mesh.num_nodes * (2 * sizeof(int) + 2 * sizeof(double) + sizeof(float))
+                 + mesh.num_elmts * 3 * sizeof(int) + mesh.num_conn * sizeof(int)
+                 + mesh.num_elmts * 7 * sizeof(double);
+  }
+  return file;
+}
+
+/** Evict least recently used entries until within budget. Cache must be locked */
+static void DfsCacheEvict(DfsCache& cache)
+{
+  while (cache.stats.bytes > cache.budget && !cache.lru.empty())
+  {
+    auto it = cache.entries.find(cache.lru.back());
+    cache.stats.bytes -= it->second.file->bytes;
+    cache.entries.erase(it);
+    cache.lru.pop_back();
+    cache.stats.evictions++;
+  }
+  cache.stats.num_entries = cache.entries.size();
+}
+
+DfsCacheHandle DfsCacheOpen(LPCTSTR filename)
+{
+  std::string path(filename);
+  std::error_code ec;
+  std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path, ec);
+  if (ec)
+  {
+    LOG("Error opening file %s: %s\n", filename, ec.message().c_str());
+    return nullptr;
+  }
+
+  DfsCache& cache = dfsCache;
+  {
+    std::lock_guard<std::mutex> lock(cache.mtx);
+    auto it = cache.entries.find(path);
+    if (it != cache.entries.end() && it->second.file->mtime == mtime)
+    {
+      cache.lru.splice(cache.lru.begin(), cache.lru, it->second.lru_pos);
+      cache.stats.hits++;
+      return it->second.file;
+    }
+    cache.stats.misses++;
+  }
+
+  // Load without holding the lock, such that hits on other files are not blocked
+  std::shared_ptr<DfsCachedFile> file = DfsCacheLoad(path, mtime);
+  if (!file)
+    return nullptr;
+
+  std::lock_guard<std::mutex> lock(cache.mtx);
+  auto it = cache.entries.find(path);
+  if (it != cache.entries.end())
+  {
+    // Loaded concurrently by another query, use that one unless stale
+    if (it->second.file->mtime == mtime)
+    {
+      cache.lru.splice(cache.lru.begin(), cache.lru, it->second.lru_pos);
+      return it->second.file;
+    }
+    cache.stats.bytes -= it->second.file->bytes;
+    cache.lru.erase(it->second.lru_pos);
+    cache.entries.erase(it);
+  }
+  cache.lru.push_front(path);
+  cache.entries[path] = DfsCache::Entry{ file, cache.lru.begin() };
+  cache.stats.bytes += file->bytes;
+  DfsCacheEvict(cache);
+  return file;
+}
+
+void DfsCacheSetBudget(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(dfsCache.mtx);
+  dfsCache.budget = bytes;
+  DfsCacheEvict(dfsCache);
+}
+
+void DfsCacheClear()
+{
+  std::lock_guard<std::mutex> lock(dfsCache.mtx);
+  dfsCache.entries.clear();
+  dfsCache.lru.clear();
+  dfsCache.stats.bytes = 0;
+  dfsCache.stats.num_entries = 0;
+}
+
+DfsCacheStats DfsCacheGetStats()
+{
+  std::lock_guard<std::mutex> lock(dfsCache.mtx);
+  return dfsCache.stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "DfsuUtil.h"
+#include "DfsHandlePool.h"
+#include "MeshMetrics.h"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Process wide cache of opened dfs files, for long running services answering many
+ * small queries against the same files.
+ *
+ * Opening a file with dfsFileRead, parsing the header, and for dfsu files reading the
+ * mesh geometry with ReadDfsuGeometry, is done once per file. The opened file, the
+ * catalog of its static items, and the decoded mesh with its element metrics are cached,
+ * keyed by path and modification time, such that a file that is rewritten is opened again.
+ *
+ * DfsCacheOpen returns a reference counted handle. Concurrent queries share the cached
+ * file, and an entry evicted while in use stays valid until its last handle is released.
+ * Entries are evicted least recently used first, when the estimated size of the cache
+ * exceeds the byte budget, see DfsCacheSetBudget.
+ *
+ *   DfsCacheHandle file = DfsCacheOpen(filename);
+ *   if (file)
+ *   {
+ *     std::lock_guard<std::mutex> lock(file->file_mutex);
+ *     rc = dfsFindItemDynamic(file->pdfs, file->fp, tstep, item);
+ *     ...
+ *   }
+ *
+ * Queries reading concurrently from the same file lease a handle of their own instead,
+ * DfsHandlePoolAcquire(&file->handles), see DfsHandlePool.h.
+ */
+
+/** Info of a static item, from dfsGetItemInfo */
+struct DfsStaticItemInfo
+{
+  std::string name;
+  long        item_type = 0;     ///< EUM type id
+  long        item_unit = 0;     ///< EUM unit id
+  SimpleType  datatype = UFS_FLOAT;
+  long        num_elmts = 0;
+};
+
+/** Opened file in the cache. The header, catalog and mesh are read only. */
+struct DfsCachedFile
+{
+  std::string path;
+  std::filesystem::file_time_type mtime;
+
+  LPHEAD pdfs = nullptr;
+  LPFILE fp = nullptr;
+  mutable std::mutex file_mutex;           ///< Lock while reading from fp, the file position being shared
+  mutable DfsHandlePool handles;           ///< Handles for concurrent reads, not needing file_mutex
+
+  std::vector<DfsStaticItemInfo> static_items;
+  bool         has_mesh = false;           ///< True for 2D dfsu files, mesh being read
+  MeshGeometry mesh;
+  MeshMetrics  metrics;                    ///< Element centroids, areas and bounding boxes of the mesh
+
+  size_t bytes = 0;                        ///< Estimated memory usage, counted in the cache budget
+
+  DfsCachedFile() = default;
+  DfsCachedFile(const DfsCachedFile&) = delete;
+  ~DfsCachedFile();
+};
+
+/** Reference counted handle to a cached file */
+typedef std::shared_ptr<const DfsCachedFile> DfsCacheHandle;
+
+/** Counters of the cache */
+struct DfsCacheStats
+{
+  long long hits = 0;
+  long long misses = 0;
+  long long evictions = 0;
+  size_t    bytes = 0;          ///< Estimated size of the entries in the cache
+  size_t    num_entries = 0;
+};
+
+/**
+ * Get the cached file of filename, opening it on a miss, or when the file was modified since
+ * it was cached. Returns an empty handle if the file can not be opened. Thread safe.
+ */
+DfsCacheHandle DfsCacheOpen(LPCTSTR filename);
+
+/** Set the byte budget of the cache, evicting entries as needed. Default is 1 GB. */
+void DfsCacheSetBudget(size_t bytes);
+
+/** Remove all entries from the cache. Entries in use stay valid until released. */
+void DfsCacheClear();
+
+/** Counters of the cache */
+DfsCacheStats DfsCacheGetStats();
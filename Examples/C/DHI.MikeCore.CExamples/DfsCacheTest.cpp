@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsCache.h"
+#include <CppUnitTest.h>
+
+#include <thread>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsCache_tests)
+  {
+  public:
+
+    /// Repeated opens share one cached file, with the mesh of dfsu files decoded once
+    TEST_METHOD(CacheOpenTest)
+    {
+      char dfsuFullPath[_MAX_PATH];
+      snprintf(dfsuFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+      DfsCacheClear();
+      DfsCacheSetBudget((size_t)1 << 30);
+      DfsCacheStats stats0 = DfsCacheGetStats();
+
+      DfsCacheHandle file1 = DfsCacheOpen(dfsuFullPath);
+      Assert::IsTrue(file1 != nullptr);
+      Assert::IsTrue(file1->has_mesh);
+      Assert::IsTrue(file1->mesh.num_elmts > 0);
+      Assert::AreEqual((size_t)file1->mesh.num_elmts, file1->metrics.area.size());
+      Assert::AreEqual(std::string("Node id"), file1->static_items[0].name);
+
+      // Concurrent queries share the cached file
+      std::vector<DfsCacheHandle> handles(4);
+      std::vector<std::thread> threads;
+      for (int i = 0; i < 4; i++)
+        threads.emplace_back([&, i] { handles[i] = DfsCacheOpen(dfsuFullPath); });
+      for (std::thread& t : threads)
+        t.join();
+      for (int i = 0; i < 4; i++)
+        Assert::IsTrue(handles[i] == file1);
+
+      DfsCacheStats stats = DfsCacheGetStats();
+      Assert::AreEqual(1LL, stats.misses - stats0.misses);
+      Assert::AreEqual(4LL, stats.hits - stats0.hits);
+      Assert::AreEqual((size_t)1, stats.num_entries);
+
+      // Read dynamic data through the cached file
+      std::vector<float> data(file1->mesh.num_elmts);
+      double time;
+      {
+        std::lock_guard<std::mutex> lock(file1->file_mutex);
+        long rc = dfsFindItemDynamic(file1->pdfs, file1->fp, 0, 1);
+        CheckRc(rc, "Error finding item-timestep");
+        rc = dfsReadItemTimeStep(file1->pdfs, file1->fp, &time, data.data());
+        CheckRc(rc, "Error reading item-timestep");
+      }
+
+      Assert::IsTrue(DfsCacheOpen("nonexisting.dfsu") == nullptr);
+      DfsCacheClear();
+    }
+
+    /// Least recently used entries are evicted when over budget, and stay valid while in use
+    TEST_METHOD(CacheEvictTest)
+    {
+      char dfsuFullPath[_MAX_PATH];
+      snprintf(dfsuFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+      char dfs2FullPath[_MAX_PATH];
+      snprintf(dfs2FullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      DfsCacheClear();
+      DfsCacheSetBudget((size_t)1 << 30);
+
+      DfsCacheHandle dfsu = DfsCacheOpen(dfsuFullPath);
+      DfsCacheHandle dfs2 = DfsCacheOpen(dfs2FullPath);
+      Assert::IsFalse(dfs2->has_mesh);
+      Assert::AreEqual((size_t)2, DfsCacheGetStats().num_entries);
+
+      // Budget for the dfs2 file only, evicting the dfsu file, the least recently used
+      long long evictions = DfsCacheGetStats().evictions;
+      DfsCacheSetBudget(dfs2->bytes);
+      DfsCacheStats stats = DfsCacheGetStats();
+      Assert::AreEqual(1LL, stats.evictions - evictions);
+      Assert::AreEqual((size_t)1, stats.num_entries);
+      Assert::IsTrue(DfsCacheOpen(dfs2FullPath) == dfs2);
+
+      // Evicted entry is still valid, and is opened again on the next query
+      Assert::IsTrue(dfsu->mesh.num_elmts > 0);
+      DfsCacheSetBudget((size_t)1 << 30);
+      DfsCacheHandle dfsu2 = DfsCacheOpen(dfsuFullPath);
+      Assert::IsTrue(dfsu2 != dfsu);
+      Assert::AreEqual(dfsu->mesh.num_elmts, dfsu2->mesh.num_elmts);
+      DfsCacheClear();
+    }
+
+  };
+}
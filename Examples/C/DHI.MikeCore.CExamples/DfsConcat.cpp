@@ -0,0 +1,660 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsConcat.h"
+
+#include <CppUnitTestLogger.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+/** Size of buffer used for raw block copies */
+static const size_t ConcatCopyBufferSize = 16 * 1024 * 1024;
+
+/** A part of a source file to be copied to the target */
+struct ConcatSegment
+{
+  int  source;        ///< Source file index
+  long first_tstep;   ///< First time step to copy
+  long num_tsteps;    ///< Number of time steps to copy
+};
+
+/** Check that spatial axes of two items match, for equidistant axes also origin and spacing */
+static bool DfsConcatAxisMatch(LPITEM item0, LPITEM item)
+{
+  LONG    unit0, unit;
+  LPCTSTR unit_str;
+  LONG    n0[4] = { 0 }, n[4] = { 0 };
+  float   a0[8] = { 0 }, a[8] = { 0 };
+  switch (dfsGetItemAxisType(item0))
+  {
+  case F_EQ_AXIS_D0:
+    dfsGetItemAxisEqD0(item0, &unit0, &unit_str);
+    dfsGetItemAxisEqD0(item, &unit, &unit_str);
+    break;
+  case F_EQ_AXIS_D1:
+    dfsGetItemAxisEqD1(item0, &unit0, &unit_str, &n0[0], &a0[0], &a0[1]);
+    dfsGetItemAxisEqD1(item, &unit, &unit_str, &n[0], &a[0], &a[1]);
+    break;
+  case F_EQ_AXIS_D2:
+    dfsGetItemAxisEqD2(item0, &unit0, &unit_str, &n0[0], &n0[1], &a0[0], &a0[1], &a0[2], &a0[3]);
+    dfsGetItemAxisEqD2(item, &unit, &unit_str, &n[0], &n[1], &a[0], &a[1], &a[2], &a[3]);
+    break;
+  case F_EQ_AXIS_D3:
+    dfsGetItemAxisEqD3(item0, &unit0, &unit_str, &n0[0], &n0[1], &n0[2], &a0[0], &a0[1], &a0[2], &a0[3], &a0[4], &a0[5]);
+    dfsGetItemAxisEqD3(item, &unit, &unit_str, &n[0], &n[1], &n[2], &a[0], &a[1], &a[2], &a[3], &a[4], &a[5]);
+    break;
+  case F_EQ_AXIS_D4:
+    dfsGetItemAxisEqD4(item0, &unit0, &unit_str, &n0[0], &n0[1], &n0[2], &n0[3], &a0[0], &a0[1], &a0[2], &a0[3], &a0[4], &a0[5], &a0[6], &a0[7]);
+    dfsGetItemAxisEqD4(item, &unit, &unit_str, &n[0], &n[1], &n[2], &n[3], &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &a[6], &a[7]);
+    break;
+  default:
+    // Other axes have their coordinates in the axis, compared by the number of elements only
+    return true;
+  }
+  return unit0 == unit && memcmp(n0, n, sizeof(n)) == 0 && memcmp(a0, a, sizeof(a)) == 0;
+}
+
+/** Check that geographic projections of two files match */
+static bool DfsConcatGeoInfoMatch(LPHEAD pdfs0, LPHEAD pdfs, LPCTSTR filename)
+{
+  bool match = dfsGetGeoInfoType(pdfs0) == dfsGetGeoInfoType(pdfs);
+  if (match && dfsGetGeoInfoType(pdfs0) == F_UTM_PROJECTION)
+  {
+    LPCTSTR projection_id0, projection_id;
+    double lon00, lat00, orientation0, lon0, lat0, orientation;
+    long rc = GetDfsGeoInfo(pdfs0, &projection_id0, &lon00, &lat00, &orientation0);
+    CheckRc(rc, "Error reading projection");
+    rc = GetDfsGeoInfo(pdfs, &projection_id, &lon0, &lat0, &orientation);
+    CheckRc(rc, "Error reading projection");
+    match = 0 == strcmp(projection_id0, projection_id) && lon00 == lon0 && lat00 == lat0 && orientation0 == orientation;
+  }
+  if (!match)
+    LOG("Projection does not match: %s", filename);
+  return match;
+}
+
+/** Static item of a file: Item info and data */
+struct ConcatStaticItem
+{
+  LONG       item_type;
+  LONG       item_unit;
+  SimpleType item_datatype;
+  std::vector<char> data;
+};
+
+/** Read all static items of a file, the dfsu mesh being static items */
+static void ReadConcatStaticItems(LPHEAD pdfs, LPFILE fp, std::vector<ConcatStaticItem>* static_items)
+{
+  long rc = dfsFindBlockStatic(pdfs, fp);
+  CheckRc(rc, "Error finding static items");
+  LPVECTOR pvec;
+  while (nullptr != (pvec = dfsStaticRead(fp, &rc)))
+  {
+    LPITEM static_item = dfsItemS(pvec);
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    ConcatStaticItem sitem;
+    rc = dfsGetItemInfo(static_item, &sitem.item_type, &item_type_str, &item_name, &sitem.item_unit, &item_unit_str, &sitem.item_datatype);
+    CheckRc(rc, "Error reading static item info");
+    sitem.data.resize(dfsGetItemBytes(static_item));
+    rc = dfsStaticGetData(pvec, sitem.data.data());
+    CheckRc(rc, "Error reading static data");
+    static_items->push_back(std::move(sitem));
+    rc = dfsStaticDestroy(&pvec);
+  }
+}
+
+/** Check that static items of two files match, in item info and values */
+static bool DfsConcatStaticItemsMatch(const std::vector<ConcatStaticItem>& static_items0, LPHEAD pdfs, LPFILE fp, LPCTSTR filename)
+{
+  std::vector<ConcatStaticItem> static_items;
+  ReadConcatStaticItems(pdfs, fp, &static_items);
+  bool match = static_items0.size() == static_items.size();
+  for (size_t i = 0; i < static_items.size() && match; i++)
+  {
+    const ConcatStaticItem& s0 = static_items0[i];
+    const ConcatStaticItem& s = static_items[i];
+    match = s0.item_type == s.item_type && s0.item_unit == s.item_unit &&
+            s0.item_datatype == s.item_datatype && s0.data == s.data;
+  }
+  if (!match)
+    LOG("Static items do not match: %s", filename);
+  return match;
+}
+
+/** Check that dynamic items of two files match */
+static bool DfsConcatItemsMatch(LPHEAD pdfs0, LPHEAD pdfs, LPCTSTR filename)
+{
+  long num_items = dfsGetNoOfItems(pdfs0);
+  if (num_items != dfsGetNoOfItems(pdfs))
+  {
+    LOG("Number of dynamic items does not match: %s", filename);
+    return false;
+  }
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LONG          item_type0, item_type;
+    LPCTSTR       item_type_str;
+    LPCTSTR       item_name;
+    LONG          item_unit0, item_unit;
+    LPCTSTR       item_unit_str;
+    SimpleType    item_datatype0, item_datatype;
+    LPITEM item0 = dfsItemD(pdfs0, i_item);
+    LPITEM item = dfsItemD(pdfs, i_item);
+    long rc = dfsGetItemInfo(item0, &item_type0, &item_type_str, &item_name, &item_unit0, &item_unit_str, &item_datatype0);
+    CheckRc(rc, "Error reading dynamic item info");
+    rc = dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+    CheckRc(rc, "Error reading dynamic item info");
+    if (item_type0 != item_type || item_unit0 != item_unit || item_datatype0 != item_datatype ||
+        dfsGetItemElements(item0) != dfsGetItemElements(item) ||
+        dfsGetItemBytes(item0) != dfsGetItemBytes(item) ||
+        dfsGetItemAxisType(item0) != dfsGetItemAxisType(item) ||
+        !DfsConcatAxisMatch(item0, item))
+    {
+      LOG("Dynamic item %d does not match: %s", i_item, filename);
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Check that delete values of two files match */
+static bool DfsConcatDeleteValuesMatch(LPHEAD pdfs0, LPHEAD pdfs, LPCTSTR filename)
+{
+  DeleteValues delVals0, delVals;
+  GetDfsDeleteVals(pdfs0, &delVals0);
+  GetDfsDeleteVals(pdfs, &delVals);
+  if (delVals0.deleteF != delVals.deleteF || delVals0.deleteD != delVals.deleteD ||
+      delVals0.deleteByte != delVals.deleteByte || delVals0.deleteInt != delVals.deleteInt ||
+      delVals0.deleteUint != delVals.deleteUint)
+  {
+    LOG("Delete values does not match: %s", filename);
+    return false;
+  }
+  return true;
+}
+
+/** Time of last time step in file, in seconds */
+static double DfsConcatEndTime(LPHEAD pdfs, LPFILE fp, TimeAxisType taxis_type, double start_sec, double tstep_sec, long num_timesteps)
+{
+  if (taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS)
+    return start_sec + (num_timesteps - 1) * tstep_sec;
+
+  // Non-equidistant axis: Read time of last time step, relative to start of file
+  TimeAxisType t;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep, tspan;
+  long n, neum_unit, index;
+  GetDfsTimeAxis(pdfs, &t, &n, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  std::vector<double> buf((dfsGetItemBytes(dfsItemD(pdfs, 1)) + sizeof(double) - 1) / sizeof(double));
+  double time;
+  long rc = dfsFindItemDynamic(pdfs, fp, num_timesteps - 1, 1);
+  CheckRc(rc, "Error finding last time step");
+  rc = dfsReadItemTimeStep(pdfs, fp, &time, buf.data());
+  CheckRc(rc, "Error reading last time step");
+  return start_sec + (time - tstart) * GetDfsTimeUnitSeconds(neum_unit);
+}
+
+bool DfsConcatValidate(LPCTSTR* sourceFilenames, int num_sources, int* skip_first, long* num_timesteps_out)
+{
+  long rc;
+  LPHEAD pdfs0;
+  LPFILE fp0;
+  rc = dfsFileRead(sourceFilenames[0], &pdfs0, &fp0);
+  CheckRc(rc, "Error opening file");
+
+  double start0, tstep0;
+  long   num_timesteps0;
+  TimeAxisType taxis_type0 = GetDfsTimeAxisSeconds(pdfs0, &start0, &tstep0, &num_timesteps0);
+  bool is_equidistant = taxis_type0 == F_TM_EQ_AXIS || taxis_type0 == F_CAL_EQ_AXIS;
+  std::vector<ConcatStaticItem> static_items0;
+  ReadConcatStaticItems(pdfs0, fp0, &static_items0);
+  double prev_end = DfsConcatEndTime(pdfs0, fp0, taxis_type0, start0, tstep0, num_timesteps0);
+  if (skip_first)
+    skip_first[0] = 0;
+  if (num_timesteps_out)
+    num_timesteps_out[0] = num_timesteps0;
+
+  bool ok = true;
+  for (int k = 1; k < num_sources && ok; k++)
+  {
+    LPHEAD pdfs;
+    LPFILE fp;
+    rc = dfsFileRead(sourceFilenames[k], &pdfs, &fp);
+    CheckRc(rc, "Error opening file");
+
+    double start, tstep;
+    long num_timesteps;
+    TimeAxisType taxis_type = GetDfsTimeAxisSeconds(pdfs, &start, &tstep, &num_timesteps);
+    if (num_timesteps_out)
+      num_timesteps_out[k] = num_timesteps;
+
+    ok = DfsConcatItemsMatch(pdfs0, pdfs, sourceFilenames[k]) &&
+         DfsConcatDeleteValuesMatch(pdfs0, pdfs, sourceFilenames[k]) &&
+         DfsConcatGeoInfoMatch(pdfs0, pdfs, sourceFilenames[k]) &&
+         DfsConcatStaticItemsMatch(static_items0, pdfs, fp, sourceFilenames[k]);
+    if (ok && taxis_type != taxis_type0)
+    {
+      LOG("Time axis type does not match: %s", sourceFilenames[k]);
+      ok = false;
+    }
+    if (ok && is_equidistant && fabs(tstep - tstep0) > 1e-6 * tstep0)
+    {
+      LOG("Time step does not match: %s", sourceFilenames[k]);
+      ok = false;
+    }
+    if (ok && num_timesteps > 0)
+    {
+      // Time step continuity: Either continue after the last time step of
+      // the previous file, or start at the last time step of the previous file.
+      double tol = is_equidistant ? 1e-3 * tstep0 : 1e-3;
+      int skip = -1;
+      if (fabs(start - prev_end) <= tol)
+        skip = 1;
+      else if (is_equidistant && fabs(start - (prev_end + tstep0)) <= tol)
+        skip = 0;
+      else if (!is_equidistant && start > prev_end)
+        skip = 0;
+      if (skip < 0)
+      {
+        LOG("Time axis is not continuous with previous file: %s", sourceFilenames[k]);
+        ok = false;
+      }
+      else
+      {
+        if (skip_first)
+          skip_first[k] = skip;
+        prev_end = DfsConcatEndTime(pdfs, fp, taxis_type, start, tstep, num_timesteps);
+      }
+    }
+    else if (ok && skip_first)
+      skip_first[k] = 0;
+
+    rc = dfsFileClose(pdfs, &fp);
+    rc = dfsHeaderDestroy(&pdfs);
+  }
+
+  rc = dfsFileClose(pdfs0, &fp0);
+  rc = dfsHeaderDestroy(&pdfs0);
+  return ok;
+}
+
+/** Read little endian 32 bit integer */
+static long ReadInt32LE(const unsigned char* p)
+{
+  return (long)((unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24));
+}
+
+/** Size of file in bytes, or -1 if file could not be opened */
+static long long DfsConcatFileSize(LPCTSTR filename)
+{
+  FILE* f = fopen(filename, "rb");
+  if (f == NULL)
+    return -1;
+  _fseeki64(f, 0, SEEK_END);
+  long long size = _ftelli64(f);
+  fclose(f);
+  return size;
+}
+
+/** Read bytes from file at offset. Returns true on success */
+static bool ReadBytesAt(FILE* f, long long offset, void* data, size_t size)
+{
+  if (_fseeki64(f, offset, SEEK_SET) != 0)
+    return false;
+  return fread(data, 1, size, f) == size;
+}
+
+/** Copy size bytes from offset in source to the end of target, in large sequential blocks */
+static bool CopyBytes(FILE* fsrc, long long offset, long long size, FILE* ftgt, std::vector<char>& buffer)
+{
+  if (_fseeki64(fsrc, offset, SEEK_SET) != 0)
+    return false;
+  while (size > 0)
+  {
+    size_t chunk = size < (long long)buffer.size() ? (size_t)size : buffer.size();
+    if (fread(buffer.data(), 1, chunk, fsrc) != chunk)
+      return false;
+    if (fwrite(buffer.data(), 1, chunk, ftgt) != chunk)
+      return false;
+    size -= chunk;
+  }
+  return true;
+}
+
+/**
+ * Find the byte offset where the dynamic data of a file starts, assuming that
+ * item-timesteps are stored back to back at the end of the file, as is the case for
+ * equidistant time axes. The layout is verified by comparing the first and last
+ * item-timestep with data read through the dfs API.
+ * Returns -1 if the layout could not be verified.
+ */
+static long long DfsConcatDynamicOffset(LPCTSTR filename, long long tstep_bytes)
+{
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(filename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+  double start, tstep;
+  long num_timesteps;
+  GetDfsTimeAxisSeconds(pdfs, &start, &tstep, &num_timesteps);
+  long num_items = dfsGetNoOfItems(pdfs);
+  long long file_size = DfsConcatFileSize(filename);
+  long long offset = file_size - num_timesteps * tstep_bytes;
+  if (num_timesteps <= 0 || offset <= 0)
+    offset = -1;
+
+  FILE* f = offset > 0 ? fopen(filename, "rb") : NULL;
+  if (f == NULL)
+    offset = -1;
+  if (offset > 0)
+  {
+    // Compare first item of first time step and last item of last time step
+    long first_bytes = dfsGetItemBytes(dfsItemD(pdfs, 1));
+    long last_bytes = dfsGetItemBytes(dfsItemD(pdfs, num_items));
+    std::vector<char> api((first_bytes > last_bytes ? first_bytes : last_bytes) + sizeof(double));
+    std::vector<char> raw(api.size());
+    double time;
+    rc = dfsFindItemDynamic(pdfs, fp, 0, 1);
+    rc |= dfsReadItemTimeStep(pdfs, fp, &time, api.data());
+    if (rc != F_NO_ERROR || !ReadBytesAt(f, offset, raw.data(), first_bytes) ||
+        memcmp(api.data(), raw.data(), first_bytes) != 0)
+      offset = -1;
+    rc = dfsFindItemDynamic(pdfs, fp, num_timesteps - 1, num_items);
+    rc |= dfsReadItemTimeStep(pdfs, fp, &time, api.data());
+    if (rc != F_NO_ERROR || !ReadBytesAt(f, file_size - last_bytes, raw.data(), last_bytes) ||
+        memcmp(api.data(), raw.data(), last_bytes) != 0)
+      offset = -1;
+  }
+  if (f)
+    fclose(f);
+  rc = dfsFileClose(pdfs, &fp);
+  rc = dfsHeaderDestroy(&pdfs);
+  return offset;
+}
+
+/**
+ * Append one time step from source to target through the dfs API.
+ * Used to find the number of time steps in the target header, and as fallback.
+ */
+static void DfsConcatAppendTimeStep(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, long num_items,
+                                    double time_offset, std::vector<double>& buffer)
+{
+  double time;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    long rc = dfsReadItemTimeStep(pdfsIn, fpIn, &time, buffer.data());
+    CheckRc(rc, "Error reading dynamic item data");
+    rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time + time_offset, buffer.data());
+    CheckRc(rc, "Error writing dynamic item data");
+  }
+}
+
+/**
+ * Raw block copy version of concatenation. This relies on a file layout that is not
+ * part of the documented dfs API, which holds for equidistant time axes without item
+ * statistics:
+ *  - The dynamic data is one contiguous block of item-timesteps at the end of the file,
+ *    verified by DfsConcatDynamicOffset.
+ *  - The number of time steps is a 32 bit little-endian integer in the header, and it
+ *    is the only header field that changes when a time step is appended.
+ * Files with item statistics are not copied raw, the statistics in the header not
+ * being updated for the appended time steps.
+ *
+ * The copy is done as:
+ *  - The first file is copied as is.
+ *  - One time step is appended through the dfs API, such that the location
+ *    of the number of time steps in the header can be found by comparing with the first file.
+ *  - The remaining time steps are copied as raw bytes to the end of the file.
+ *  - The number of time steps in the header is updated.
+ * Returns false if the raw block copy could not be done.
+ */
+static bool DfsConcatRaw(LPCTSTR targetFilename, LPCTSTR* sourceFilenames, int num_sources,
+                         const std::vector<ConcatSegment>& segments, long long tstep_bytes, long total_tsteps)
+{
+  long rc;
+  std::vector<long long> offsets(num_sources);
+  for (int k = 0; k < num_sources; k++)
+  {
+    offsets[k] = DfsConcatDynamicOffset(sourceFilenames[k], tstep_bytes);
+    if (offsets[k] < 0)
+    {
+      LOG("Could not verify dynamic data layout of %s", sourceFilenames[k]);
+      return false;
+    }
+  }
+  std::vector<char> buffer(ConcatCopyBufferSize);
+
+  // Copy first file as is
+  long long size0 = DfsConcatFileSize(sourceFilenames[0]);
+  FILE* fsrc = fopen(sourceFilenames[0], "rb");
+  FILE* ftgt = fopen(targetFilename, "wb");
+  if (fsrc == NULL || ftgt == NULL)
+  {
+    if (fsrc) fclose(fsrc);
+    if (ftgt) fclose(ftgt);
+    return false;
+  }
+  bool ok = CopyBytes(fsrc, 0, size0, ftgt, buffer);
+  fclose(fsrc);
+  fclose(ftgt);
+  if (!ok)
+    return false;
+  if (segments.empty())
+    return true;
+
+  // Append the first time step of the first segment through the dfs API.
+  const ConcatSegment& seg0 = segments[0];
+  LPHEAD pdfsIn, pdfsWr;
+  LPFILE fpIn, fpWr;
+  rc = dfsFileRead(sourceFilenames[seg0.source], &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening file");
+  rc = dfsFileAppend(targetFilename, &pdfsWr, &fpWr);
+  CheckRc(rc, "Error opening file for appending");
+  long num_items = dfsGetNoOfItems(pdfsIn);
+  std::vector<double> item_buffer(tstep_bytes / sizeof(double) + 1);
+  rc = dfsFindTimeStep(pdfsIn, fpIn, seg0.first_tstep);
+  CheckRc(rc, "Error finding time step");
+  DfsConcatAppendTimeStep(pdfsIn, fpIn, pdfsWr, fpWr, num_items, 0, item_buffer);
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  rc = dfsFileClose(pdfsIn, &fpIn);
+  rc = dfsHeaderDestroy(&pdfsIn);
+
+  // Find location of number of time steps in header: The only header bytes that changed.
+  long long header_size = offsets[0];
+  long num_tsteps0 = (long)((size0 - offsets[0]) / tstep_bytes);
+  if (DfsConcatFileSize(targetFilename) != size0 + tstep_bytes)
+    return false;
+  std::vector<unsigned char> header0((size_t)header_size), header((size_t)header_size);
+  fsrc = fopen(sourceFilenames[0], "rb");
+  ftgt = fopen(targetFilename, "r+b");
+  ok = fsrc != NULL && ftgt != NULL &&
+       ReadBytesAt(fsrc, 0, header0.data(), header0.size()) &&
+       ReadBytesAt(ftgt, 0, header.data(), header.size());
+  if (fsrc)
+    fclose(fsrc);
+  long long first_diff = -1, last_diff = -1;
+  for (long long i = 0; ok && i < header_size; i++)
+  {
+    if (header0[i] != header[i])
+    {
+      if (first_diff < 0)
+        first_diff = i;
+      last_diff = i;
+    }
+  }
+  long long count_offset = -1;
+  if (ok && first_diff >= 0 && last_diff - first_diff < 4)
+  {
+    for (long long w = last_diff - 3; w <= first_diff; w++)
+    {
+      if (w >= 0 && w + 4 <= header_size &&
+          ReadInt32LE(&header0[w]) == num_tsteps0 && ReadInt32LE(&header[w]) == num_tsteps0 + 1)
+      {
+        count_offset = w;
+        break;
+      }
+    }
+  }
+  if (count_offset < 0)
+  {
+    LOG("Could not locate number of time steps in header");
+    if (ftgt)
+      fclose(ftgt);
+    return false;
+  }
+
+  // Append remaining time steps as raw bytes
+  _fseeki64(ftgt, 0, SEEK_END);
+  for (size_t s = 0; s < segments.size() && ok; s++)
+  {
+    const ConcatSegment& seg = segments[s];
+    long first = seg.first_tstep + (s == 0 ? 1 : 0);
+    long num = seg.num_tsteps - (s == 0 ? 1 : 0);
+    if (num <= 0)
+      continue;
+    fsrc = fopen(sourceFilenames[seg.source], "rb");
+    ok = fsrc != NULL && CopyBytes(fsrc, offsets[seg.source] + first * tstep_bytes, num * tstep_bytes, ftgt, buffer);
+    if (fsrc)
+      fclose(fsrc);
+  }
+
+  // Update number of time steps in header
+  unsigned char count[4];
+  count[0] = (unsigned char)(total_tsteps & 0xff);
+  count[1] = (unsigned char)((total_tsteps >> 8) & 0xff);
+  count[2] = (unsigned char)((total_tsteps >> 16) & 0xff);
+  count[3] = (unsigned char)((total_tsteps >> 24) & 0xff);
+  ok = ok && _fseeki64(ftgt, count_offset, SEEK_SET) == 0 && fwrite(count, 1, 4, ftgt) == 4;
+  fclose(ftgt);
+  if (!ok)
+    return false;
+
+  // Verify the result through the dfs API
+  double start, tstep;
+  long num_timesteps;
+  rc = dfsFileRead(targetFilename, &pdfsWr, &fpWr);
+  CheckRc(rc, "Error opening concatenated file");
+  GetDfsTimeAxisSeconds(pdfsWr, &start, &tstep, &num_timesteps);
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  rc = dfsHeaderDestroy(&pdfsWr);
+  if (num_timesteps != total_tsteps)
+    return false;
+  return DfsConcatDynamicOffset(targetFilename, tstep_bytes) == offsets[0];
+}
+
+/** Item-timestep version of concatenation, used when a raw block copy is not possible */
+static void DfsConcatItemTimeSteps(LPCTSTR targetFilename, LPCTSTR* sourceFilenames, const std::vector<ConcatSegment>& segments)
+{
+  long rc;
+  LPHEAD pdfs0, pdfsWr;
+  LPFILE fp0, fpWr;
+  rc = dfsFileRead(sourceFilenames[0], &pdfs0, &fp0);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfs0);
+  TimeAxisType taxis_type = dfsGetTimeAxisType(pdfs0);
+
+  CreateDfsHeaderFromSource(pdfs0, &pdfsWr, num_items);
+  CopyDfsDynamicItemInfo(pdfs0, pdfsWr, num_items);
+  rc = dfsFileCreate(targetFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating file");
+  CopyDfsStaticItems(pdfs0, fp0, pdfsWr, fpWr);
+
+  long max_bytes = 0;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+    if (dfsGetItemBytes(dfsItemD(pdfs0, i_item)) > max_bytes)
+      max_bytes = dfsGetItemBytes(dfsItemD(pdfs0, i_item));
+  std::vector<double> buffer(max_bytes / sizeof(double) + 1);
+
+  for (size_t s = 0; s < segments.size(); s++)
+  {
+    const ConcatSegment& seg = segments[s];
+    LPHEAD pdfsIn;
+    LPFILE fpIn;
+    rc = dfsFileRead(sourceFilenames[seg.source], &pdfsIn, &fpIn);
+    CheckRc(rc, "Error opening file");
+    // For non-equidistant calendar axes, times are relative to the start date of each
+    // file, shift them to be relative to the start date of the first file.
+    double time_offset = 0;
+    if (taxis_type == F_CAL_NEQ_AXIS)
+    {
+      TimeAxisType t;
+      LPCTSTR start_date0, start_time0, start_date, start_time;
+      double tstart, tstep, tspan;
+      long n, neum_unit, index;
+      GetDfsTimeAxis(pdfs0, &t, &n, &start_date0, &start_time0, &tstart, &tstep, &tspan, &neum_unit, &index);
+      GetDfsTimeAxis(pdfsIn, &t, &n, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+      time_offset = (DfsDateTimeToSeconds(start_date, start_time) - DfsDateTimeToSeconds(start_date0, start_time0))
+                    / GetDfsTimeUnitSeconds(neum_unit);
+    }
+    rc = dfsFindTimeStep(pdfsIn, fpIn, seg.first_tstep);
+    CheckRc(rc, "Error finding time step");
+    for (long i = 0; i < seg.num_tsteps; i++)
+      DfsConcatAppendTimeStep(pdfsIn, fpIn, pdfsWr, fpWr, num_items, time_offset, buffer);
+    rc = dfsFileClose(pdfsIn, &fpIn);
+    rc = dfsHeaderDestroy(&pdfsIn);
+  }
+
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  rc = dfsFileClose(pdfs0, &fp0);
+  rc = dfsHeaderDestroy(&pdfs0);
+}
+
+long DfsConcatFiles(LPCTSTR targetFilename, LPCTSTR* sourceFilenames, int num_sources)
+{
+  std::vector<int> skip_first(num_sources);
+  if (!DfsConcatValidate(sourceFilenames, num_sources, skip_first.data()))
+    return -1;
+
+  // Time steps to copy from each file, and size of one time step
+  LPHEAD pdfs;
+  LPFILE fp;
+  std::vector<ConcatSegment> segments;
+  long total_tsteps = 0;
+  long long tstep_bytes = 0;
+  TimeAxisType taxis_type = F_TM_EQ_AXIS;
+  bool has_stats = false;
+  for (int k = 0; k < num_sources; k++)
+  {
+    long rc = dfsFileRead(sourceFilenames[k], &pdfs, &fp);
+    CheckRc(rc, "Error opening file");
+    double start, tstep;
+    long num_timesteps;
+    taxis_type = GetDfsTimeAxisSeconds(pdfs, &start, &tstep, &num_timesteps);
+    if (dfsGetItemStatsType(pdfs) != F_NO_STAT)
+      has_stats = true;
+    if (k == 0)
+    {
+      for (int i_item = 1; i_item <= dfsGetNoOfItems(pdfs); i_item++)
+        tstep_bytes += dfsGetItemBytes(dfsItemD(pdfs, i_item));
+    }
+    ConcatSegment seg = { k, skip_first[k], num_timesteps - skip_first[k] };
+    total_tsteps += seg.num_tsteps > 0 ? seg.num_tsteps : 0;
+    // The first file is part of the target from the start
+    if (k > 0 && seg.num_tsteps > 0)
+      segments.push_back(seg);
+    rc = dfsFileClose(pdfs, &fp);
+    rc = dfsHeaderDestroy(&pdfs);
+  }
+
+  bool is_equidistant = taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS;
+  bool use_raw = is_equidistant && !has_stats;
+  if (use_raw && DfsConcatRaw(targetFilename, sourceFilenames, num_sources, segments, tstep_bytes, total_tsteps))
+    return F_NO_ERROR;
+
+  if (use_raw)
+    LOG("Raw block copy not possible, copying item-timesteps");
+  // The first file is copied item-timestep by item-timestep as well
+  ConcatSegment seg0 = { 0, 0, total_tsteps };
+  for (size_t s = 0; s < segments.size(); s++)
+    seg0.num_tsteps -= segments[s].num_tsteps;
+  segments.insert(segments.begin(), seg0);
+  DfsConcatItemTimeSteps(targetFilename, sourceFilenames, segments);
+  return F_NO_ERROR;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+/**
+ * Validate that a number of dfs files can be concatenated in time:
+ * Same dynamic items (size, data type, EUM type and unit, spatial axis, including
+ * origin and spacing of equidistant axes), same delete values, same projection,
+ * same static items (item info and values, e.g. bathymetry or dfsu mesh), same type
+ * of time axis, same time step for equidistant axes, and each file continuing where
+ * the previous file ended.
+ *
+ * If skip_first is not NULL, it must have num_sources entries. skip_first[k] is set to
+ * 1 if the first time step of file k equals the last time step of file k-1, as is
+ * the case for a simulation restarted from a hotstart file, otherwise 0.
+ *
+ * If num_timesteps is not NULL, it must have num_sources entries, and is set to
+ * the number of time steps in each file.
+ *
+ * Returns true if files are compatible.
+ */
+bool DfsConcatValidate(LPCTSTR* sourceFilenames, int num_sources, int* skip_first, long* num_timesteps = nullptr);
+
+/**
+ * Concatenate a number of dfs files in time into one new file.
+ * Header and static items are taken from the first file.
+ *
+ * For equidistant time axes without item statistics, the dynamic data blocks
+ * of the files are copied as raw bytes in large sequential blocks, without
+ * decoding item-timesteps, and the number of time steps is patched in the
+ * header. This assumes a file layout that is not part of the documented dfs
+ * API: Item-timesteps stored back to back at the end of the file, and a 32 bit
+ * time step count in the header. The layout is verified before and after the
+ * copy. If it cannot be verified, for files with item statistics, or for
+ * non-equidistant time axes, data is copied item-timestep by item-timestep
+ * through the dfs API.
+ *
+ * Returns F_NO_ERROR on success, or -1 if files are not compatible.
+ */
+long DfsConcatFiles(LPCTSTR targetFilename, LPCTSTR* sourceFilenames, int num_sources);
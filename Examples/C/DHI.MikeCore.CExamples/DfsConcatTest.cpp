@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsConcat.h"
+#include "DfsDiff.h"
+#include <CppUnitTest.h>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsConcat_tests)
+  {
+  public:
+
+    /// Split OresundHD.dfs2 in two segments, sharing one time step, and concatenate them again
+    TEST_METHOD(ConcatDfs2SegmentsTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char segment1FullPath[_MAX_PATH];
+      snprintf(segment1FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_segment1.dfs2");
+      char segment2FullPath[_MAX_PATH];
+      snprintf(segment2FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_segment2.dfs2");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cconcat.dfs2");
+
+      // OresundHD.dfs2 starts 1993-12-02 and has 13 daily time steps.
+      // Segment 2 starts at the last time step of segment 1, as a hotstart simulation.
+      DfsTimeWindow window1, window2;
+      window1.end = 6;
+      window2.start = 6;
+      Assert::AreEqual((long)F_NO_ERROR, CopyDfsFileTimeWindow(inputFullPath, segment1FullPath, window1));
+      Assert::AreEqual((long)F_NO_ERROR, CopyDfsFileTimeWindow(inputFullPath, segment2FullPath, window2));
+
+      LPCTSTR sources[2] = { segment1FullPath, segment2FullPath };
+      int skip_first[2];
+      Assert::IsTrue(DfsConcatValidate(sources, 2, skip_first));
+      Assert::AreEqual(0, skip_first[0]);
+      Assert::AreEqual(1, skip_first[1]);
+
+      long rc = DfsConcatFiles(outputFullPath, sources, 2);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+
+      // Concatenated file must equal the original file
+      DfsDiffOptions options;
+      options.summary_only = true;
+      DfsDiffResult result;
+      rc = DfsDiff(inputFullPath, outputFullPath, nullptr, options, &result);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::IsTrue(result.equal);
+      Assert::AreEqual((long)13, result.num_timesteps);
+
+      // Files with a gap in time can not be concatenated
+      LPCTSTR sourcesGap[2] = { segment1FullPath, outputFullPath };
+      Assert::IsFalse(DfsConcatValidate(sourcesGap, 2, nullptr));
+    }
+
+  };
+}
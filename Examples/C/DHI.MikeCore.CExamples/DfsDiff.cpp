@@ -0,0 +1,344 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsDiff.h"
+
+#include <CppUnitTestLogger.h>
+#include <math.h>
+#include <string.h>
+
+
+/**
+ * Compare one item-timestep of two files. Returns the number of values outside
+ * tolerance, and updates the largest absolute difference where both files have values.
+ *
+ * The loop is written without branches, such that the compiler can vectorize it.
+ * A value pair is considered different if only one of the values is a delete value,
+ * or if the difference is outside tolerance (including NaN values).
+ */
+template <typename T>
+static long DiffCount(const T* data1, const T* data2, int size, T delete1, T delete2,
+                      T abs_tol, T rel_tol, T* max_diff, long* num_delete_diffs)
+{
+  long num_diffs = 0;
+  long num_deletes = 0;
+  T    maxd = *max_diff;
+  for (int k = 0; k < size; k++)
+  {
+    T v1 = data1[k];
+    T v2 = data2[k];
+    int del1 = (v1 == delete1);
+    int del2 = (v2 == delete2);
+    int both_values = !(del1 | del2);
+    int one_delete = del1 ^ del2;
+
+    T abs1 = v1 < 0 ? -v1 : v1;
+    T abs2 = v2 < 0 ? -v2 : v2;
+    T diff = v1 - v2;
+    diff = diff < 0 ? -diff : diff;
+    T tol = abs_tol + rel_tol * (abs1 > abs2 ? abs1 : abs2);
+    // Written as !(diff <= tol), such that NaN values count as a difference
+    int outside = !(diff <= tol);
+
+    num_deletes += one_delete;
+    num_diffs += one_delete | (both_values & outside);
+    T d = both_values ? diff : 0;
+    maxd = d > maxd ? d : maxd;
+  }
+  *max_diff = maxd;
+  *num_delete_diffs += num_deletes;
+  return num_diffs;
+}
+
+/**
+ * Calculate the difference data1 - data2 into data1.
+ * Follows DfsDiff.cs: If both are delete values, the result is a delete value.
+ * If only one is a delete value, the other value is used (negated for data2).
+ */
+template <typename T>
+static void DiffData(T* data1, const T* data2, int size, T delete1, T delete2)
+{
+  for (int k = 0; k < size; k++)
+  {
+    T v1 = data1[k];
+    T v2 = data2[k];
+    int del1 = (v1 == delete1);
+    int del2 = (v2 == delete2);
+    T d = del1 ? -v2 : v1 - v2;
+    d = del2 ? v1 : d;
+    data1[k] = (del1 & del2) ? delete1 : d;
+  }
+}
+
+/**
+ * Validate that the two files have the same dynamic items, item sizes and data types.
+ * Only float and double items are supported.
+ */
+static bool DfsDiffValidate(LPHEAD pdfs1, LPHEAD pdfs2, long num_items)
+{
+  if (num_items != dfsGetNoOfItems(pdfs2))
+  {
+    LOG("Number of dynamic items does not match");
+    return false;
+  }
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LPITEM item1 = dfsItemD(pdfs1, i_item);
+    LPITEM item2 = dfsItemD(pdfs2, i_item);
+    if (dfsGetItemElements(item1) != dfsGetItemElements(item2))
+    {
+      LOG("Dynamic items must have same size, item number %d has different sizes in the two files", i_item);
+      return false;
+    }
+    if (dfsGetItemBytes(item1) != dfsGetItemBytes(item2))
+    {
+      LOG("Dynamic items must have same data type, item number %d differs in the two files", i_item);
+      return false;
+    }
+    LONG          item_type;      // Item EUM type id
+    LPCTSTR       item_type_str;  // Name of item type
+    LPCTSTR       item_name;      // Name of item
+    LONG          item_unit;      // Item EUM unit id
+    LPCTSTR       item_unit_str;  // Item EUM unit string
+    SimpleType    item_datatype;  // Simple type stored in item, usually float but can be double
+    long rc = dfsGetItemInfo(item1, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+    CheckRc(rc, "Error reading dynamic item info");
+    if (item_datatype != UFS_FLOAT && item_datatype != UFS_DOUBLE)
+    {
+      LOG("Dynamic item must be double or float, item number %d is of type %d", i_item, item_datatype);
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Time axis of a file, for the time of each time step in seconds, see DfsDiffTimeSeconds */
+struct DfsDiffTimeAxis
+{
+  TimeAxisType taxis_type;
+  double start_sec, tstep_sec;  ///< Start and time step of equidistant axes, see GetDfsTimeAxisSeconds
+  double date_sec;              ///< Start date of non-equidistant calendar axes, 0 for other axes
+  double unit_sec;              ///< Time unit in seconds
+  long   num_timesteps;
+};
+
+static void GetDfsDiffTimeAxis(LPHEAD pdfs, DfsDiffTimeAxis* axis)
+{
+  axis->taxis_type = GetDfsTimeAxisSeconds(pdfs, &axis->start_sec, &axis->tstep_sec, &axis->num_timesteps);
+  TimeAxisType taxis_type;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep, tspan;
+  long num_timesteps, neum_unit, index;
+  GetDfsTimeAxis(pdfs, &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  axis->unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+  axis->date_sec = taxis_type == F_CAL_NEQ_AXIS ? DfsDateTimeToSeconds(start_date, start_time) : 0;
+}
+
+/** Time of time step i_tstep in seconds, time being the time read with the item-timestep */
+static double DfsDiffTimeSeconds(const DfsDiffTimeAxis& axis, long i_tstep, double time)
+{
+  if (axis.taxis_type == F_TM_EQ_AXIS || axis.taxis_type == F_CAL_EQ_AXIS)
+    return axis.start_sec + i_tstep * axis.tstep_sec;
+  return axis.date_sec + time * axis.unit_sec;
+}
+
+long DfsDiff(LPCTSTR file1, LPCTSTR file2, LPCTSTR filediff, const DfsDiffOptions& options, DfsDiffResult* result)
+{
+  long rc;
+  LPHEAD pdfs1, pdfs2;
+  LPFILE fp1, fp2;
+  rc = dfsFileRead(file1, &pdfs1, &fp1);
+  CheckRc(rc, "Error opening file1");
+  rc = dfsFileRead(file2, &pdfs2, &fp2);
+  CheckRc(rc, "Error opening file2");
+
+  long num_items = dfsGetNoOfItems(pdfs1);
+  if (!DfsDiffValidate(pdfs1, pdfs2, num_items))
+  {
+    dfsFileClose(pdfs1, &fp1); dfsHeaderDestroy(&pdfs1);
+    dfsFileClose(pdfs2, &fp2); dfsHeaderDestroy(&pdfs2);
+    return -1;
+  }
+
+  // In case number of time steps does not match, compare the smallest number, the files not being equal.
+  DfsDiffTimeAxis axis1, axis2;
+  GetDfsDiffTimeAxis(pdfs1, &axis1);
+  GetDfsDiffTimeAxis(pdfs2, &axis2);
+  long num_timesteps = axis1.num_timesteps;
+  if (axis2.num_timesteps < num_timesteps)
+  {
+    num_timesteps = axis2.num_timesteps;
+    LOG("Number of time steps does not match, using the smallest number");
+  }
+
+  // Set up the diff file, as a copy of file1. In summary mode, no diff file is written.
+  bool write_diff = !options.summary_only && filediff != nullptr && filediff[0] != '\0';
+  LPHEAD pdfsWr = nullptr;
+  LPFILE fpWr = nullptr;
+  if (write_diff)
+  {
+    CreateDfsHeaderFromSource(pdfs1, &pdfsWr, num_items);
+    CopyDfsDynamicItemInfo(pdfs1, pdfsWr, num_items);
+    rc = dfsFileCreate(filediff, pdfsWr, &fpWr);
+    CheckRc(rc, "Error creating diff file");
+    CopyDfsStaticItems(pdfs1, fp1, pdfsWr, fpWr);
+  }
+
+  // Skip static items, position both file pointers at the first item-timestep
+  rc = dfsFindBlockDynamic(pdfs1, fp1);
+  CheckRc(rc, "Error finding dynamic data in file1");
+  rc = dfsFindBlockDynamic(pdfs2, fp2);
+  CheckRc(rc, "Error finding dynamic data in file2");
+
+  float  deleteF1 = dfsGetDeleteValFloat(pdfs1);
+  float  deleteF2 = dfsGetDeleteValFloat(pdfs2);
+  double deleteD1 = dfsGetDeleteValDouble(pdfs1);
+  double deleteD2 = dfsGetDeleteValDouble(pdfs2);
+
+  // Per item info and buffers. Buffers are reused for all time steps.
+  result->items.assign(num_items, DfsDiffItemStats());
+  std::vector<SimpleType> item_datatypes(num_items);
+  std::vector<int>        item_num_elmts(num_items);
+  size_t max_bytes = 0;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    LPITEM item = dfsItemD(pdfs1, i_item);
+    rc = dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatypes[i_item - 1]);
+    CheckRc(rc, "Error reading dynamic item info");
+    result->items[i_item - 1].name = item_name;
+    item_num_elmts[i_item - 1] = dfsGetItemElements(item);
+    if ((size_t)dfsGetItemBytes(item) > max_bytes)
+      max_bytes = dfsGetItemBytes(item);
+  }
+  // Use double buffers to get alignment suitable for both float and double data
+  std::vector<double> buf1((max_bytes + sizeof(double) - 1) / sizeof(double));
+  std::vector<double> buf2((max_bytes + sizeof(double) - 1) / sizeof(double));
+
+  result->equal = axis1.num_timesteps == axis2.num_timesteps;
+  result->num_timesteps = 0;
+  result->first_time_diff_tstep = -1;
+  bool stop = false;
+  double time1, time2;
+  for (long i_tstep = 0; i_tstep < num_timesteps && !stop; i_tstep++)
+  {
+    for (int i_item = 1; i_item <= num_items; i_item++)
+    {
+      int i = i_item - 1;
+      rc = dfsReadItemTimeStep(pdfs1, fp1, &time1, buf1.data());
+      CheckRc(rc, "Error reading dynamic item data from file1");
+      rc = dfsReadItemTimeStep(pdfs2, fp2, &time2, buf2.data());
+      CheckRc(rc, "Error reading dynamic item data from file2");
+
+      // Times of the time step, compared once, with the first item
+      if (i_item == 1)
+      {
+        double time_diff = fabs(DfsDiffTimeSeconds(axis1, i_tstep, time1) - DfsDiffTimeSeconds(axis2, i_tstep, time2));
+        if (!(time_diff <= options.abs_tol))
+        {
+          if (result->first_time_diff_tstep < 0)
+            result->first_time_diff_tstep = i_tstep;
+          result->equal = false;
+          if (options.summary_only)
+          {
+            stop = true;
+            break;
+          }
+        }
+      }
+
+      DfsDiffItemStats& stats = result->items[i];
+      int  size = item_num_elmts[i];
+      bool is_float = item_datatypes[i] == UFS_FLOAT;
+      size_t bytes = size * (is_float ? sizeof(float) : sizeof(double));
+
+      // Bitwise identical data needs no further checks, which is the common case in regression tests.
+      long num_diffs = 0;
+      double max_diff = stats.max_diff;
+      if (memcmp(buf1.data(), buf2.data(), bytes) != 0)
+      {
+        if (is_float)
+        {
+          float maxf = (float)max_diff;
+          num_diffs = DiffCount((float*)buf1.data(), (float*)buf2.data(), size, deleteF1, deleteF2,
+                                (float)options.abs_tol, (float)options.rel_tol, &maxf, &stats.num_delete_diffs);
+          max_diff = maxf;
+        }
+        else
+        {
+          num_diffs = DiffCount(buf1.data(), buf2.data(), size, deleteD1, deleteD2,
+                                options.abs_tol, options.rel_tol, &max_diff, &stats.num_delete_diffs);
+        }
+      }
+
+      if (max_diff > stats.max_diff)
+      {
+        stats.max_diff = max_diff;
+        stats.max_diff_tstep = i_tstep;
+      }
+      if (num_diffs > 0)
+      {
+        stats.num_diffs += num_diffs;
+        if (stats.first_diff_tstep < 0)
+          stats.first_diff_tstep = i_tstep;
+        result->equal = false;
+        // Early exit, first difference found
+        if (options.summary_only)
+        {
+          stop = true;
+          break;
+        }
+      }
+
+      if (write_diff)
+      {
+        if (is_float)
+          DiffData((float*)buf1.data(), (float*)buf2.data(), size, deleteF1, deleteF2);
+        else
+          DiffData(buf1.data(), buf2.data(), size, deleteD1, deleteD2);
+        rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time1, buf1.data());
+        CheckRc(rc, "Error writing dynamic item data to diff file");
+      }
+    }
+    result->num_timesteps = i_tstep + 1;
+  }
+
+  if (write_diff)
+  {
+    rc = dfsFileClose(pdfsWr, &fpWr);
+    CheckRc(rc, "Error closing diff file");
+    rc = dfsHeaderDestroy(&pdfsWr);
+  }
+  rc = dfsFileClose(pdfs1, &fp1);
+  rc = dfsHeaderDestroy(&pdfs1);
+  rc = dfsFileClose(pdfs2, &fp2);
+  rc = dfsHeaderDestroy(&pdfs2);
+  return F_NO_ERROR;
+}
+
+void LogDfsDiffResult(LPCTSTR file1, const DfsDiffResult& result)
+{
+  LOG("Difference statistics for %s, %ld time steps compared:", file1, result.num_timesteps);
+  if (result.first_time_diff_tstep >= 0)
+    LOG("Time differs, first at timestep %ld", result.first_time_diff_tstep);
+  for (size_t i = 0; i < result.items.size(); i++)
+  {
+    const DfsDiffItemStats& stats = result.items[i];
+    if (stats.first_diff_tstep < 0)
+    {
+      LOG("%-30s: no difference", stats.name.c_str());
+    }
+    else if (stats.num_delete_diffs == 0)
+    {
+      LOG("%-30s: Max difference at timestep %3ld: %g. First difference at timestep %ld. Differences: %ld",
+          stats.name.c_str(), stats.max_diff_tstep, stats.max_diff, stats.first_diff_tstep, stats.num_diffs);
+    }
+    else
+    {
+      LOG("%-30s: Max difference at timestep %3ld: %g. First difference at timestep %ld. Differences: %ld. DeleteValue differences: %ld",
+          stats.name.c_str(), stats.max_diff_tstep, stats.max_diff, stats.first_diff_tstep, stats.num_diffs, stats.num_delete_diffs);
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Options for comparing two dfs files.
+ * A value pair is considered equal when
+ *   |v1 - v2| <= abs_tol + rel_tol * max(|v1|, |v2|)
+ * With both tolerances zero, values must match exactly.
+ */
+struct DfsDiffOptions
+{
+  double abs_tol      = 0;     ///< Absolute tolerance
+  double rel_tol      = 0;     ///< Relative tolerance, relative to the largest of the two values
+  bool   summary_only = false; ///< Stop at the first item-timestep that differs. No diff file is written.
+};
+
+/** Difference statistics for one dynamic item */
+struct DfsDiffItemStats
+{
+  std::string name;              ///< Name of item
+  double max_diff         = 0;   ///< Largest absolute difference, where both files have values
+  long   max_diff_tstep   = -1;  ///< Time step index of max_diff, -1 if no difference
+  long   first_diff_tstep = -1;  ///< Time step index of first difference, -1 if no difference
+  long   num_diffs        = 0;   ///< Number of values outside tolerance, including delete value differences
+  long   num_delete_diffs = 0;   ///< Number of values where only one of the files has a delete value
+};
+
+/** Result of comparing two dfs files */
+struct DfsDiffResult
+{
+  bool equal         = true;  ///< True if all compared values and times are within tolerance, and the number of time steps match
+  long num_timesteps = 0;     ///< Number of time steps that were compared
+  long first_time_diff_tstep = -1;  ///< Time step index of first time that differs, in seconds by more than abs_tol, -1 if none
+  std::vector<DfsDiffItemStats> items;  ///< Statistics, one for each dynamic item
+};
+
+/**
+ * Compare the dynamic data of two dfs files with identical structure,
+ * and optionally write a file containing the difference (file1 - file2).
+ * Returns F_NO_ERROR on success, or -1 if the files are not comparable.
+ */
+long DfsDiff(LPCTSTR file1, LPCTSTR file2, LPCTSTR filediff, const DfsDiffOptions& options, DfsDiffResult* result);
+
+/** Log the statistics of a DfsDiffResult, one line for each item */
+void LogDfsDiffResult(LPCTSTR file1, const DfsDiffResult& result);
@@ -0,0 +1,182 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsDiff.h"
+#include <CppUnitTest.h>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsDiff_tests)
+  {
+  public:
+
+    /// Compare OresundHD.dfs2 with itself, summary only
+    TEST_METHOD(DfsDiffSameFileTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+
+      DfsDiffOptions options;
+      options.summary_only = true;
+      DfsDiffResult result;
+      long rc = DfsDiff(inputFullPath, inputFullPath, nullptr, options, &result);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::IsTrue(result.equal);
+      Assert::AreEqual((long)13, result.num_timesteps);
+      Assert::AreEqual((size_t)3, result.items.size());
+      Assert::AreEqual((long)-1, result.items[0].first_diff_tstep);
+    }
+
+    /// Compare with a copy where one value has been modified, with and without tolerance
+    TEST_METHOD(DfsDiffToleranceTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char modifiedFullPath[_MAX_PATH];
+      snprintf(modifiedFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_DfsDiffModified.dfs2");
+      char diffFullPath[_MAX_PATH];
+      snprintf(diffFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_DfsDiff.dfs2");
+
+      // Time step 2, item 1, cell (3,4) is modified by 0.01
+      int index34 = 71 * 4 + 3;
+      CreateModifiedCopy(inputFullPath, modifiedFullPath, 2, 1, index34, 0.01f);
+
+      DfsDiffOptions options;
+      DfsDiffResult result;
+      long rc = DfsDiff(inputFullPath, modifiedFullPath, diffFullPath, options, &result);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      LogDfsDiffResult(inputFullPath, result);
+      Assert::IsFalse(result.equal);
+      Assert::AreEqual((long)13, result.num_timesteps);
+      Assert::AreEqual((long)2, result.items[0].first_diff_tstep);
+      Assert::AreEqual((long)1, result.items[0].num_diffs);
+      Assert::AreEqual(0.01, result.items[0].max_diff, 1e-5);
+      Assert::AreEqual((long)-1, result.items[1].first_diff_tstep);
+
+      // Summary mode stops at the first difference
+      options.summary_only = true;
+      rc = DfsDiff(inputFullPath, modifiedFullPath, nullptr, options, &result);
+      Assert::IsFalse(result.equal);
+      Assert::AreEqual((long)3, result.num_timesteps);
+
+      // Difference is within tolerance
+      options.abs_tol = 0.1;
+      rc = DfsDiff(inputFullPath, modifiedFullPath, nullptr, options, &result);
+      Assert::IsTrue(result.equal);
+      Assert::AreEqual((long)13, result.num_timesteps);
+
+      // Check value in diff file
+      LPHEAD pdfs;
+      LPFILE fp;
+      rc = dfsFileRead(diffFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening diff file");
+      float* data = new float[dfsGetItemElements(dfsItemD(pdfs, 1))];
+      double time;
+      rc = dfsFindItemDynamic(pdfs, fp, 2, 1);
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data);
+      Assert::AreEqual(-0.01f, data[index34], 1e-5f);
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      delete[] data;
+    }
+
+    /// Compare with a copy of the first 5 time steps: The files differ, the common time steps being equal
+    TEST_METHOD(DfsDiffTruncatedTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char truncatedFullPath[_MAX_PATH];
+      snprintf(truncatedFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_DfsDiffTruncated.dfs2");
+      DfsTimeWindow window;
+      window.end = 4;
+      Assert::AreEqual((long)F_NO_ERROR, CopyDfsFileTimeWindow(inputFullPath, truncatedFullPath, window));
+
+      DfsDiffOptions options;
+      DfsDiffResult result;
+      long rc = DfsDiff(inputFullPath, truncatedFullPath, nullptr, options, &result);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::IsFalse(result.equal);
+      Assert::AreEqual((long)5, result.num_timesteps);
+      Assert::AreEqual((long)-1, result.items[0].first_diff_tstep);
+      Assert::AreEqual((long)0, result.items[0].num_diffs);
+    }
+
+    /// Compare with a copy having the same values, on a time axis starting one hour later
+    TEST_METHOD(DfsDiffTimeShiftTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char shiftedFullPath[_MAX_PATH];
+      snprintf(shiftedFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_DfsDiffShifted.dfs2");
+      CreateModifiedCopy(inputFullPath, shiftedFullPath, 0, 1, 0, 0, 3600);
+
+      DfsDiffOptions options;
+      DfsDiffResult result;
+      long rc = DfsDiff(inputFullPath, shiftedFullPath, nullptr, options, &result);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::IsFalse(result.equal);
+      Assert::AreEqual((long)13, result.num_timesteps);
+      Assert::AreEqual((long)0, result.first_time_diff_tstep);
+      Assert::AreEqual((long)0, result.items[0].num_diffs);
+
+      // Time difference within tolerance, in seconds
+      options.abs_tol = 3600;
+      rc = DfsDiff(inputFullPath, shiftedFullPath, nullptr, options, &result);
+      Assert::IsTrue(result.equal);
+      Assert::AreEqual((long)-1, result.first_time_diff_tstep);
+    }
+
+    /// Copy a file with float items, adding delta to one value, and moving the start of an equidistant calendar axis by shift_sec
+    static void CreateModifiedCopy(LPCTSTR inputFullPath, LPCTSTR outputFullPath, int tstep, int item, int index, float delta, double shift_sec = 0)
+    {
+      LPHEAD pdfsIn, pdfsWr;
+      LPFILE fpIn, fpWr;
+      long rc = dfsFileRead(inputFullPath, &pdfsIn, &fpIn);
+      CheckRc(rc, "Error opening file");
+      long num_items = dfsGetNoOfItems(pdfsIn);
+      long num_timesteps = CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+      if (shift_sec != 0)
+      {
+        TimeAxisType taxis_type;
+        LPCTSTR start_date, start_time;
+        double tstart, tstep_unit, tspan;
+        long n, neum_unit, tindex;
+        GetDfsTimeAxis(pdfsIn, &taxis_type, &n, &start_date, &start_time, &tstart, &tstep_unit, &tspan, &neum_unit, &tindex);
+        Assert::AreEqual((int)F_CAL_EQ_AXIS, (int)taxis_type);
+        char date[11], time[9];
+        DfsSecondsToDateTime(DfsDateTimeToSeconds(start_date, start_time) + shift_sec, date, time);
+        rc = dfsSetEqCalendarAxis(pdfsWr, date, time, neum_unit, tstart, tstep_unit, tindex);
+        CheckRc(rc, "Error setting time axis");
+      }
+      CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+      rc = dfsFileCreate(outputFullPath, pdfsWr, &fpWr);
+      CheckRc(rc, "Error creating file");
+      CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
+
+      float* data = new float[dfsGetItemElements(dfsItemD(pdfsIn, item))];
+      double time;
+      for (int i_tstep = 0; i_tstep < num_timesteps; i_tstep++)
+      {
+        for (int i_item = 1; i_item <= num_items; i_item++)
+        {
+          rc = dfsReadItemTimeStep(pdfsIn, fpIn, &time, data);
+          CheckRc(rc, "Error reading dynamic item data");
+          if (i_tstep == tstep && i_item == item)
+            data[index] += delta;
+          rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time, data);
+          CheckRc(rc, "Error writing dynamic item data");
+        }
+      }
+      rc = dfsFileClose(pdfsWr, &fpWr);
+      rc = dfsHeaderDestroy(&pdfsWr);
+      rc = dfsFileClose(pdfsIn, &fpIn);
+      rc = dfsHeaderDestroy(&pdfsIn);
+      delete[] data;
+    }
+
+  };
+}
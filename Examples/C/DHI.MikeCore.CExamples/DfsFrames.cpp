@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsFrames.h"
+
+#include <CppUnitTestLogger.h>
+#include <thread>
+
+
+void DfsFrameReaderOpen(LPHEAD pdfs, LPFILE fp, const DfsFrameFilter& filter, DfsFrameReader* reader)
+{
+  reader->pdfs = pdfs;
+  reader->fp = fp;
+  reader->filter = filter;
+  reader->num_file_items = dfsGetNoOfItems(pdfs);
+  reader->items = filter.items;
+  if (reader->items.empty())
+  {
+    for (int i_item = 1; i_item <= reader->num_file_items; i_item++)
+      reader->items.push_back(i_item);
+  }
+  size_t n = reader->items.size();
+  reader->num_elmts.resize(n);
+  reader->buffers.resize(n);
+  reader->data.resize(n);
+  for (size_t k = 0; k < n; k++)
+  {
+    LPITEM item = dfsItemD(pdfs, reader->items[k]);
+    reader->num_elmts[k] = dfsGetItemElements(item);
+    // double, for alignment of both float and double data
+    reader->buffers[k].resize((dfsGetItemBytes(item) + sizeof(double) - 1) / sizeof(double));
+    reader->data[k] = reader->buffers[k].data();
+  }
+
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+  reader->count = GetDfsTimeWindowCount(filter.window, num_timesteps);
+  reader->next = 0;
+  reader->pos_tstep = -1;
+  reader->pos_item = -1;
+  reader->frame.items = std::span<const int>(reader->items);
+  reader->frame.data = std::span<void* const>(reader->data);
+  reader->frame.num_elmts = std::span<const long>(reader->num_elmts);
+}
+
+bool DfsFrameReaderNext(DfsFrameReader* reader)
+{
+  if (reader->next >= reader->count)
+    return false;
+  long tstep = reader->filter.window.start + reader->next * reader->filter.window.stride;
+  long rc;
+  for (size_t k = 0; k < reader->items.size(); k++)
+  {
+    int i_item = reader->items[k];
+    // Seek only if the file pointer is not already at the item-timestep
+    if (reader->pos_tstep != tstep || reader->pos_item != i_item)
+    {
+      rc = dfsFindItemDynamic(reader->pdfs, reader->fp, tstep, i_item);
+      CheckRc(rc, "Error finding item-timestep");
+    }
+    double time;
+    rc = dfsReadItemTimeStep(reader->pdfs, reader->fp, &time, reader->data[k]);
+    CheckRc(rc, "Error reading dynamic item data");
+    if (k == 0)
+      reader->frame.time = time;
+    reader->pos_tstep = i_item < reader->num_file_items ? tstep : tstep + 1;
+    reader->pos_item = i_item < reader->num_file_items ? i_item + 1 : 1;
+  }
+  reader->frame.tstep = tstep;
+  reader->next++;
+  return true;
+}
+
+DfsGenerator<const DfsFrame&> DfsReadFrames(LPHEAD pdfs, LPFILE fp, DfsFrameFilter filter)
+{
+  DfsFrameReader reader;
+  DfsFrameReaderOpen(pdfs, fp, filter, &reader);
+  while (DfsFrameReaderNext(&reader))
+    co_yield reader.frame;
+}
+
+/** Reader thread: Read the frame of each awaiting coroutine, and resume it on this thread */
+static void DfsFrameReaderThreadRun(std::shared_ptr<DfsFrameReaderThread> worker)
+{
+  for (;;)
+  {
+    DfsFrameAwaitable* awaitable;
+    std::coroutine_handle<> handle;
+    {
+      std::unique_lock<std::mutex> lock(worker->mtx);
+      worker->cv.wait(lock, [&] { return worker->stop || worker->pending; });
+      // A frame awaited before stopping is still read, such that its coroutine is resumed
+      if (!worker->pending)
+        return;
+      awaitable = std::exchange(worker->pending, nullptr);
+      handle = std::exchange(worker->handle, nullptr);
+    }
+    // The awaitable lives in the suspended coroutine frame until resumed
+    awaitable->result = DfsFrameReaderNext(awaitable->reader);
+    handle.resume();
+  }
+}
+
+void DfsFrameAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+  if (!reader->worker)
+  {
+    reader->worker = std::make_shared<DfsFrameReaderThread>();
+    reader->worker->thread = std::thread(DfsFrameReaderThreadRun, reader->worker);
+  }
+  std::lock_guard<std::mutex> lock(reader->worker->mtx);
+  reader->worker->pending = this;
+  reader->worker->handle = handle;
+  reader->worker->cv.notify_one();
+}
+
+void DfsFrameReaderClose(DfsFrameReader* reader)
+{
+  std::shared_ptr<DfsFrameReaderThread> worker = std::move(reader->worker);
+  if (!worker)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(worker->mtx);
+    worker->stop = true;
+  }
+  worker->cv.notify_one();
+  // A coroutine resumed on the reader thread may itself destroy the reader. The thread
+  // then ends when the coroutine suspends or returns, owning its state.
+  if (worker->thread.get_id() == std::this_thread::get_id())
+    worker->thread.detach();
+  else
+    worker->thread.join();
+}
+
+DfsFrameReader::~DfsFrameReader()
+{
+  DfsFrameReaderClose(this);
+}
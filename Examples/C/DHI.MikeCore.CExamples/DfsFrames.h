@@ -0,0 +1,238 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Time step iteration with C++20 coroutines.
+ *
+ * Instead of a manual loop over time steps and items, reading every item-timestep,
+ * DfsReadFrames is a generator yielding one frame per time step: the time and the
+ * data of the requested items. Frames are read lazily, when the consumer asks for the
+ * next one, and a filter selects items and time steps, such that item-timesteps nobody
+ * asks for are never read: The reader seeks past them with dfsFindItemDynamic, and
+ * reads sequentially where it can.
+ *
+ *   DfsFrameFilter filter = DfsFrameFilter().Items({ 1, 3 }).Window(2, 10).Stride(2);
+ *   for (const DfsFrame& frame : DfsReadFrames(pdfs, fp, filter))
+ *   {
+ *     std::span<float> h = frame.Item<float>(0);   // item 1
+ *     ...
+ *   }
+ *
+ * The async variant, DfsReadFrameAsync, is awaited in a coroutine, which is suspended
+ * while the frame is read on the reader thread, and resumed on that thread when read.
+ * Each DfsFrameReader has one long-lived reader thread, started by the first
+ * DfsReadFrameAsync, and stopped by DfsFrameReaderClose or when the reader is destroyed.
+ */
+
+/** Item and time step selection of frames, composable as DfsFrameFilter().Items(...).Window(...).Stride(...) */
+struct DfsFrameFilter
+{
+  std::vector<int> items;      ///< Item numbers, 1 based, in the order of the frame. Empty for all items
+  DfsTimeWindow    window;     ///< Time steps
+
+  DfsFrameFilter& Items(std::vector<int> item_numbers) { items = std::move(item_numbers); return *this; }
+  DfsFrameFilter& Window(long start, long end) { window.start = start; window.end = end; return *this; }
+  DfsFrameFilter& Stride(long stride) { window.stride = stride; return *this; }
+};
+
+/** One time step of the selected items. Data is valid until the next frame is read. */
+struct DfsFrame
+{
+  long   tstep = -1;                  ///< Time step in file, zero based
+  double time = 0;                    ///< Time, as returned by dfsReadItemTimeStep for the first item
+  std::span<const int>   items;       ///< Item numbers of the frame
+  std::span<void* const> data;        ///< Data of each item of the frame
+  std::span<const long>  num_elmts;   ///< Number of elements of each item of the frame
+
+  /** Data of the k'th item of the frame, T matching the data type of the item */
+  template <typename T>
+  std::span<T> Item(size_t k) const { return std::span<T>((T*)data[k], (size_t)num_elmts[k]); }
+};
+
+struct DfsFrameAwaitable;
+
+/** Reader thread of a DfsFrameReader, reading the frames awaited with DfsReadFrameAsync */
+struct DfsFrameReaderThread
+{
+  std::thread             thread;
+  std::mutex              mtx;
+  std::condition_variable cv;
+  DfsFrameAwaitable*      pending = nullptr;  ///< Awaitable of the suspended coroutine, null if none
+  std::coroutine_handle<> handle;             ///< Suspended coroutine, resumed when its frame is read
+  bool                    stop = false;
+};
+
+/**
+ * State of a frame scan: The filter, one buffer per item, and the file position,
+ * such that sequential item-timesteps are read without seeking.
+ */
+struct DfsFrameReader
+{
+  DfsFrameReader() = default;
+  DfsFrameReader(const DfsFrameReader&) = delete;
+  ~DfsFrameReader();
+
+  LPHEAD pdfs = nullptr;
+  LPFILE fp = nullptr;
+  DfsFrameFilter filter;
+  long count = 0;                         ///< Number of frames
+  long next = 0;                          ///< Index of the next frame, 0..count
+  std::vector<int>  items;
+  std::vector<long> num_elmts;
+  std::vector<std::vector<double>> buffers;
+  std::vector<void*> data;
+  long num_file_items = 0;
+  long pos_tstep = -1, pos_item = -1;     ///< Item-timestep the file pointer is at, -1 if unknown
+  DfsFrame frame;
+  std::shared_ptr<DfsFrameReaderThread> worker;  ///< Reader thread of DfsReadFrameAsync, null until first used
+};
+
+/** Set up reader for the filter. The file pointer may be anywhere. */
+void DfsFrameReaderOpen(LPHEAD pdfs, LPFILE fp, const DfsFrameFilter& filter, DfsFrameReader* reader);
+
+/** Read the next frame into reader->frame. Returns false when all frames are read. */
+bool DfsFrameReaderNext(DfsFrameReader* reader);
+
+/** Stop the reader thread, if started. Must be called before the file is closed, if not destroyed before. */
+void DfsFrameReaderClose(DfsFrameReader* reader);
+
+
+/** Minimal generator, a range of the values yielded by a coroutine */
+template <typename T>
+class DfsGenerator
+{
+public:
+  struct promise_type
+  {
+    const std::remove_reference_t<T>* value = nullptr;
+    DfsGenerator get_return_object() { return DfsGenerator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(const std::remove_reference_t<T>& v) noexcept { value = &v; return {}; }
+    void return_void() {}
+    void unhandled_exception() { throw; }
+  };
+
+  struct iterator
+  {
+    std::coroutine_handle<promise_type> handle;
+    iterator& operator++() { handle.resume(); return *this; }
+    const std::remove_reference_t<T>& operator*() const { return *handle.promise().value; }
+    bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+  };
+
+  explicit DfsGenerator(std::coroutine_handle<promise_type> h) : handle(h) {}
+  DfsGenerator(DfsGenerator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+  DfsGenerator(const DfsGenerator&) = delete;
+  ~DfsGenerator() { if (handle) handle.destroy(); }
+
+  iterator begin() { handle.resume(); return iterator{ handle }; }
+  std::default_sentinel_t end() { return {}; }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+/** Generator of the frames of the filter, read lazily */
+DfsGenerator<const DfsFrame&> DfsReadFrames(LPHEAD pdfs, LPFILE fp, DfsFrameFilter filter = DfsFrameFilter());
+
+
+/** Awaitable reading the next frame on the reader thread, co_await giving false when all frames are read */
+struct DfsFrameAwaitable
+{
+  DfsFrameReader* reader;
+  bool result = false;
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle);
+  bool await_resume() const noexcept { return result; }
+};
+
+/** Read the next frame of reader into reader->frame, suspending the awaiting coroutine while reading */
+inline DfsFrameAwaitable DfsReadFrameAsync(DfsFrameReader* reader) { return DfsFrameAwaitable{ reader }; }
+
+/**
+ * Minimal coroutine task, for running a coroutine awaiting DfsReadFrameAsync from
+ * ordinary code: The coroutine starts when called, and Wait blocks until it completes.
+ */
+class DfsTask
+{
+  struct State
+  {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+    std::exception_ptr exception;
+  };
+
+public:
+  struct promise_type
+  {
+    std::shared_ptr<State> state = std::make_shared<State>();
+    DfsTask get_return_object() { return DfsTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    auto final_suspend() noexcept
+    {
+      // Signal completion through the shared state, which outlives the coroutine frame
+      struct Signal
+      {
+        std::shared_ptr<State> state;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) const noexcept
+        {
+          std::lock_guard<std::mutex> lock(state->mtx);
+          state->done = true;
+          state->cv.notify_all();
+        }
+        void await_resume() const noexcept {}
+      };
+      return Signal{ state };
+    }
+    void return_void() {}
+    void unhandled_exception() { state->exception = std::current_exception(); }
+  };
+
+  explicit DfsTask(std::coroutine_handle<promise_type> h) : handle(h), state(h.promise().state) {}
+  DfsTask(DfsTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)), state(std::move(other.state)) {}
+  DfsTask(const DfsTask&) = delete;
+  ~DfsTask()
+  {
+    WaitDone();
+    if (handle)
+      handle.destroy();
+  }
+
+  /** Wait for the coroutine to complete, rethrowing its exception */
+  void Wait()
+  {
+    WaitDone();
+    if (state && state->exception)
+      std::rethrow_exception(std::exchange(state->exception, nullptr));
+  }
+
+private:
+  void WaitDone()
+  {
+    if (!state)
+      return;
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->cv.wait(lock, [&] { return state->done; });
+  }
+
+  std::coroutine_handle<promise_type> handle;
+  std::shared_ptr<State> state;
+};
@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsFrames.h"
+#include <CppUnitTest.h>
+
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  /// Sum of item values of all frames, reading frames asynchronously
+  static DfsTask SumFramesAsync(DfsFrameReader* reader, float delete_value, double* sum, long* num_frames)
+  {
+    while (co_await DfsReadFrameAsync(reader))
+    {
+      for (float v : reader->frame.Item<float>(0))
+        if (v != delete_value)
+          *sum += v;
+      (*num_frames)++;
+    }
+  }
+
+  TEST_CLASS(DfsFrames_tests)
+  {
+  public:
+
+    /// Iterate frames of OresundHD.dfs2, all items and a filtered subset
+    TEST_METHOD(ReadFramesTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+
+      long num_frames = 0;
+      for (const DfsFrame& frame : DfsReadFrames(pdfs, fp))
+      {
+        Assert::AreEqual(num_frames, frame.tstep);
+        Assert::AreEqual((size_t)3, frame.items.size());
+        Assert::AreEqual((size_t)(71 * 91), frame.Item<float>(0).size());
+        if (frame.tstep == 2)
+          Assert::AreEqual(11.3634329f, frame.Item<float>(0)[71 * 4 + 3]);
+        num_frames++;
+      }
+      Assert::AreEqual(13L, num_frames);
+
+      // Item 1 of time steps 2, 5, 8 only
+      std::vector<long> tsteps;
+      for (const DfsFrame& frame : DfsReadFrames(pdfs, fp, DfsFrameFilter().Items({ 1 }).Window(2, 9).Stride(3)))
+      {
+        Assert::AreEqual(1, frame.items[0]);
+        if (frame.tstep == 2)
+          Assert::AreEqual(11.3634329f, frame.Item<float>(0)[71 * 4 + 3]);
+        tsteps.push_back(frame.tstep);
+      }
+      Assert::AreEqual((size_t)3, tsteps.size());
+      Assert::AreEqual(8L, tsteps[2]);
+
+      // Stopping early reads no further
+      for (const DfsFrame& frame : DfsReadFrames(pdfs, fp, DfsFrameFilter().Window(4, -1)))
+      {
+        Assert::AreEqual(4L, frame.tstep);
+        break;
+      }
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+    /// Asynchronous frames give the same values as the generator
+    TEST_METHOD(ReadFramesAsyncTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      float delete_value = dfsGetDeleteValFloat(pdfs);
+      DfsFrameFilter filter = DfsFrameFilter().Items({ 2 }).Stride(2);
+
+      double sum = 0;
+      long num_frames = 0;
+      for (const DfsFrame& frame : DfsReadFrames(pdfs, fp, filter))
+      {
+        for (float v : frame.Item<float>(0))
+          if (v != delete_value)
+            sum += v;
+        num_frames++;
+      }
+      Assert::AreEqual(7L, num_frames);
+
+      DfsFrameReader reader;
+      DfsFrameReaderOpen(pdfs, fp, filter, &reader);
+      double sum_async = 0;
+      long num_frames_async = 0;
+      DfsTask task = SumFramesAsync(&reader, delete_value, &sum_async, &num_frames_async);
+      task.Wait();
+      Assert::AreEqual(num_frames, num_frames_async);
+      Assert::AreEqual(sum, sum_async);
+      DfsFrameReaderClose(&reader);
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+  };
+}
@@ -0,0 +1,130 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsHandlePool.h"
+
+#include <CppUnitTestLogger.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+
+DfsPoolLease::DfsPoolLease(DfsPoolLease&& other) noexcept
+  : pool(std::exchange(other.pool, nullptr)), pdfs(std::exchange(other.pdfs, nullptr)), fp(std::exchange(other.fp, nullptr))
+{
+}
+
+DfsPoolLease& DfsPoolLease::operator=(DfsPoolLease&& other) noexcept
+{
+  if (this != &other)
+  {
+    Release();
+    pool = std::exchange(other.pool, nullptr);
+    pdfs = std::exchange(other.pdfs, nullptr);
+    fp = std::exchange(other.fp, nullptr);
+  }
+  return *this;
+}
+
+DfsPoolLease::~DfsPoolLease()
+{
+  Release();
+}
+
+void DfsPoolLease::Release()
+{
+  if (!pool || !pdfs)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(pool->mtx);
+    pool->idle.push_back(DfsHandlePool::Handle{ pdfs, fp });
+  }
+  pool->cv.notify_one();
+  pool = nullptr;
+  pdfs = nullptr;
+  fp = nullptr;
+}
+
+DfsHandlePool::~DfsHandlePool()
+{
+  for (Handle& handle : idle)
+  {
+    dfsFileClose(handle.pdfs, &handle.fp);
+    dfsHeaderDestroy(&handle.pdfs);
+  }
+}
+
+void DfsHandlePoolInit(DfsHandlePool* pool, LPCTSTR filename, int max_handles)
+{
+  pool->path = filename;
+  pool->max_handles = max_handles > 0 ? max_handles : std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+DfsPoolLease DfsHandlePoolAcquire(DfsHandlePool* pool)
+{
+  std::unique_lock<std::mutex> lock(pool->mtx);
+  pool->cv.wait(lock, [&] { return !pool->idle.empty() || pool->num_open < pool->max_handles; });
+  if (!pool->idle.empty())
+  {
+    DfsHandlePool::Handle handle = pool->idle.back();
+    pool->idle.pop_back();
+    return DfsPoolLease(pool, handle.pdfs, handle.fp);
+  }
+
+  // Open a new handle, without holding the lock
+  pool->num_open++;
+  lock.unlock();
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(pool->path.c_str(), &pdfs, &fp);
+  if (rc != F_NO_ERROR)
+  {
+    LOG("Error opening file %s (%li - %s)\n", pool->path.c_str(), rc, GetRCString(rc));
+    lock.lock();
+    pool->num_open--;
+    lock.unlock();
+    pool->cv.notify_one();
+    return DfsPoolLease();
+  }
+  return DfsPoolLease(pool, pdfs, fp);
+}
+
+long DfsHandlePoolForEachTimeStep(DfsHandlePool* pool, long num_timesteps, int num_threads,
+                                  const std::function<void(long tstep, LPHEAD pdfs, LPFILE fp)>& func)
+{
+  // More threads than handles would wait for each other
+  if (num_threads < 1 || num_threads > pool->max_handles)
+    num_threads = pool->max_handles;
+
+  // Time steps are handed out one at a time, such that the threads having a handle process
+  // all time steps, also when some threads could not open the file
+  std::atomic<long> next_tstep(0);
+  std::atomic<long> num_processed(0);
+  std::atomic<int>  num_leased(0);
+  std::vector<std::thread> threads;
+  for (int i_thread = 0; i_thread < num_threads; i_thread++)
+  {
+    threads.emplace_back([=, &func, &next_tstep, &num_processed, &num_leased]()
+    {
+      DfsPoolLease lease = DfsHandlePoolAcquire(pool);
+      if (!lease)
+        return;
+      num_leased++;
+      for (long tstep = next_tstep++; tstep < num_timesteps; tstep = next_tstep++)
+      {
+        long rc = dfsFindTimeStep(lease.pdfs, lease.fp, tstep);
+        CheckRc(rc, "Error finding time step");
+        func(tstep, lease.pdfs, lease.fp);
+        num_processed++;
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  // Failing leases are logged by DfsHandlePoolAcquire
+  if (num_leased == 0)
+    return -1;
+  return num_processed;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Pool of read handles of one file, for concurrent reads.
+ *
+ * An LPFILE has a single file position, and the header is updated by reads as well,
+ * so two threads can not read different time steps through the same pdfs and fp.
+ * The pool hands out leases of handles, an opened pdfs and fp each, such that every
+ * worker thread has its own positioned reader of the file. Handles are opened when
+ * first needed, up to max_handles, and are reused by later leases, such that the file
+ * is not opened again for every read.
+ *
+ * Handles share nothing: each is a full dfsFileRead, which opens the file and reads and
+ * parses the header and the static items again. The first lease of a handle therefore costs
+ * as much as opening the file, and the header and static data are held once per open handle.
+ *
+ *   DfsHandlePool pool;
+ *   DfsHandlePoolInit(&pool, filename);
+ *   // In each worker thread
+ *   DfsPoolLease lease = DfsHandlePoolAcquire(&pool);
+ *   rc = dfsFindItemDynamic(lease.pdfs, lease.fp, tstep, item);
+ *   ...
+ */
+
+struct DfsHandlePool;
+
+/** An opened pdfs and fp of a pool, returned to the pool when the lease is destroyed */
+struct DfsPoolLease
+{
+  DfsHandlePool* pool = nullptr;
+  LPHEAD pdfs = nullptr;
+  LPFILE fp = nullptr;
+
+  DfsPoolLease() = default;
+  DfsPoolLease(DfsHandlePool* pool, LPHEAD pdfs, LPFILE fp) : pool(pool), pdfs(pdfs), fp(fp) {}
+  DfsPoolLease(DfsPoolLease&& other) noexcept;
+  DfsPoolLease& operator=(DfsPoolLease&& other) noexcept;
+  DfsPoolLease(const DfsPoolLease&) = delete;
+  ~DfsPoolLease();
+
+  /** Return the handle to the pool, before the lease is destroyed */
+  void Release();
+
+  /** False if the file could not be opened */
+  explicit operator bool() const { return pdfs != nullptr; }
+};
+
+/** Opened handles of a file, those not leased being idle */
+struct DfsHandlePool
+{
+  std::string path;
+  int         max_handles = 0;    ///< Maximum number of open handles
+  int         num_open = 0;       ///< Number of open handles, idle or leased
+
+  struct Handle
+  {
+    LPHEAD pdfs;
+    LPFILE fp;
+  };
+  std::vector<Handle>     idle;
+  std::mutex              mtx;
+  std::condition_variable cv;
+
+  DfsHandlePool() = default;
+  DfsHandlePool(const DfsHandlePool&) = delete;
+  /** Closes the idle handles. All leases must be returned first. */
+  ~DfsHandlePool();
+};
+
+/** Set up pool of filename, with up to max_handles handles, 0 for the number of hardware threads. No file is opened. */
+void DfsHandlePoolInit(DfsHandlePool* pool, LPCTSTR filename, int max_handles = 0);
+
+/**
+ * Lease a handle, an idle one if any, or a newly opened one, waiting for a lease to be returned
+ * if max_handles are in use. The file position of the handle is undefined.
+ * Returns an empty lease if the file can not be opened. Thread safe.
+ */
+DfsPoolLease DfsHandlePoolAcquire(DfsHandlePool* pool);
+
+/**
+ * Call func(tstep, pdfs, fp) for each of num_timesteps time steps, on num_threads threads, each
+ * thread with its own handle, taking the next time step not yet taken. When func is called, the
+ * file position is at the first item of the time step. 0 threads for the max_handles of the pool.
+ * Threads that can not open the file do not take any time steps, the others processing them all.
+ * Returns the number of time steps processed, or -1 if no thread could open the file.
+ */
+long DfsHandlePoolForEachTimeStep(DfsHandlePool* pool, long num_timesteps, int num_threads,
+                                  const std::function<void(long tstep, LPHEAD pdfs, LPFILE fp)>& func);
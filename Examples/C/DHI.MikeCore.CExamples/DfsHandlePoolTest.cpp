@@ -0,0 +1,93 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsHandlePool.h"
+#include <CppUnitTest.h>
+
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsHandlePool_tests)
+  {
+  public:
+
+    /// Leases reuse idle handles, and are limited to max_handles
+    TEST_METHOD(HandlePoolLeaseTest)
+    {
+      char filename[_MAX_PATH];
+      snprintf(filename, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      DfsHandlePool pool;
+      DfsHandlePoolInit(&pool, filename, 2);
+      {
+        DfsPoolLease lease1 = DfsHandlePoolAcquire(&pool);
+        DfsPoolLease lease2 = DfsHandlePoolAcquire(&pool);
+        Assert::IsTrue((bool)lease1 && (bool)lease2);
+        Assert::IsTrue(lease1.fp != lease2.fp);
+        Assert::AreEqual(2, pool.num_open);
+        LPFILE fp1 = lease1.fp;
+        lease1.Release();
+        DfsPoolLease lease3 = DfsHandlePoolAcquire(&pool);
+        Assert::IsTrue(lease3.fp == fp1);
+      }
+      Assert::AreEqual(2, pool.num_open);
+      Assert::AreEqual((size_t)2, pool.idle.size());
+
+      DfsHandlePool missing;
+      DfsHandlePoolInit(&missing, "nonexisting.dfs2", 1);
+      Assert::IsFalse((bool)DfsHandlePoolAcquire(&missing));
+      Assert::AreEqual(0, missing.num_open);
+    }
+
+    /// Parallel per time step sums of OresundHD.dfs2 item 1 match a sequential read
+    TEST_METHOD(HandlePoolForEachTimeStepTest)
+    {
+      char filename[_MAX_PATH];
+      snprintf(filename, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(filename, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      float delete_value = dfsGetDeleteValFloat(pdfs);
+      std::vector<double> expected(13, 0);
+      std::vector<float> data(71 * 91);
+      double time;
+      for (long tstep = 0; tstep < 13; tstep++)
+      {
+        rc = dfsFindItemDynamic(pdfs, fp, tstep, 1);
+        rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+        CheckRc(rc, "Error reading item-timestep");
+        for (float v : data)
+          if (v != delete_value)
+            expected[tstep] += v;
+      }
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+
+      DfsHandlePool pool;
+      DfsHandlePoolInit(&pool, filename, 4);
+      std::vector<double> sums(13, 0);
+      long num_processed = DfsHandlePoolForEachTimeStep(&pool, 13, 4, [&](long tstep, LPHEAD pdfs, LPFILE fp)
+      {
+        std::vector<float> values(71 * 91);
+        double time;
+        long rc = dfsReadItemTimeStep(pdfs, fp, &time, values.data());
+        CheckRc(rc, "Error reading item-timestep");
+        for (float v : values)
+          if (v != delete_value)
+            sums[tstep] += v;
+      });
+      Assert::AreEqual(13L, num_processed);
+      for (long tstep = 0; tstep < 13; tstep++)
+        Assert::AreEqual(expected[tstep], sums[tstep]);
+      // A thread may return its handle before another thread leases one
+      Assert::IsTrue(pool.num_open >= 1 && pool.num_open <= 4);
+    }
+
+  };
+}
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsMerge.h"
+#include "DfsPrefetch.h"
+
+#include <CppUnitTestLogger.h>
+#include <vector>
+
+
+void MergeDfsFileItems(LPCTSTR targetFilename, LPCTSTR* sourceFilenames, int num_sources, int prefetch_tsteps)
+{
+  long rc;
+  if (prefetch_tsteps < 1)
+    prefetch_tsteps = 1;
+
+  // Open all sources
+  std::vector<LPHEAD> pdfs(num_sources);
+  std::vector<LPFILE> fps(num_sources);
+  std::vector<long> num_items(num_sources);
+  long total_items = 0;
+  long min_num_timesteps = 0;
+  for (int j = 0; j < num_sources; j++)
+  {
+    rc = dfsFileRead(sourceFilenames[j], &pdfs[j], &fps[j]);
+    CheckRc(rc, "Error opening source file");
+    num_items[j] = dfsGetNoOfItems(pdfs[j]);
+    total_items += num_items[j];
+
+    TimeAxisType taxis_type;
+    LPCTSTR start_date, start_time;
+    double tstart, tstep, tspan;
+    long num_timesteps, neum_unit, index;
+    GetDfsTimeAxis(pdfs[j], &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+    if (j == 0 || num_timesteps < min_num_timesteps)
+      min_num_timesteps = num_timesteps;
+  }
+
+  // Use the first file as skeleton for header and static items.
+  LPHEAD pdfsWr;
+  LPFILE fpWr;
+  CreateDfsHeaderFromSource(pdfs[0], &pdfsWr, total_items);
+  long item_offset = 0;
+  for (int j = 0; j < num_sources; j++)
+  {
+    CopyDfsDynamicItemInfo(pdfs[j], pdfsWr, num_items[j], item_offset);
+    item_offset += num_items[j];
+  }
+  rc = dfsFileCreate(targetFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating target file");
+  // Copy static items - add only from main file
+  CopyDfsStaticItems(pdfs[0], fps[0], pdfsWr, fpWr);
+
+  // Position all sources at the first item-timestep, and start a prefetching reader for each
+  std::vector<DfsPrefetchReader> sources(num_sources);
+  for (int j = 0; j < num_sources; j++)
+  {
+    rc = dfsFindBlockDynamic(pdfs[j], fps[j]);
+    CheckRc(rc, "Error finding dynamic data");
+    DfsPrefetchStart(pdfs[j], fps[j], &sources[j], prefetch_tsteps, min_num_timesteps);
+  }
+
+  // Write time steps, all items of the first source, then all items of the second source, etc.
+  for (long i_tstep = 0; i_tstep < min_num_timesteps; i_tstep++)
+  {
+    for (int j = 0; j < num_sources; j++)
+    {
+      DfsPrefetchReader& src = sources[j];
+      if (!DfsPrefetchNext(&src))
+        CheckRc(src.rc, "Error reading dynamic item data");
+      for (int i_item = 1; i_item <= src.num_items; i_item++)
+      {
+        rc = dfsWriteItemTimeStep(pdfsWr, fpWr, DfsPrefetchItemTime(&src, i_item), DfsPrefetchItemData(&src, i_item));
+        CheckRc(rc, "Error writing dynamic item data");
+      }
+    }
+  }
+
+  for (int j = 0; j < num_sources; j++)
+    DfsPrefetchStop(&sources[j]);
+
+  // Close files and destroy headers
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing target file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  for (int j = 0; j < num_sources; j++)
+  {
+    rc = dfsFileClose(pdfs[j], &fps[j]);
+    rc = dfsHeaderDestroy(&pdfs[j]);
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+/**
+ * Merge two or more dfs files into one. The merger is on dynamic item basis,
+ * i.e. add all dynamic items of a number of dfs files to a new dfs file,
+ * in the order of the source files. Header and static data is copied from the first file.
+ *
+ * It is assumed that all files has the same time stepping layout. It will merge
+ * as many time steps as the file with the least number of timesteps.
+ *
+ * Each source file is read by its own prefetching reader, see DfsPrefetch.h, which reads up to
+ * prefetch_tsteps time steps ahead. Memory usage is bounded by
+ * prefetch_tsteps times the size of one time step of all items.
+ */
+void MergeDfsFileItems(LPCTSTR targetFilename, LPCTSTR* sourceFilenames, int num_sources, int prefetch_tsteps = 2);
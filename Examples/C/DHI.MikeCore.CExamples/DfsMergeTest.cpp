@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsMerge.h"
+#include <CppUnitTest.h>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsMerge_tests)
+  {
+  public:
+
+    /// Merge OresundHD.dfs2 with itself, giving a file with 6 items
+    TEST_METHOD(MergeDfs2ItemsTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cmerged.dfs2");
+
+      LPCTSTR sources[2] = { inputFullPath, inputFullPath };
+      MergeDfsFileItems(outputFullPath, sources, 2);
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(outputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening merged file");
+      Assert::AreEqual((long)6, (long)dfsGetNoOfItems(pdfs));
+
+      TimeAxisType taxis_type;
+      LPCTSTR start_date, start_time;
+      double tstart, tstep, tspan;
+      long num_timesteps, neum_unit, index;
+      GetDfsTimeAxis(pdfs, &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+      Assert::AreEqual((long)13, num_timesteps);
+
+      LONG          item_type;
+      LPCTSTR       item_type_str;
+      LPCTSTR       item_name;
+      LONG          item_unit;
+      LPCTSTR       item_unit_str;
+      SimpleType    item_datatype;
+      rc = dfsGetItemInfo(dfsItemD(pdfs, 4), &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+      Assert::AreEqual("H Water Depth m", item_name);
+
+      // Item 1 and item 4 are identical. Value at time step 3, cell (3,4), see ReadDfs2Test
+      int item_num_elmts = dfsGetItemElements(dfsItemD(pdfs, 1));
+      float* data1 = new float[item_num_elmts];
+      float* data4 = new float[item_num_elmts];
+      double time;
+      int index34 = 71 * 4 + 3;
+      rc = dfsFindItemDynamic(pdfs, fp, 2, 1);
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data1);
+      rc = dfsFindItemDynamic(pdfs, fp, 2, 4);
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data4);
+      Assert::AreEqual(11.3634329f, data1[index34]);
+      Assert::AreEqual(data1[index34], data4[index34]);
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      delete[] data1;
+      delete[] data4;
+    }
+
+  };
+}
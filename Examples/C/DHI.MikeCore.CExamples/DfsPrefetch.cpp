@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsPrefetch.h"
+
+#include <CppUnitTestLogger.h>
+
+
+/** Reader thread, reading num_timesteps time steps of all items */
+static void DfsPrefetchThread(DfsPrefetchReader* reader)
+{
+  for (long i_tstep = 0; i_tstep < reader->num_timesteps; i_tstep++)
+  {
+    // Wait for a free slot
+    {
+      std::unique_lock<std::mutex> lock(reader->mtx);
+      reader->cv.wait(lock, [&] { return reader->stop || reader->produced - reader->consumed < reader->num_slots; });
+      if (reader->stop)
+        return;
+    }
+    int slot = i_tstep % reader->num_slots;
+    double* slot_data = &reader->slots[slot * reader->slot_size];
+    long rc = F_NO_ERROR;
+    for (int i_item = 1; i_item <= reader->num_items && rc == F_NO_ERROR; i_item++)
+      rc = dfsReadItemTimeStep(reader->pdfs, reader->fp, &reader->times[slot * reader->num_items + i_item - 1], slot_data + reader->item_offsets[i_item - 1]);
+    {
+      std::lock_guard<std::mutex> lock(reader->mtx);
+      if (rc == F_NO_ERROR)
+        reader->produced++;
+      else
+        reader->rc = rc;
+    }
+    reader->cv.notify_all();
+    if (rc != F_NO_ERROR)
+      return;
+  }
+}
+
+void DfsPrefetchStart(LPHEAD pdfs, LPFILE fp, DfsPrefetchReader* reader, int num_slots, long num_timesteps)
+{
+  reader->pdfs = pdfs;
+  reader->fp = fp;
+  reader->num_items = dfsGetNoOfItems(pdfs);
+  if (num_timesteps < 0)
+  {
+    double start_sec, tstep_sec;
+    GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+  }
+  reader->num_timesteps = num_timesteps;
+
+  // Set up slot buffers
+  reader->item_offsets.resize(reader->num_items);
+  reader->slot_size = 0;
+  for (int i_item = 1; i_item <= reader->num_items; i_item++)
+  {
+    reader->item_offsets[i_item - 1] = reader->slot_size;
+    reader->slot_size += (dfsGetItemBytes(dfsItemD(pdfs, i_item)) + sizeof(double) - 1) / sizeof(double);
+  }
+  reader->num_slots = num_slots < 1 ? 1 : num_slots;
+  reader->slots.resize(reader->slot_size * reader->num_slots);
+  reader->times.resize(reader->num_items * reader->num_slots);
+
+  reader->produced = 0;
+  reader->consumed = 0;
+  reader->stop = false;
+  reader->rc = F_NO_ERROR;
+  reader->current = -1;
+  reader->thread = std::thread(DfsPrefetchThread, reader);
+}
+
+bool DfsPrefetchNext(DfsPrefetchReader* reader)
+{
+  std::unique_lock<std::mutex> lock(reader->mtx);
+  // Release the slot of the current time step
+  if (reader->current >= 0)
+  {
+    reader->consumed++;
+    reader->cv.notify_all();
+  }
+  reader->current++;
+  if (reader->current >= reader->num_timesteps)
+    return false;
+  reader->cv.wait(lock, [&] { return reader->produced > reader->current || reader->rc != F_NO_ERROR; });
+  if (reader->produced > reader->current)
+    return true;
+  LOG("Error reading time step %ld: %s", reader->current, GetRCString(reader->rc));
+  return false;
+}
+
+void* DfsPrefetchItemData(DfsPrefetchReader* reader, int i_item)
+{
+  int slot = reader->current % reader->num_slots;
+  return &reader->slots[slot * reader->slot_size + reader->item_offsets[i_item - 1]];
+}
+
+double DfsPrefetchItemTime(DfsPrefetchReader* reader, int i_item)
+{
+  int slot = reader->current % reader->num_slots;
+  return reader->times[slot * reader->num_items + i_item - 1];
+}
+
+void DfsPrefetchStop(DfsPrefetchReader* reader)
+{
+  {
+    std::lock_guard<std::mutex> lock(reader->mtx);
+    reader->stop = true;
+  }
+  reader->cv.notify_all();
+  if (reader->thread.joinable())
+    reader->thread.join();
+}
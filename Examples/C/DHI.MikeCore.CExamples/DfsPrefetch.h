@@ -0,0 +1,81 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Prefetching reader for sequential time step scans.
+ *
+ * A background thread reads all items of the next time steps into a bounded ring
+ * of reusable slots, while the consumer processes the current time step, such that
+ * reading and processing overlap. On storage with high latency, a sequential scan
+ * then does not wait on each dfsReadItemTimeStep.
+ *
+ * The slot for time step i is i % num_slots. The reader thread waits when all slots
+ * are full, and the consumer waits when the next time step is not yet read.
+ * Memory usage is bounded by num_slots times the size of one time step of all items.
+ *
+ * Usage:
+ *
+ *   DfsPrefetchReader reader;
+ *   DfsPrefetchStart(pdfs, fp, &reader);
+ *   while (DfsPrefetchNext(&reader))
+ *   {
+ *     float* data = (float*)DfsPrefetchItemData(&reader, 1);
+ *     ...
+ *   }
+ *   DfsPrefetchStop(&reader);
+ */
+struct DfsPrefetchReader
+{
+  LPHEAD pdfs = nullptr;
+  LPFILE fp = nullptr;
+  long   num_items = 0;
+  long   num_timesteps = 0;           ///< Number of time steps to read
+
+  std::vector<size_t> item_offsets;   ///< Offset of each item in slot, in number of doubles
+  size_t              slot_size = 0;  ///< Size of one slot, in number of doubles
+  int                 num_slots = 0;
+  std::vector<double> slots;          ///< Buffer for all slots. double, for alignment of both float and double data
+  std::vector<double> times;          ///< Time of each item-timestep in each slot
+
+  std::thread             thread;
+  std::mutex              mtx;
+  std::condition_variable cv;
+  long produced = 0;                  ///< Number of time steps read
+  long consumed = 0;                  ///< Number of time steps released by the consumer
+  bool stop = false;                  ///< Set by DfsPrefetchStop, to end the reader thread early
+  long rc = F_NO_ERROR;               ///< Error of the reader thread, ending the scan
+
+  long current = -1;                  ///< Time step of the consumer, -1 before the first DfsPrefetchNext
+};
+
+/**
+ * Start the reader thread, reading from the current position of the file, which must be at
+ * the first item of a time step, e.g. after dfsFindBlockDynamic or dfsFindTimeStep.
+ * Reads num_timesteps time steps, -1 for the number of time steps of the file,
+ * and up to num_slots time steps ahead.
+ * The file must not be used by others until DfsPrefetchStop.
+ */
+void DfsPrefetchStart(LPHEAD pdfs, LPFILE fp, DfsPrefetchReader* reader, int num_slots = 2, long num_timesteps = -1);
+
+/**
+ * Release the current time step, and wait for the next one to be read.
+ * Returns false when all time steps are read, or on a read error, see DfsPrefetchReader::rc.
+ */
+bool DfsPrefetchNext(DfsPrefetchReader* reader);
+
+/** Data of item of the current time step, 1 based item number */
+void* DfsPrefetchItemData(DfsPrefetchReader* reader, int i_item);
+
+/** Time of item of the current time step, as returned by dfsReadItemTimeStep */
+double DfsPrefetchItemTime(DfsPrefetchReader* reader, int i_item);
+
+/** Stop and join the reader thread. The file is not closed. */
+void DfsPrefetchStop(DfsPrefetchReader* reader);
@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsPrefetch.h"
+#include <CppUnitTest.h>
+
+#include <string.h>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsPrefetch_tests)
+  {
+  public:
+
+    /// Scan OresundHD.dfs2 with the prefetching reader, comparing with blocking reads of the same file
+    TEST_METHOD(PrefetchScanTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+
+      LPHEAD pdfs, pdfs2;
+      LPFILE fp, fp2;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      rc = dfsFileRead(inputFullPath, &pdfs2, &fp2);
+      CheckRc(rc, "Error opening file");
+      rc = dfsFindBlockDynamic(pdfs, fp);
+      CheckRc(rc, "Error finding dynamic data");
+
+      DfsPrefetchReader reader;
+      DfsPrefetchStart(pdfs, fp, &reader, 3);
+      std::vector<float> data(71 * 91);
+      long num_tsteps = 0;
+      double time;
+      while (DfsPrefetchNext(&reader))
+      {
+        for (int i_item = 1; i_item <= 3; i_item++)
+        {
+          rc = dfsReadItemTimeStep(pdfs2, fp2, &time, data.data());
+          CheckRc(rc, "Error reading item-timestep");
+          Assert::AreEqual(time, DfsPrefetchItemTime(&reader, i_item));
+          Assert::AreEqual(0, memcmp(data.data(), DfsPrefetchItemData(&reader, i_item), data.size() * sizeof(float)));
+        }
+        if (num_tsteps == 2)
+          Assert::AreEqual(11.3634329f, ((float*)DfsPrefetchItemData(&reader, 1))[71 * 4 + 3]);
+        num_tsteps++;
+      }
+      DfsPrefetchStop(&reader);
+      Assert::AreEqual((long)F_NO_ERROR, reader.rc);
+      Assert::AreEqual(13L, num_tsteps);
+
+      // Stopping in the middle of a scan ends the reader thread
+      rc = dfsFindTimeStep(pdfs, fp, 5);
+      CheckRc(rc, "Error finding time step");
+      DfsPrefetchReader reader2;
+      DfsPrefetchStart(pdfs, fp, &reader2, 2, 8);
+      Assert::IsTrue(DfsPrefetchNext(&reader2));
+      Assert::AreEqual(5.0, DfsPrefetchItemTime(&reader2, 1));
+      DfsPrefetchStop(&reader2);
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      rc = dfsFileClose(pdfs2, &fp2);
+      rc = dfsHeaderDestroy(&pdfs2);
+    }
+
+  };
+}
@@ -0,0 +1,296 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsPyramid.h"
+
+#include <CppUnitTestLogger.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Average of 2x2 values, ignoring delete values and land values, delete value if all are
+ * and none is a land value, else land value. With land equal to del, only delete values
+ * are ignored.
+ * Uses integer masks and arithmetic instead of conditionals, such that compilers
+ * can vectorize the loops calling it without relaxed floating point semantics.
+ */
+template <typename T>
+static inline T Average4(T a, T b, T c, T d, T del, T land)
+{
+  int ma = (a != del) & (a != land), mb = (b != del) & (b != land);
+  int mc = (c != del) & (c != land), md = (d != del) & (d != land);
+  int none = 1 - (ma | mb | mc | md);
+  int has_land = (a == land) | (b == land) | (c == land) | (d == land);
+  T sum = a * (T)ma + b * (T)mb + c * (T)mc + d * (T)md;
+  T avg = sum / (T)(ma + mb + mc + md + none);
+  T fill = land * (T)has_land + del * (T)(1 - has_land);
+  return avg + fill * (T)none;
+}
+
+template <typename T>
+static void Downsample(const T* __restrict in, long nj, long nk, T* __restrict out, T del, T land)
+{
+  long mj = (nj + 1) / 2;
+  long mk = (nk + 1) / 2;
+  long full_j = nj / 2;
+  for (long k = 0; k < mk; k++)
+  {
+    // Last row of an odd grid is averaged with itself, giving the average of the row pair
+    const T* __restrict r0 = in + 2 * k * nj;
+    const T* __restrict r1 = 2 * k + 1 < nk ? r0 + nj : r0;
+    T* __restrict o = out + k * mj;
+    for (long j = 0; j < full_j; j++)
+      o[j] = Average4(r0[2 * j], r0[2 * j + 1], r1[2 * j], r1[2 * j + 1], del, land);
+    if (nj % 2)
+      o[full_j] = Average4(r0[nj - 1], r0[nj - 1], r1[nj - 1], r1[nj - 1], del, land);
+  }
+}
+
+void DfsPyramidDownsample(const float* in, long nj, long nk, float* out, float delete_value)
+{
+  Downsample(in, nj, nk, out, delete_value, delete_value);
+}
+
+void DfsPyramidDownsample(const double* in, long nj, long nk, double* out, double delete_value)
+{
+  Downsample(in, nj, nk, out, delete_value, delete_value);
+}
+
+void DfsPyramidDownsample(const float* in, long nj, long nk, float* out, float delete_value, float land_value)
+{
+  Downsample(in, nj, nk, out, delete_value, land_value);
+}
+
+/** Grid of one pyramid level */
+struct PyramidLevel
+{
+  long  nj, nk;
+  float x0, y0, dx, dy;
+  LPHEAD pdfs = nullptr;
+  LPFILE fp = nullptr;
+};
+
+/** Static float item on the grid, kept in memory to be written to each level */
+struct PyramidStaticItem
+{
+  LONG        item_type;
+  std::string name;
+  LONG        item_unit;
+  std::vector<float> data;
+};
+
+int DfsPyramidBuild(LPCTSTR dfs2Filename, LPCTSTR outPrefix, int num_levels, int num_threads)
+{
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(dfs2Filename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfs);
+  float delete_float = dfsGetDeleteValFloat(pdfs);
+  double delete_double = dfsGetDeleteValDouble(pdfs);
+  // Land cells of static items, e.g. bathymetry, are not averaged into water cells
+  float land_value = delete_float;
+  GetDfsLandValue(pdfs, &land_value);
+
+  // All dynamic items must be on the same 2D grid
+  LONG    axis_unit;
+  LPCTSTR axis_unit_str;
+  LONG    nj = 0, nk = 0;
+  float   x0, y0, dx, dy;
+  std::vector<SimpleType> datatypes(num_items);
+  bool ok = num_items > 0;
+  for (int i_item = 1; i_item <= num_items && ok; i_item++)
+  {
+    LPITEM item = dfsItemD(pdfs, i_item);
+    LONG j, k, item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &datatypes[i_item - 1]);
+    ok = dfsGetItemAxisType(item) == F_EQ_AXIS_D2 &&
+         (datatypes[i_item - 1] == UFS_FLOAT || datatypes[i_item - 1] == UFS_DOUBLE);
+    if (ok)
+    {
+      dfsGetItemAxisEqD2(item, &axis_unit, &axis_unit_str, &j, &k, &x0, &y0, &dx, &dy);
+      if (i_item == 1)
+      {
+        nj = j;
+        nk = k;
+      }
+      ok = j == nj && k == nk;
+    }
+    if (!ok)
+      LOG("Item %d is not a float or double item on the 2D grid of item 1: %s", i_item, dfs2Filename);
+  }
+  if (!ok)
+  {
+    rc = dfsFileClose(pdfs, &fp);
+    rc = dfsHeaderDestroy(&pdfs);
+    return -1;
+  }
+
+  // Static float items on the grid
+  std::vector<PyramidStaticItem> static_items;
+  LPVECTOR pvec;
+  while (nullptr != (pvec = dfsStaticRead(fp, &rc)))
+  {
+    LPITEM static_item = dfsItemS(pvec);
+    LONG item_type, item_unit, j, k, static_axis_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    SimpleType item_datatype;
+    float sx0, sy0, sdx, sdy;
+    rc = dfsGetItemInfo(static_item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+    if (item_datatype == UFS_FLOAT && dfsGetItemAxisType(static_item) == F_EQ_AXIS_D2)
+    {
+      dfsGetItemAxisEqD2(static_item, &static_axis_unit, &item_unit_str, &j, &k, &sx0, &sy0, &sdx, &sdy);
+      if (j == nj && k == nk)
+      {
+        PyramidStaticItem sitem;
+        sitem.item_type = item_type;
+        sitem.name = item_name;
+        sitem.item_unit = item_unit;
+        sitem.data.resize(nj * nk);
+        rc = dfsStaticGetData(pvec, sitem.data.data());
+        CheckRc(rc, "Error reading static data");
+        static_items.push_back(sitem);
+      }
+    }
+    rc = dfsStaticDestroy(&pvec);
+  }
+
+  // Grids of the levels, level 0 being the input
+  std::vector<PyramidLevel> levels(1);
+  levels[0].nj = nj;
+  levels[0].nk = nk;
+  levels[0].x0 = x0;
+  levels[0].y0 = y0;
+  levels[0].dx = dx;
+  levels[0].dy = dy;
+  while (num_levels > 0 ? (int)levels.size() <= num_levels : (levels.back().nj > 64 || levels.back().nk > 64))
+  {
+    const PyramidLevel& prev = levels.back();
+    if (prev.nj == 1 && prev.nk == 1)
+      break;
+    PyramidLevel level;
+    level.nj = (prev.nj + 1) / 2;
+    level.nk = (prev.nk + 1) / 2;
+    level.x0 = prev.x0 + 0.5f * prev.dx;
+    level.y0 = prev.y0 + 0.5f * prev.dy;
+    level.dx = 2 * prev.dx;
+    level.dy = 2 * prev.dy;
+    levels.push_back(level);
+  }
+  int num_built = (int)levels.size() - 1;
+
+  // Create level files, and write downsampled static items
+  for (int l = 1; l <= num_built; l++)
+  {
+    PyramidLevel& level = levels[l];
+    CreateDfsHeaderFromSource(pdfs, &level.pdfs, num_items);
+    CopyDfsDynamicItemInfo(pdfs, level.pdfs, num_items);
+    for (int i_item = 1; i_item <= num_items; i_item++)
+    {
+      rc = dfsSetItemAxisEqD2(dfsItemD(level.pdfs, i_item), axis_unit, level.nj, level.nk, level.x0, level.y0, level.dx, level.dy);
+      CheckRc(rc, "Error setting item axis");
+    }
+    char filename[_MAX_PATH];
+    snprintf(filename, _MAX_PATH, "%s_L%d.dfs2", outPrefix, l);
+    rc = dfsFileCreate(filename, level.pdfs, &level.fp);
+    CheckRc(rc, "Error creating file");
+
+    for (size_t s = 0; s < static_items.size(); s++)
+    {
+      PyramidStaticItem& sitem = static_items[s];
+      std::vector<float> coarse(level.nj * level.nk);
+      DfsPyramidDownsample(sitem.data.data(), levels[l - 1].nj, levels[l - 1].nk, coarse.data(), delete_float, land_value);
+      sitem.data.swap(coarse);
+
+      rc = dfsStaticCreate(&pvec);
+      CheckRc(rc, "Error creating static vector");
+      rc = dfsSetItemInfo(level.pdfs, dfsItemS(pvec), sitem.item_type, sitem.name.c_str(), sitem.item_unit, UFS_FLOAT);
+      CheckRc(rc, "Error setting static item info");
+      rc = dfsSetItemAxisEqD2(dfsItemS(pvec), axis_unit, level.nj, level.nk, level.x0, level.y0, level.dx, level.dy);
+      CheckRc(rc, "Error setting static item axis");
+      rc = dfsStaticWrite(pvec, level.fp, sitem.data.data());
+      CheckRc(rc, "Error writing static item");
+      rc = dfsStaticDestroy(&pvec);
+    }
+  }
+
+  // Buffers of each item at each level, doubles to have room for both data types
+  std::vector<std::vector<std::vector<double>>> data(num_items);
+  for (int i = 0; i < num_items; i++)
+  {
+    data[i].resize(levels.size());
+    for (size_t l = 0; l < levels.size(); l++)
+      data[i][l].resize(levels[l].nj * levels[l].nk);
+  }
+
+  if (num_threads <= 0)
+    num_threads = (int)std::thread::hardware_concurrency();
+  if (num_threads < 1)
+    num_threads = 1;
+  if (num_threads > num_items)
+    num_threads = num_items;
+
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+  for (long i_tstep = 0; i_tstep < num_timesteps && num_built > 0; i_tstep++)
+  {
+    double time;
+    for (int i_item = 1; i_item <= num_items; i_item++)
+    {
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data[i_item - 1][0].data());
+      CheckRc(rc, "Error reading dynamic item data");
+    }
+
+    // Downsample items in parallel, each thread taking every num_threads'th item
+    auto downsample = [&](int t)
+    {
+      for (int i = t; i < num_items; i += num_threads)
+      {
+        for (int l = 1; l <= num_built; l++)
+        {
+          if (datatypes[i] == UFS_FLOAT)
+            DfsPyramidDownsample((const float*)data[i][l - 1].data(), levels[l - 1].nj, levels[l - 1].nk,
+                                 (float*)data[i][l].data(), delete_float);
+          else
+            DfsPyramidDownsample(data[i][l - 1].data(), levels[l - 1].nj, levels[l - 1].nk,
+                                 data[i][l].data(), delete_double);
+        }
+      }
+    };
+    if (num_threads == 1)
+      downsample(0);
+    else
+    {
+      std::vector<std::thread> threads;
+      for (int t = 0; t < num_threads; t++)
+        threads.emplace_back(downsample, t);
+      for (int t = 0; t < num_threads; t++)
+        threads[t].join();
+    }
+
+    for (int l = 1; l <= num_built; l++)
+    {
+      for (int i_item = 1; i_item <= num_items; i_item++)
+      {
+        rc = dfsWriteItemTimeStep(levels[l].pdfs, levels[l].fp, time, data[i_item - 1][l].data());
+        CheckRc(rc, "Error writing dynamic item data");
+      }
+    }
+  }
+
+  for (int l = 1; l <= num_built; l++)
+  {
+    rc = dfsFileClose(levels[l].pdfs, &levels[l].fp);
+    CheckRc(rc, "Error closing file");
+    rc = dfsHeaderDestroy(&levels[l].pdfs);
+  }
+  rc = dfsFileClose(pdfs, &fp);
+  rc = dfsHeaderDestroy(&pdfs);
+  return num_built;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+/**
+ * Build a multi-resolution pyramid of a dfs2 file, for visualization of large grids.
+ *
+ * Level n is written to the dfs2 file "<outPrefix>_L<n>.dfs2", where each cell is the
+ * average of 2x2 cells of level n-1, ignoring delete values. A cell is a delete value
+ * only if all its 2x2 cells are. Grids of odd size get a last row or column of cells
+ * covering a single row or column of level n-1. The axis of each level has twice the
+ * grid spacing of the previous level, and the origin moved to the center of the 2x2 cells.
+ *
+ * All dynamic items must be float or double items on the same equidistant 2D grid.
+ * Static float items on the same grid, e.g. bathymetry, are downsampled as well,
+ * ignoring land values of the "M21_MISC" custom block, other static items are not
+ * written to the levels.
+ *
+ * The input is read once, one time step at a time. Each time step is downsampled
+ * in parallel, one thread per item for up to num_threads threads.
+ *
+ * num_levels is the number of levels to build. If 0, levels are added until the
+ * grid is no larger than 64 x 64 cells.
+ * Returns the number of levels written, or -1 on failure.
+ */
+int DfsPyramidBuild(LPCTSTR dfs2Filename, LPCTSTR outPrefix, int num_levels = 0, int num_threads = 0);
+
+/**
+ * Downsample a nj x nk grid 2x in each direction, to a (nj+1)/2 x (nk+1)/2 grid,
+ * averaging values that are not delete_value.
+ */
+void DfsPyramidDownsample(const float* in, long nj, long nk, float* out, float delete_value);
+void DfsPyramidDownsample(const double* in, long nj, long nk, double* out, double delete_value);
+
+/**
+ * Downsample as above, also ignoring land_value. A cell is land_value if all its 2x2
+ * cells are delete or land values, and at least one is a land value.
+ */
+void DfsPyramidDownsample(const float* in, long nj, long nk, float* out, float delete_value, float land_value);
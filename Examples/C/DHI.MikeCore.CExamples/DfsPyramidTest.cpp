@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsPyramid.h"
+#include <CppUnitTest.h>
+
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsPyramid_tests)
+  {
+  public:
+
+    /// Build 3 levels of OresundHD.dfs2, and check grid and values of level 1
+    TEST_METHOD(BuildPyramidTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char prefixFullPath[_MAX_PATH];
+      snprintf(prefixFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cpyramid");
+      char level1FullPath[_MAX_PATH];
+      snprintf(level1FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cpyramid_L1.dfs2");
+      char level3FullPath[_MAX_PATH];
+      snprintf(level3FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cpyramid_L3.dfs2");
+
+      int num_levels = DfsPyramidBuild(inputFullPath, prefixFullPath, 3, 2);
+      Assert::AreEqual(3, num_levels);
+
+      LPHEAD pdfs, pdfsL1, pdfsL3;
+      LPFILE fp, fpL1, fpL3;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      rc = dfsFileRead(level1FullPath, &pdfsL1, &fpL1);
+      CheckRc(rc, "Error opening level 1 file");
+      rc = dfsFileRead(level3FullPath, &pdfsL3, &fpL3);
+      CheckRc(rc, "Error opening level 3 file");
+      Assert::AreEqual(3L, (long)dfsGetNoOfItems(pdfsL1));
+
+      LONG    axis_unit;
+      LPCTSTR axis_unit_str;
+      LONG    nj, nk;
+      float   x0, y0, dx, dy;
+      rc = dfsGetItemAxisEqD2(dfsItemD(pdfsL1, 1), &axis_unit, &axis_unit_str, &nj, &nk, &x0, &y0, &dx, &dy);
+      Assert::AreEqual(36L, (long)nj);
+      Assert::AreEqual(46L, (long)nk);
+      Assert::AreEqual(1800.0f, dx);
+      Assert::AreEqual(1800.0f, dy);
+      rc = dfsGetItemAxisEqD2(dfsItemD(pdfsL3, 2), &axis_unit, &axis_unit_str, &nj, &nk, &x0, &y0, &dx, &dy);
+      Assert::AreEqual(9L, (long)nj);
+      Assert::AreEqual(12L, (long)nk);
+      Assert::AreEqual(7200.0f, dx);
+
+      // Level 1 cell (1,2) is the average of cells (2..3,4..5) of time step 2, ignoring delete values
+      std::vector<float> data(71 * 91);
+      std::vector<float> dataL1(36 * 46);
+      double time;
+      rc = dfsFindItemDynamic(pdfs, fp, 2, 1);
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+      CheckRc(rc, "Error reading item-timestep");
+      rc = dfsFindItemDynamic(pdfsL1, fpL1, 2, 1);
+      rc = dfsReadItemTimeStep(pdfsL1, fpL1, &time, dataL1.data());
+      CheckRc(rc, "Error reading level 1 item-timestep");
+      float delete_value = dfsGetDeleteValFloat(pdfs);
+      float sum = 0;
+      int count = 0;
+      for (int k = 4; k <= 5; k++)
+        for (int j = 2; j <= 3; j++)
+          if (data[k * 71 + j] != delete_value)
+          {
+            sum += data[k * 71 + j];
+            count++;
+          }
+      float expected = count > 0 ? sum / count : delete_value;
+      Assert::AreEqual(expected, dataL1[2 * 36 + 1]);
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      rc = dfsFileClose(pdfsL1, &fpL1);
+      rc = dfsHeaderDestroy(&pdfsL1);
+      rc = dfsFileClose(pdfsL3, &fpL3);
+      rc = dfsHeaderDestroy(&pdfsL3);
+    }
+
+    /// Downsampling an odd sized grid with delete values
+    TEST_METHOD(DownsampleTest)
+    {
+      const float d = 1e-35f;
+      float in[15] = { 1, 2,  3,  4,  5,
+                       6, 7,  8,  9, 10,
+                       d, d,  d,  d, 11 };
+      float out[6];
+      DfsPyramidDownsample(in, 5, 3, out, d);
+      Assert::AreEqual(4.0f, out[0]);
+      Assert::AreEqual(6.0f, out[1]);
+      Assert::AreEqual(7.5f, out[2]);
+      Assert::AreEqual(d, out[3]);
+      Assert::AreEqual(d, out[4]);
+      Assert::AreEqual(11.0f, out[5]);
+    }
+
+    /// Downsampling bathymetry with land values, which are not averaged into water cells
+    TEST_METHOD(DownsampleLandTest)
+    {
+      const float d = 1e-35f;
+      const float l = 10.0f;
+      float in[8] = { -2, l, l, l,
+                      -4, d, d, d };
+      float out[2];
+      DfsPyramidDownsample(in, 4, 2, out, d, l);
+      Assert::AreEqual(-3.0f, out[0]);
+      Assert::AreEqual(l, out[1]);
+    }
+
+  };
+}
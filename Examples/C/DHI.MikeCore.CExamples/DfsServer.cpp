@@ -0,0 +1,630 @@
+#include "pch.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET DfsSocket;
+#define DfsCloseSocket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int DfsSocket;
+#define INVALID_SOCKET (-1)
+#define DfsCloseSocket close
+#endif
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsCache.h"
+#include "DfsHandlePool.h"
+#include "DfsTyped.h"
+#include "DfsServer.h"
+
+#include <CppUnitTestLogger.h>
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <limits>
+#include <map>
+#include <math.h>
+#include <stdlib.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+
+/** Decode %xx and + of a query parameter */
+static std::string UrlDecode(const std::string& s)
+{
+  std::string result;
+  for (size_t i = 0; i < s.size(); i++)
+  {
+    if (s[i] == '+')
+      result += ' ';
+    else if (s[i] == '%' && i + 2 < s.size() && isxdigit((unsigned char)s[i + 1]) && isxdigit((unsigned char)s[i + 2]))
+    {
+      result += (char)strtol(s.substr(i + 1, 2).c_str(), NULL, 16);
+      i += 2;
+    }
+    else
+      result += s[i];
+  }
+  return result;
+}
+
+/** Parameters of query "a=1&b=2" */
+static std::map<std::string, std::string> ParseQuery(const std::string& query)
+{
+  std::map<std::string, std::string> params;
+  size_t start = 0;
+  while (start < query.size())
+  {
+    size_t end = query.find('&', start);
+    if (end == std::string::npos)
+      end = query.size();
+    std::string param = query.substr(start, end - start);
+    size_t eq = param.find('=');
+    if (eq != std::string::npos)
+      params[UrlDecode(param.substr(0, eq))] = UrlDecode(param.substr(eq + 1));
+    start = end + 1;
+  }
+  return params;
+}
+
+/** Get number parameter, returning false if missing or not a number */
+static bool GetParam(const std::map<std::string, std::string>& params, const char* name, double* value)
+{
+  auto it = params.find(name);
+  if (it == params.end() || it->second.empty())
+    return false;
+  char* end;
+  *value = strtod(it->second.c_str(), &end);
+  return *end == '\0';
+}
+
+static bool GetParam(const std::map<std::string, std::string>& params, const char* name, long* value)
+{
+  double d;
+  if (!GetParam(params, name, &d) || d != floor(d))
+    return false;
+  *value = (long)d;
+  return true;
+}
+
+static void AppendJson(std::string& s, double value)
+{
+  char buf[32];
+  if (isnan(value))
+    s += "null";
+  else
+  {
+    snprintf(buf, sizeof(buf), "%.10g", value);
+    s += buf;
+  }
+}
+
+static void AppendJson(std::string& s, const char* str)
+{
+  s += '"';
+  for (const char* c = str; *c; c++)
+  {
+    if (*c == '"' || *c == '\\')
+      s += '\\';
+    if ((unsigned char)*c >= 0x20)
+      s += *c;
+  }
+  s += '"';
+}
+
+static void AppendJson(std::string& s, const char* name, const std::vector<double>& values)
+{
+  s += '"';
+  s += name;
+  s += "\":[";
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    if (i > 0)
+      s += ',';
+    AppendJson(s, values[i]);
+  }
+  s += ']';
+}
+
+static void AppendBinary(std::string& s, const std::vector<double>& values)
+{
+  s.append((const char*)values.data(), values.size() * sizeof(double));
+}
+
+static DfsServerResponse ErrorResponse(int status, const char* message)
+{
+  DfsServerResponse response;
+  response.status = status;
+  response.body = "{\"error\":";
+  AppendJson(response.body, message);
+  response.body += "}";
+  return response;
+}
+
+/** Time of item-timestep in seconds, time as returned by dfsReadItemTimeStep */
+static double TimeSeconds(LPHEAD pdfs, long tstep, double time)
+{
+  TimeAxisType taxis_type;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep_unit, tspan;
+  long num_timesteps, neum_unit, index;
+  GetDfsTimeAxis(pdfs, &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep_unit, &tspan, &neum_unit, &index);
+  double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+  // For equidistant axes the time returned is the time step index
+  double sec = (taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS) ? (tstart + tstep * tstep_unit) * unit_sec : time * unit_sec;
+  if (taxis_type == F_CAL_EQ_AXIS || taxis_type == F_CAL_NEQ_AXIS)
+    sec += DfsDateTimeToSeconds(start_date, start_time);
+  return sec;
+}
+
+/** Read item-timestep as double, delete values as NaN. File must be locked */
+static bool ReadValues(LPHEAD pdfs, LPFILE fp, int i_item, long tstep, std::vector<double>* values, double* time)
+{
+  LPITEM item = dfsItemD(pdfs, i_item);
+  LONG item_type, item_unit;
+  LPCTSTR item_type_str, item_name, item_unit_str;
+  SimpleType item_datatype;
+  long rc = dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+  size_t n = dfsGetItemElements(item);
+  values->resize(n);
+  if (rc == F_NO_ERROR)
+    rc = dfsFindItemDynamic(pdfs, fp, tstep, i_item);
+  if (rc != F_NO_ERROR)
+    return false;
+  bool ok = DfsVisitSimpleType(item_datatype, [&](auto tag)
+  {
+    using T = typename decltype(tag)::type;
+    std::vector<T> buffer(n);
+    rc = dfsReadItemTimeStep(pdfs, fp, time, buffer.data());
+    DfsConvertValues(buffer.data(), n, DfsDeleteValue<T>(pdfs), values->data(), std::numeric_limits<double>::quiet_NaN());
+  });
+  return ok && rc == F_NO_ERROR;
+}
+
+/**
+ * Center of each element: Cached centroids for dfsu files, grid points for dfs2 files, computed into
+ * grid_xs and grid_ys. xs and ys point to the centers, not copying the cached ones. Returns false for other files
+ */
+static bool ElementCenters(const DfsCachedFile& file, LPHEAD pdfs, int i_item, std::vector<double>* grid_xs, std::vector<double>* grid_ys,
+                           const std::vector<double>** xs, const std::vector<double>** ys)
+{
+  if (file.has_mesh)
+  {
+    *xs = &file.metrics.center_x;
+    *ys = &file.metrics.center_y;
+    return true;
+  }
+  LPITEM item = dfsItemD(pdfs, i_item);
+  if (dfsGetItemAxisType(item) != F_EQ_AXIS_D2)
+    return false;
+  LONG axis_unit, j, k;
+  LPCTSTR axis_unit_str;
+  float x0, y0, dx, dy;
+  dfsGetItemAxisEqD2(item, &axis_unit, &axis_unit_str, &j, &k, &x0, &y0, &dx, &dy);
+  grid_xs->resize((size_t)j * k);
+  grid_ys->resize((size_t)j * k);
+  for (long ik = 0; ik < k; ik++)
+  {
+    for (long ij = 0; ij < j; ij++)
+    {
+      (*grid_xs)[ik * j + ij] = x0 + ij * (double)dx;
+      (*grid_ys)[ik * j + ij] = y0 + ik * (double)dy;
+    }
+  }
+  *xs = grid_xs;
+  *ys = grid_ys;
+  return true;
+}
+
+DfsServerResponse DfsServerQuery(const std::string& root, const std::string& target)
+{
+  size_t qpos = target.find('?');
+  std::string path = target.substr(0, qpos);
+  std::map<std::string, std::string> params = ParseQuery(qpos == std::string::npos ? "" : target.substr(qpos + 1));
+
+  if (path != "/info" && path != "/point" && path != "/series" && path != "/field" && path != "/stats")
+    return ErrorResponse(404, "Unknown query");
+
+  // Files only below root
+  std::string file = params["file"];
+  if (file.empty() || file.find("..") != std::string::npos || file[0] == '/' || file[0] == '\\' || file.find(':') != std::string::npos)
+    return ErrorResponse(400, "Invalid file");
+  DfsCacheHandle handle = DfsCacheOpen((root + file).c_str());
+  if (!handle)
+    return ErrorResponse(404, "File not found");
+
+  // Own handle of the file, such that queries of the same file read concurrently
+  DfsPoolLease lease = DfsHandlePoolAcquire(&handle->handles);
+  if (!lease)
+    return ErrorResponse(500, "Error opening file");
+  LPHEAD pdfs = lease.pdfs;
+  LPFILE fp = lease.fp;
+  long num_items = dfsGetNoOfItems(pdfs);
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+
+  DfsServerResponse response;
+  bool binary = params["format"] == "binary";
+  if (binary)
+    response.content_type = "application/octet-stream";
+  std::string& body = response.body;
+
+  if (path == "/info")
+  {
+    body = "{\"items\":[";
+    for (int i_item = 1; i_item <= num_items; i_item++)
+    {
+      LONG item_type, item_unit;
+      LPCTSTR item_type_str, item_name, item_unit_str;
+      SimpleType item_datatype;
+      LPITEM item = dfsItemD(pdfs, i_item);
+      dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+      body += i_item > 1 ? ",{\"name\":" : "{\"name\":";
+      AppendJson(body, item_name);
+      body += ",\"unit\":";
+      AppendJson(body, item_unit_str);
+      body += ",\"elements\":";
+      AppendJson(body, (double)dfsGetItemElements(item));
+      body += "}";
+    }
+    body += "],\"timesteps\":";
+    AppendJson(body, (double)num_timesteps);
+    body += ",\"start\":";
+    AppendJson(body, start_sec);
+    body += "}";
+    response.content_type = "application/json";
+    return response;
+  }
+
+  long i_item, tstep = 0;
+  if (!GetParam(params, "item", &i_item) || i_item < 1 || i_item > num_items)
+    return ErrorResponse(400, "Invalid item");
+  if (path != "/series" && (!GetParam(params, "tstep", &tstep) || tstep < 0 || tstep >= num_timesteps))
+    return ErrorResponse(400, "Invalid tstep");
+
+  std::vector<double> values;
+  double time;
+  if (path == "/point" || path == "/series")
+  {
+    long elmt;
+    if (!GetParam(params, "elmt", &elmt) || elmt < 0 || elmt >= dfsGetItemElements(dfsItemD(pdfs, i_item)))
+      return ErrorResponse(400, "Invalid elmt");
+    long tstep_first = path == "/point" ? tstep : 0;
+    long tstep_count = path == "/point" ? 1 : num_timesteps;
+    std::vector<double> times(tstep_count), point_values(tstep_count);
+    for (long i = 0; i < tstep_count; i++)
+    {
+      if (!ReadValues(pdfs, fp, i_item, tstep_first + i, &values, &time))
+        return ErrorResponse(500, "Error reading item-timestep");
+      times[i] = TimeSeconds(pdfs, tstep_first + i, time);
+      point_values[i] = values[elmt];
+    }
+    if (binary && path == "/point")
+      AppendBinary(body, point_values);
+    else if (binary)
+    {
+      AppendBinary(body, times);
+      AppendBinary(body, point_values);
+    }
+    else if (path == "/point")
+    {
+      body = "{\"time\":";
+      AppendJson(body, times[0]);
+      body += ",\"value\":";
+      AppendJson(body, point_values[0]);
+      body += "}";
+    }
+    else
+    {
+      body = "{";
+      AppendJson(body, "times", times);
+      body += ",";
+      AppendJson(body, "values", point_values);
+      body += "}";
+    }
+    return response;
+  }
+
+  if (path == "/field")
+  {
+    double x0, y0, x1, y1;
+    if (!GetParam(params, "x0", &x0) || !GetParam(params, "y0", &y0) || !GetParam(params, "x1", &x1) || !GetParam(params, "y1", &y1))
+      return ErrorResponse(400, "Invalid bounding box");
+    std::vector<double> grid_xs, grid_ys;
+    const std::vector<double>* xs;
+    const std::vector<double>* ys;
+    if (!ElementCenters(*handle, pdfs, i_item, &grid_xs, &grid_ys, &xs, &ys))
+      return ErrorResponse(400, "Field queries need a dfsu or dfs2 file");
+    if (!ReadValues(pdfs, fp, i_item, tstep, &values, &time))
+      return ErrorResponse(500, "Error reading item-timestep");
+    std::vector<double> elmts, field_values;
+    for (size_t e = 0; e < xs->size() && e < values.size(); e++)
+    {
+      if ((*xs)[e] >= x0 && (*xs)[e] <= x1 && (*ys)[e] >= y0 && (*ys)[e] <= y1)
+      {
+        elmts.push_back((double)e);
+        field_values.push_back(values[e]);
+      }
+    }
+    if (binary)
+    {
+      AppendBinary(body, elmts);
+      AppendBinary(body, field_values);
+    }
+    else
+    {
+      body = "{\"time\":";
+      AppendJson(body, TimeSeconds(pdfs, tstep, time));
+      body += ",";
+      AppendJson(body, "elmts", elmts);
+      body += ",";
+      AppendJson(body, "values", field_values);
+      body += "}";
+    }
+    return response;
+  }
+
+  // Statistics, /stats
+  if (!ReadValues(pdfs, fp, i_item, tstep, &values, &time))
+    return ErrorResponse(500, "Error reading item-timestep");
+  double vmin = std::numeric_limits<double>::infinity();
+  double vmax = -vmin;
+  double sum = 0;
+  long count = 0;
+  for (double v : values)
+  {
+    if (isnan(v))
+      continue;
+    vmin = std::min(vmin, v);
+    vmax = std::max(vmax, v);
+    sum += v;
+    count++;
+  }
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<double> stats = { count ? vmin : nan, count ? vmax : nan, count ? sum / count : nan, (double)count };
+  if (binary)
+    AppendBinary(body, stats);
+  else
+  {
+    body = "{\"min\":";
+    AppendJson(body, stats[0]);
+    body += ",\"max\":";
+    AppendJson(body, stats[1]);
+    body += ",\"mean\":";
+    AppendJson(body, stats[2]);
+    body += ",\"count\":";
+    AppendJson(body, stats[3]);
+    body += "}";
+  }
+  return response;
+}
+
+static const char* StatusText(int status)
+{
+  switch (status)
+  {
+  case 200: return "OK";
+  case 400: return "Bad Request";
+  case 404: return "Not Found";
+  case 405: return "Method Not Allowed";
+  default:  return "Internal Server Error";
+  }
+}
+
+/** Read request from connection, answer it, and close the connection */
+static void DfsServerAnswer(DfsServer* server, DfsSocket s)
+{
+  // Connections not sending a complete request before the deadline are dropped, not to block a worker
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(server->request_timeout_ms);
+  std::string request;
+  char buf[4096];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < 65536)
+  {
+    long long remaining_us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(s, &set);
+    timeval timeout = { (long)(remaining_us / 1000000), (long)(remaining_us % 1000000) };
+    if (remaining_us <= 0 || select((int)s + 1, &set, NULL, NULL, &timeout) <= 0)
+    {
+      DfsCloseSocket(s);
+      return;
+    }
+    int n = recv(s, buf, sizeof(buf), 0);
+    if (n <= 0)
+      break;
+    request.append(buf, n);
+  }
+
+  // Request line "GET target HTTP/1.1"
+  DfsServerResponse response;
+  size_t sp1 = request.find(' ');
+  size_t sp2 = sp1 == std::string::npos ? std::string::npos : request.find(' ', sp1 + 1);
+  if (sp2 == std::string::npos)
+    response = ErrorResponse(400, "Invalid request");
+  else if (request.compare(0, sp1, "GET") != 0)
+    response = ErrorResponse(405, "Only GET is supported");
+  else
+    response = DfsServerQuery(server->root, request.substr(sp1 + 1, sp2 - sp1 - 1));
+
+  char header[256];
+  snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+           response.status, StatusText(response.status), response.content_type.c_str(), response.body.size());
+  std::string message = header + response.body;
+  size_t sent = 0;
+  while (sent < message.size())
+  {
+    int n = send(s, message.data() + sent, (int)std::min(message.size() - sent, (size_t)1 << 20), MSG_NOSIGNAL);
+    if (n <= 0)
+      break;
+    sent += n;
+  }
+  DfsCloseSocket(s);
+}
+
+/** Accept connections, polling for stop */
+static void DfsServerAcceptThread(DfsServer* server)
+{
+  DfsSocket listen_socket = (DfsSocket)server->listen_socket;
+  while (true)
+  {
+    {
+      std::lock_guard<std::mutex> lock(server->mtx);
+      if (server->stop)
+        return;
+    }
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(listen_socket, &set);
+    timeval timeout = { 0, 100000 };
+    if (select((int)listen_socket + 1, &set, NULL, NULL, &timeout) <= 0)
+      continue;
+    DfsSocket s = accept(listen_socket, NULL, NULL);
+    if (s == INVALID_SOCKET)
+      continue;
+    {
+      std::lock_guard<std::mutex> lock(server->mtx);
+      server->connections.push_back((intptr_t)s);
+    }
+    server->cv.notify_one();
+  }
+}
+
+/** Answer accepted connections, until stopped and no connections are waiting */
+static void DfsServerWorker(DfsServer* server)
+{
+  while (true)
+  {
+    intptr_t s;
+    {
+      std::unique_lock<std::mutex> lock(server->mtx);
+      server->cv.wait(lock, [&] { return server->stop || !server->connections.empty(); });
+      if (server->connections.empty())
+        return;
+      s = server->connections.front();
+      server->connections.pop_front();
+    }
+    DfsServerAnswer(server, (DfsSocket)s);
+  }
+}
+
+bool DfsServerStart(DfsServer* server, LPCTSTR root, int port, int num_workers)
+{
+#ifdef _WIN32
+  WSADATA wsa_data;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+  {
+    LOG("Error initializing sockets");
+    return false;
+  }
+#endif
+  server->root = root;
+  if (!server->root.empty() && server->root.back() != '/' && server->root.back() != '\\')
+    server->root += '/';
+
+  // Loopback only
+  DfsSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons((unsigned short)port);
+  socklen_t addr_len = sizeof(addr);
+  if (s == INVALID_SOCKET ||
+      bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(s, SOMAXCONN) != 0 ||
+      getsockname(s, (sockaddr*)&addr, &addr_len) != 0)
+  {
+    LOG("Error listening on port %d", port);
+    if (s != INVALID_SOCKET)
+      DfsCloseSocket(s);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return false;
+  }
+  server->port = ntohs(addr.sin_port);
+  server->listen_socket = (intptr_t)s;
+  server->stop = false;
+
+  if (num_workers < 1)
+    num_workers = 1;
+  for (int i = 0; i < num_workers; i++)
+    server->workers.emplace_back(DfsServerWorker, server);
+  server->accept_thread = std::thread(DfsServerAcceptThread, server);
+  return true;
+}
+
+void DfsServerStop(DfsServer* server)
+{
+  {
+    std::lock_guard<std::mutex> lock(server->mtx);
+    server->stop = true;
+  }
+  server->cv.notify_all();
+  if (server->accept_thread.joinable())
+    server->accept_thread.join();
+  for (std::thread& worker : server->workers)
+    worker.join();
+  server->workers.clear();
+  if (server->listen_socket != -1)
+  {
+    DfsCloseSocket((DfsSocket)server->listen_socket);
+    server->listen_socket = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+  }
+}
+
+bool DfsServerRequest(int port, const std::string& target, DfsServerResponse* response)
+{
+#ifdef _WIN32
+  WSADATA wsa_data;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+    return false;
+#endif
+  DfsSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons((unsigned short)port);
+  bool ok = s != INVALID_SOCKET && connect(s, (sockaddr*)&addr, sizeof(addr)) == 0;
+  std::string message;
+  if (ok)
+  {
+    std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    ok = send(s, request.data(), (int)request.size(), MSG_NOSIGNAL) == (int)request.size();
+    char buf[4096];
+    int n;
+    while (ok && (n = recv(s, buf, sizeof(buf), 0)) > 0)
+      message.append(buf, n);
+  }
+  if (s != INVALID_SOCKET)
+    DfsCloseSocket(s);
+#ifdef _WIN32
+  WSACleanup();
+#endif
+
+  // Status line "HTTP/1.1 200 OK", headers, and the body
+  size_t body_pos = message.find("\r\n\r\n");
+  if (!ok || message.compare(0, 5, "HTTP/") != 0 || body_pos == std::string::npos)
+    return false;
+  response->status = atoi(message.c_str() + message.find(' ') + 1);
+  size_t type_pos = message.find("Content-Type: ");
+  if (type_pos != std::string::npos && type_pos < body_pos)
+  {
+    type_pos += 14;
+    response->content_type = message.substr(type_pos, message.find("\r\n", type_pos) - type_pos);
+  }
+  response->body = message.substr(body_pos + 4);
+  return true;
+}
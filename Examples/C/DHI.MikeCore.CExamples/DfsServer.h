@@ -0,0 +1,78 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Local query server in front of dfs files.
+ *
+ * A minimal HTTP server on the loopback interface, answering GET requests for point values,
+ * point time series, bounding box fields and statistics. Files are opened through the file
+ * cache, DfsCache.h, such that repeated queries do not open the file and read the mesh again,
+ * and queries of the same file read concurrently, each with a handle of its own, DfsHandlePool.h.
+ * Connections are accepted on one thread, and queries are answered by a pool of workers.
+ * Idle connections are dropped after request_timeout_ms, such that they can not block the workers.
+ *
+ *   /info?file=F                                    Items, elements and time steps
+ *   /point?file=F&item=1&tstep=0&elmt=100           Value of element in time step
+ *   /series?file=F&item=1&elmt=100                  Times and values of element, all time steps
+ *   /field?file=F&item=1&tstep=0&x0=&y0=&x1=&y1=    Elements with center inside the box, dfsu and dfs2 files
+ *   /stats?file=F&item=1&tstep=0                    Min, max, mean and count of values that are not delete values
+ *
+ * The file is relative to the root folder of the server. Items are 1 based, time steps and
+ * elements zero based. Times are in seconds, since 1970-01-01 for calendar axes.
+ * Responses are JSON, delete values being null. With &format=binary, responses are arrays of
+ * doubles, delete values being NaN: point the value, series the times followed by the values,
+ * field the element indices followed by the values, and stats min, max, mean and count.
+ */
+
+/** Response to a query */
+struct DfsServerResponse
+{
+  int         status = 200;                           ///< HTTP status code
+  std::string content_type = "application/json";
+  std::string body;
+};
+
+/** Server state */
+struct DfsServer
+{
+  std::string root;                 ///< Root folder of files, including a final separator
+  int         port = 0;             ///< Port listened on
+  intptr_t    listen_socket = -1;
+  int         request_timeout_ms = 5000;  ///< Connections not sending a complete request within this time are dropped
+
+  std::thread              accept_thread;
+  std::vector<std::thread> workers;
+  std::mutex               mtx;
+  std::condition_variable  cv;
+  std::deque<intptr_t>     connections;   ///< Accepted connections, waiting for a worker
+  bool                     stop = false;
+};
+
+/**
+ * Answer a query, target being the path and query of the request, e.g. "/point?file=F&item=1&tstep=0&elmt=100".
+ * Files are relative to root. Thread safe.
+ */
+DfsServerResponse DfsServerQuery(const std::string& root, const std::string& target);
+
+/**
+ * Start the server on the loopback interface, listening on port, 0 for any free port,
+ * the port being returned in server->port. Returns false if the port can not be listened on.
+ */
+bool DfsServerStart(DfsServer* server, LPCTSTR root, int port = 0, int num_workers = 4);
+
+/** Stop accepting connections, and join the threads after answering the queries accepted */
+void DfsServerStop(DfsServer* server);
+
+/** Send a GET request for target to the server on port, on the loopback interface. Returns false if there is no answer */
+bool DfsServerRequest(int port, const std::string& target, DfsServerResponse* response);
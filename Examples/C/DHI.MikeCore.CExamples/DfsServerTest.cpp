@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsServer.h"
+#include <CppUnitTest.h>
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsServer_tests)
+  {
+  public:
+
+    /// Point, series, field and stats queries of OresundHD.dfs2, without a server
+    TEST_METHOD(QueryTest)
+    {
+      std::string root = TestDataPath();
+      DfsServerResponse response = DfsServerQuery(root, "/point?file=OresundHD.dfs2&item=1&tstep=2&elmt=287");
+      Assert::AreEqual(200, response.status);
+      Assert::IsTrue(response.body.find("\"value\":11.363") != std::string::npos);
+
+      response = DfsServerQuery(root, "/point?file=OresundHD.dfs2&item=1&tstep=2&elmt=287&format=binary");
+      Assert::AreEqual(sizeof(double), response.body.size());
+      double value;
+      memcpy(&value, response.body.data(), sizeof(double));
+      Assert::AreEqual(11.3634329, value, 1e-6);
+
+      // 13 times followed by 13 values
+      response = DfsServerQuery(root, "/series?file=OresundHD.dfs2&item=1&elmt=287&format=binary");
+      Assert::AreEqual(2 * 13 * sizeof(double), response.body.size());
+      std::vector<double> series(2 * 13);
+      memcpy(series.data(), response.body.data(), response.body.size());
+      Assert::AreEqual(11.3634329, series[13 + 2], 1e-6);
+      Assert::IsTrue(series[1] > series[0]);
+
+      // Full grid, land being delete values
+      response = DfsServerQuery(root, "/stats?file=OresundHD.dfs2&item=1&tstep=2&format=binary");
+      std::vector<double> stats(4);
+      memcpy(stats.data(), response.body.data(), response.body.size());
+      Assert::IsTrue(stats[0] <= 11.3634329 && 11.3634329 <= stats[1]);
+      Assert::IsTrue(stats[3] > 0 && stats[3] < 71 * 91);
+
+      response = DfsServerQuery(root, "/field?file=OresundHD.dfs2&item=1&tstep=2&x0=-1e10&y0=-1e10&x1=1e10&y1=1e10&format=binary");
+      Assert::AreEqual(2 * 71 * 91 * sizeof(double), response.body.size());
+
+      Assert::AreEqual(400, DfsServerQuery(root, "/point?file=OresundHD.dfs2&item=4&tstep=2&elmt=287").status);
+      Assert::AreEqual(400, DfsServerQuery(root, "/point?file=..%2FOresundHD.dfs2&item=1&tstep=2&elmt=287").status);
+      Assert::AreEqual(404, DfsServerQuery(root, "/point?file=nonexisting.dfs2&item=1&tstep=2&elmt=287").status);
+    }
+
+    /// Queries through the server on the loopback interface
+    TEST_METHOD(ServerTest)
+    {
+      DfsServer server;
+      Assert::IsTrue(DfsServerStart(&server, TestDataPath(), 0, 2));
+      Assert::IsTrue(server.port > 0);
+
+      DfsServerResponse response;
+      Assert::IsTrue(DfsServerRequest(server.port, "/info?file=OresundHD.dfsu", &response));
+      Assert::AreEqual(200, response.status);
+      Assert::AreEqual(std::string("application/json"), response.content_type);
+      Assert::IsTrue(response.body.find("\"timesteps\":") != std::string::npos);
+
+      Assert::IsTrue(DfsServerRequest(server.port, "/field?file=OresundHD.dfsu&item=1&tstep=0&x0=-1e10&y0=-1e10&x1=1e10&y1=1e10", &response));
+      Assert::AreEqual(200, response.status);
+      Assert::IsTrue(response.body.find("\"elmts\":[0,1,") != std::string::npos);
+
+      Assert::IsTrue(DfsServerRequest(server.port, "/unknown?file=OresundHD.dfsu", &response));
+      Assert::AreEqual(404, response.status);
+
+      DfsServerStop(&server);
+      Assert::IsFalse(DfsServerRequest(server.port, "/info?file=OresundHD.dfsu", &response));
+    }
+
+  };
+}
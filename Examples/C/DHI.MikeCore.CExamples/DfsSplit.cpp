@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsSplit.h"
+
+#include <CppUnitTestLogger.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <thread>
+
+
+/** State shared by the reader and the writers: Slots of time steps, and progress */
+struct DfsSplitState
+{
+  long   num_timesteps = 0;
+  long   num_items = 0;
+  int    queue_depth = 0;
+  std::vector<size_t> item_offsets;   ///< Offset of each item in slot, in number of doubles
+  size_t              slot_size = 0;  ///< Size of one slot, in number of doubles
+  std::vector<double> slots;          ///< double, for alignment of both float and double data
+  std::vector<double> times;          ///< Time of each item-timestep in each slot
+
+  std::mutex              mtx;
+  std::condition_variable cv;
+  long              produced = 0;     ///< Number of time steps read
+  std::vector<long> written;          ///< Number of time steps written, per output
+  bool              failed = false;   ///< Set on read or write errors, ending the split
+};
+
+/** Writer thread of output k, writing the items of the output of each time step */
+static void DfsSplitWriter(DfsSplitState* state, const DfsSplitOutput* output, LPHEAD pdfsWr, LPFILE fpWr, size_t k)
+{
+  for (long i_tstep = 0; i_tstep < state->num_timesteps; i_tstep++)
+  {
+    {
+      std::unique_lock<std::mutex> lock(state->mtx);
+      state->cv.wait(lock, [&] { return state->failed || state->produced > i_tstep; });
+      if (state->failed)
+        return;
+    }
+    int slot = i_tstep % state->queue_depth;
+    long rc = F_NO_ERROR;
+    for (size_t i = 0; i < output->items.size() && rc == F_NO_ERROR; i++)
+    {
+      int i_item = output->items[i];
+      double* data = &state->slots[slot * state->slot_size + state->item_offsets[i_item - 1]];
+      rc = dfsWriteItemTimeStep(pdfsWr, fpWr, state->times[slot * state->num_items + i_item - 1], data);
+    }
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      if (rc == F_NO_ERROR)
+        state->written[k] = i_tstep + 1;
+      else
+      {
+        LOG("Error writing dynamic item data: %s (%li - %s)", output->filename.c_str(), rc, GetRCString(rc));
+        state->failed = true;
+      }
+    }
+    state->cv.notify_all();
+    if (rc != F_NO_ERROR)
+      return;
+  }
+}
+
+long DfsSplitFile(LPCTSTR inputFilename, const std::vector<DfsSplitOutput>& outputs, int queue_depth)
+{
+  LPHEAD pdfsIn;
+  LPFILE fpIn;
+  long rc = dfsFileRead(inputFilename, &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening file");
+
+  DfsSplitState state;
+  state.num_items = dfsGetNoOfItems(pdfsIn);
+  state.queue_depth = std::max(1, queue_depth);
+  bool ok = true;
+  for (const DfsSplitOutput& output : outputs)
+  {
+    for (int i_item : output.items)
+    {
+      if (i_item < 1 || i_item > state.num_items)
+      {
+        LOG("Item %d of output %s is not in the input file", i_item, output.filename.c_str());
+        ok = false;
+      }
+    }
+  }
+  if (!ok)
+  {
+    rc = dfsFileClose(pdfsIn, &fpIn);
+    rc = dfsHeaderDestroy(&pdfsIn);
+    return -1;
+  }
+
+  // Create outputs, static items being read again for each output
+  std::vector<LPHEAD> pdfsWr(outputs.size());
+  std::vector<LPFILE> fpWr(outputs.size());
+  for (size_t k = 0; k < outputs.size(); k++)
+  {
+    const DfsSplitOutput& output = outputs[k];
+    state.num_timesteps = CreateDfsHeaderFromSource(pdfsIn, &pdfsWr[k], (long)output.items.size());
+    CopyDfsDynamicItemInfo(pdfsIn, pdfsWr[k], output.items.data(), (int)output.items.size());
+    rc = dfsFileCreate(output.filename.c_str(), pdfsWr[k], &fpWr[k]);
+    CheckRc(rc, "Error creating file");
+    if (k > 0)
+    {
+      rc = dfsFindBlockStatic(pdfsIn, fpIn);
+      CheckRc(rc, "Error finding static items");
+    }
+    CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr[k], fpWr[k]);
+  }
+
+  // Slots of all items of a time step
+  state.item_offsets.resize(state.num_items);
+  for (int i_item = 1; i_item <= state.num_items; i_item++)
+  {
+    state.item_offsets[i_item - 1] = state.slot_size;
+    state.slot_size += (dfsGetItemBytes(dfsItemD(pdfsIn, i_item)) + sizeof(double) - 1) / sizeof(double);
+  }
+  state.slots.resize(state.queue_depth * state.slot_size);
+  state.times.resize(state.queue_depth * state.num_items);
+  state.written.assign(outputs.size(), 0);
+
+  std::vector<std::thread> writers;
+  for (size_t k = 0; k < outputs.size(); k++)
+    writers.emplace_back(DfsSplitWriter, &state, &outputs[k], pdfsWr[k], fpWr[k], k);
+
+  if (state.num_timesteps > 0)
+  {
+    rc = dfsFindTimeStep(pdfsIn, fpIn, 0);
+    CheckRc(rc, "Error finding time step");
+  }
+  for (long i_tstep = 0; i_tstep < state.num_timesteps; i_tstep++)
+  {
+    // Wait for the slowest writer to free the slot
+    {
+      std::unique_lock<std::mutex> lock(state.mtx);
+      state.cv.wait(lock, [&]
+      {
+        return state.failed || outputs.empty() || i_tstep - *std::min_element(state.written.begin(), state.written.end()) < state.queue_depth;
+      });
+      if (state.failed)
+        break;
+    }
+    int slot = i_tstep % state.queue_depth;
+    rc = F_NO_ERROR;
+    for (int i_item = 1; i_item <= state.num_items && rc == F_NO_ERROR; i_item++)
+      rc = dfsReadItemTimeStep(pdfsIn, fpIn, &state.times[slot * state.num_items + i_item - 1], &state.slots[slot * state.slot_size + state.item_offsets[i_item - 1]]);
+    {
+      std::lock_guard<std::mutex> lock(state.mtx);
+      if (rc == F_NO_ERROR)
+        state.produced = i_tstep + 1;
+      else
+      {
+        LOG("Error reading dynamic item data (%li - %s)", rc, GetRCString(rc));
+        state.failed = true;
+      }
+    }
+    state.cv.notify_all();
+    if (rc != F_NO_ERROR)
+      break;
+  }
+
+  for (std::thread& writer : writers)
+    writer.join();
+  for (size_t k = 0; k < outputs.size(); k++)
+  {
+    rc = dfsFileClose(pdfsWr[k], &fpWr[k]);
+    CheckRc(rc, "Error closing file");
+    rc = dfsHeaderDestroy(&pdfsWr[k]);
+  }
+  rc = dfsFileClose(pdfsIn, &fpIn);
+  rc = dfsHeaderDestroy(&pdfsIn);
+  return state.failed ? -1 : F_NO_ERROR;
+}
+
+std::vector<DfsSplitOutput> DfsSplitPerItem(LPCTSTR inputFilename, LPCTSTR outputPrefix)
+{
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(inputFilename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfs);
+  rc = dfsFileClose(pdfs, &fp);
+  rc = dfsHeaderDestroy(&pdfs);
+
+  const char* extension = strrchr(inputFilename, '.');
+  std::vector<DfsSplitOutput> outputs(num_items);
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    outputs[i_item - 1].filename = std::string(outputPrefix) + std::to_string(i_item) + (extension ? extension : "");
+    outputs[i_item - 1].items.push_back(i_item);
+  }
+  return outputs;
+}
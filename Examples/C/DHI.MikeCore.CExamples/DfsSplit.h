@@ -0,0 +1,41 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Split a dfs file into several output files in one pass.
+ *
+ * Each output gets a selection of the items of the input file, e.g. one output per item.
+ * Each time step of the input is read once, into a ring of queue_depth slots, and every
+ * output is written on a thread of its own, with its own pdfs and fp, from the slots.
+ * The reader waits when it is queue_depth time steps ahead of the slowest writer, such
+ * that memory usage is bounded, and the outputs are written concurrently instead of in
+ * one pass over the input per output.
+ *
+ * Outputs get the header, time axis, custom blocks and static items of the input.
+ */
+
+/** Output of a split */
+struct DfsSplitOutput
+{
+  std::string      filename;
+  std::vector<int> items;     ///< Items of the input file, 1 based, in the order of the output
+};
+
+/**
+ * Split inputFilename into outputs, reading each time step once. queue_depth is the
+ * number of time steps read ahead of the slowest writer.
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long DfsSplitFile(LPCTSTR inputFilename, const std::vector<DfsSplitOutput>& outputs, int queue_depth = 4);
+
+/**
+ * Outputs of one file per item of inputFilename, named outputPrefix followed by the
+ * item number and the extension of inputFilename, e.g. "out_2.dfs2".
+ */
+std::vector<DfsSplitOutput> DfsSplitPerItem(LPCTSTR inputFilename, LPCTSTR outputPrefix);
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsSplit.h"
+#include <CppUnitTest.h>
+
+#include <string>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsSplit_tests)
+  {
+  public:
+
+    /// Read value of item-timestep of file
+    static float ReadValue(LPCTSTR filename, long tstep, int i_item, size_t index, long* num_items)
+    {
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(filename, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      *num_items = dfsGetNoOfItems(pdfs);
+      std::vector<float> data(dfsGetItemElements(dfsItemD(pdfs, i_item)));
+      double time;
+      rc = dfsFindItemDynamic(pdfs, fp, tstep, i_item);
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+      CheckRc(rc, "Error reading item-timestep");
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      return data[index];
+    }
+
+    /// Split OresundHD.dfs2 into one file per item, and one file of items 3 and 1, in one pass
+    TEST_METHOD(SplitTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char prefixFullPath[_MAX_PATH];
+      snprintf(prefixFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Csplit");
+
+      std::vector<DfsSplitOutput> outputs = DfsSplitPerItem(inputFullPath, prefixFullPath);
+      Assert::AreEqual((size_t)3, outputs.size());
+      Assert::AreEqual(std::string(prefixFullPath) + "2.dfs2", outputs[1].filename);
+      DfsSplitOutput output31;
+      output31.filename = std::string(prefixFullPath) + "31.dfs2";
+      output31.items = { 3, 1 };
+      outputs.push_back(output31);
+
+      // Queue depth 1, writers waiting for each other
+      Assert::AreEqual((long)F_NO_ERROR, DfsSplitFile(inputFullPath, outputs, 1));
+
+      long num_items;
+      float expected = ReadValue(inputFullPath, 2, 1, 71 * 4 + 3, &num_items);
+      Assert::AreEqual(11.3634329f, expected, 1e-5f);
+      Assert::AreEqual(expected, ReadValue(outputs[0].filename.c_str(), 2, 1, 71 * 4 + 3, &num_items));
+      Assert::AreEqual(1L, num_items);
+      Assert::AreEqual(expected, ReadValue(outputs[3].filename.c_str(), 2, 2, 71 * 4 + 3, &num_items));
+      Assert::AreEqual(2L, num_items);
+      Assert::AreEqual(ReadValue(inputFullPath, 12, 3, 71 * 40 + 30, &num_items),
+                       ReadValue(outputs[2].filename.c_str(), 12, 1, 71 * 40 + 30, &num_items));
+
+      DfsSplitOutput invalid;
+      invalid.filename = std::string(prefixFullPath) + "4.dfs2";
+      invalid.items = { 4 };
+      Assert::AreEqual(-1L, DfsSplitFile(inputFullPath, { invalid }));
+    }
+
+  };
+}
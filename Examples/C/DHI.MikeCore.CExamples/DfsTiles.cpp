@@ -0,0 +1,314 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsTiles.h"
+
+#include <CppUnitTestLogger.h>
+#include <algorithm>
+#include <string.h>
+
+
+/** Tile file header, at the start of the file */
+struct DfsTilesHeader
+{
+  char     magic[8];          ///< "DFSTILE1"
+  uint32_t num_items;
+  uint32_t num_timesteps;
+  uint32_t tile_size[3];
+  uint32_t reserved0;
+  uint64_t index_offset;      ///< Item grids, times and item-timestep offsets
+  uint64_t reserved[3];
+};
+
+/** Grid of one item, as stored in the index */
+struct DfsTilesItemGrid
+{
+  uint32_t dims[3];
+  uint32_t width;
+};
+
+static const char DfsTilesMagic[8] = { 'D', 'F', 'S', 'T', 'I', 'L', 'E', '1' };
+
+/** Set up number of tiles and tile offsets of item, from item dims and width */
+static void DfsTilesSetupItem(DfsTilesItem& item, const uint32_t* tile_size)
+{
+  for (int d = 0; d < 3; d++)
+    item.ntiles[d] = (item.dims[d] + tile_size[d] - 1) / tile_size[d];
+  item.tile_offsets.clear();
+  uint64_t offset = 0;
+  for (uint32_t tl = 0; tl < item.ntiles[2]; tl++)
+    for (uint32_t tk = 0; tk < item.ntiles[1]; tk++)
+      for (uint32_t tj = 0; tj < item.ntiles[0]; tj++)
+      {
+        item.tile_offsets.push_back(offset);
+        uint64_t ext_j = std::min(tile_size[0], item.dims[0] - tj * tile_size[0]);
+        uint64_t ext_k = std::min(tile_size[1], item.dims[1] - tk * tile_size[1]);
+        uint64_t ext_l = std::min(tile_size[2], item.dims[2] - tl * tile_size[2]);
+        offset += ext_j * ext_k * ext_l * item.width;
+      }
+}
+
+/** Get grid dimensions of dynamic item, returns false if not an equidistant 2D or 3D axis */
+static bool DfsTilesGetItemDims(LPITEM item, uint32_t* dims)
+{
+  LONG    eum_unit;
+  LPCTSTR eum_unit_str;
+  LONG    j, k, l;
+  float   x0, y0, z0, dx, dy, dz;
+  switch (dfsGetItemAxisType(item))
+  {
+  case F_EQ_AXIS_D2:
+    dfsGetItemAxisEqD2(item, &eum_unit, &eum_unit_str, &j, &k, &x0, &y0, &dx, &dy);
+    l = 1;
+    break;
+  case F_EQ_AXIS_D3:
+    dfsGetItemAxisEqD3(item, &eum_unit, &eum_unit_str, &j, &k, &l, &x0, &y0, &z0, &dx, &dy, &dz);
+    break;
+  default:
+    return false;
+  }
+  dims[0] = j;
+  dims[1] = k;
+  dims[2] = l;
+  return true;
+}
+
+long DfsTilesWrite(LPCTSTR dfsFilename, LPCTSTR tileFilename, int tile_j, int tile_k, int tile_l)
+{
+  if (tile_j < 1 || tile_k < 1 || tile_l < 1)
+  {
+    LOG("Tile size must be positive: %d x %d x %d", tile_j, tile_k, tile_l);
+    return -1;
+  }
+
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(dfsFilename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfs);
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+
+  DfsTilesHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DfsTilesMagic, 8);
+  header.num_items = num_items;
+  header.num_timesteps = num_timesteps;
+  header.tile_size[0] = tile_j;
+  header.tile_size[1] = tile_k;
+  header.tile_size[2] = tile_l;
+
+  std::vector<DfsTilesItem> items(num_items);
+  std::vector<DfsTilesItemGrid> grids(num_items);
+  long max_bytes = 0;
+  bool ok = true;
+  for (int i_item = 1; i_item <= num_items && ok; i_item++)
+  {
+    LPITEM item = dfsItemD(pdfs, i_item);
+    DfsTilesItem& titem = items[i_item - 1];
+    ok = DfsTilesGetItemDims(item, titem.dims);
+    if (!ok)
+    {
+      LOG("Item %d is not an equidistant 2D or 3D item: %s", i_item, dfsFilename);
+      break;
+    }
+    long num_elmts = dfsGetItemElements(item);
+    titem.width = num_elmts > 0 ? dfsGetItemBytes(item) / num_elmts : 1;
+    DfsTilesSetupItem(titem, header.tile_size);
+    memcpy(grids[i_item - 1].dims, titem.dims, sizeof(titem.dims));
+    grids[i_item - 1].width = titem.width;
+    if (dfsGetItemBytes(item) > max_bytes)
+      max_bytes = dfsGetItemBytes(item);
+  }
+
+  FILE* ft = nullptr;
+  if (ok)
+  {
+    ft = fopen(tileFilename, "wb");
+    ok = ft && fwrite(&header, sizeof(header), 1, ft) == 1;
+    if (!ok)
+      LOG("Error creating tile file: %s", tileFilename);
+  }
+
+  // Cut each item-timestep into tiles
+  std::vector<uint8_t> slab(max_bytes);
+  std::vector<uint8_t> tiles(max_bytes);
+  std::vector<double> times;
+  std::vector<uint64_t> offsets;
+  uint64_t pos = sizeof(header);
+  if (ok)
+  {
+    rc = dfsFindTimeStep(pdfs, fp, 0);
+    CheckRc(rc, "Error finding time step");
+  }
+  for (long i_tstep = 0; i_tstep < num_timesteps && ok; i_tstep++)
+  {
+    for (int i_item = 1; i_item <= num_items && ok; i_item++)
+    {
+      const DfsTilesItem& titem = items[i_item - 1];
+      double time;
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, slab.data());
+      CheckRc(rc, "Error reading dynamic item data");
+      if (i_item == 1)
+        times.push_back(time);
+
+      size_t w = titem.width;
+      size_t t = 0;
+      for (uint32_t tl = 0; tl < titem.ntiles[2]; tl++)
+        for (uint32_t tk = 0; tk < titem.ntiles[1]; tk++)
+          for (uint32_t tj = 0; tj < titem.ntiles[0]; tj++, t++)
+          {
+            size_t j0 = tj * header.tile_size[0];
+            size_t k0 = tk * header.tile_size[1];
+            size_t l0 = tl * header.tile_size[2];
+            size_t ext_j = std::min((size_t)header.tile_size[0], titem.dims[0] - j0);
+            size_t ext_k = std::min((size_t)header.tile_size[1], titem.dims[1] - k0);
+            size_t ext_l = std::min((size_t)header.tile_size[2], titem.dims[2] - l0);
+            uint8_t* dst = &tiles[titem.tile_offsets[t]];
+            for (size_t l = 0; l < ext_l; l++)
+              for (size_t k = 0; k < ext_k; k++)
+              {
+                size_t src = ((l0 + l) * titem.dims[1] + k0 + k) * titem.dims[0] + j0;
+                memcpy(dst + (l * ext_k + k) * ext_j * w, &slab[src * w], ext_j * w);
+              }
+          }
+
+      size_t bytes = dfsGetItemBytes(dfsItemD(pdfs, i_item));
+      offsets.push_back(pos);
+      ok = fwrite(tiles.data(), 1, bytes, ft) == bytes;
+      pos += bytes;
+    }
+  }
+
+  // Index at the end, and update header with its location
+  header.index_offset = pos;
+  if (ft && ok)
+    ok = fwrite(grids.data(), sizeof(DfsTilesItemGrid), num_items, ft) == (size_t)num_items &&
+         fwrite(times.data(), sizeof(double), times.size(), ft) == times.size() &&
+         fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), ft) == offsets.size() &&
+         _fseeki64(ft, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, ft) == 1;
+  if (ft && fclose(ft) != 0)
+    ok = false;
+  if (ft && !ok)
+    LOG("Error writing tile file: %s", tileFilename);
+
+  rc = dfsFileClose(pdfs, &fp);
+  rc = dfsHeaderDestroy(&pdfs);
+  return ok ? F_NO_ERROR : -1;
+}
+
+bool DfsTilesOpen(DfsTilesReader* reader, LPCTSTR tileFilename)
+{
+  DfsTilesHeader header;
+  reader->fp = fopen(tileFilename, "rb");
+  bool ok = reader->fp && fread(&header, sizeof(header), 1, reader->fp) == 1 &&
+            memcmp(header.magic, DfsTilesMagic, 8) == 0 &&
+            header.tile_size[0] > 0 && header.tile_size[1] > 0 && header.tile_size[2] > 0;
+  std::vector<DfsTilesItemGrid> grids;
+  if (ok)
+  {
+    reader->num_items = header.num_items;
+    reader->num_timesteps = header.num_timesteps;
+    memcpy(reader->tile_size, header.tile_size, sizeof(header.tile_size));
+    grids.resize(header.num_items);
+    reader->times.resize(header.num_timesteps);
+    reader->offsets.resize((size_t)header.num_items * header.num_timesteps);
+    ok = _fseeki64(reader->fp, header.index_offset, SEEK_SET) == 0 &&
+         fread(grids.data(), sizeof(DfsTilesItemGrid), grids.size(), reader->fp) == grids.size() &&
+         fread(reader->times.data(), sizeof(double), reader->times.size(), reader->fp) == reader->times.size() &&
+         fread(reader->offsets.data(), sizeof(uint64_t), reader->offsets.size(), reader->fp) == reader->offsets.size();
+  }
+  if (ok)
+  {
+    reader->items.resize(header.num_items);
+    for (size_t i = 0; i < grids.size(); i++)
+    {
+      memcpy(reader->items[i].dims, grids[i].dims, sizeof(grids[i].dims));
+      reader->items[i].width = grids[i].width;
+      DfsTilesSetupItem(reader->items[i], reader->tile_size);
+    }
+  }
+  else
+  {
+    LOG("Not a valid tile file: %s", tileFilename);
+    DfsTilesClose(reader);
+  }
+  return ok;
+}
+
+long DfsTilesReadWindow(DfsTilesReader* reader, long tstep, int item,
+                        long j0, long k0, long l0, long nj, long nk, long nl,
+                        double* time, void* data)
+{
+  if (tstep < 0 || tstep >= (long)reader->num_timesteps)
+    return F_FAIL_ILLEGEAL_TSTEP;
+  if (item < 1 || item > (int)reader->num_items)
+    return F_FAIL_ILLEGEAL_ITEM;
+  const DfsTilesItem& titem = reader->items[item - 1];
+  const long start[3] = { j0, k0, l0 };
+  const long count[3] = { nj, nk, nl };
+  for (int d = 0; d < 3; d++)
+  {
+    if (start[d] < 0 || count[d] < 1 || start[d] + count[d] > (long)titem.dims[d])
+    {
+      LOG("Window outside grid in direction %d: start %ld, count %ld, size %u", d, start[d], count[d], titem.dims[d]);
+      return F_ERR_DATA;
+    }
+  }
+
+  const uint32_t* ts = reader->tile_size;
+  uint64_t base = reader->offsets[(size_t)tstep * reader->num_items + item - 1];
+  size_t w = titem.width;
+  uint8_t* out = (uint8_t*)data;
+
+  // Visit all tiles overlapping the window
+  for (uint32_t tl = l0 / ts[2]; tl <= (l0 + nl - 1) / ts[2]; tl++)
+    for (uint32_t tk = k0 / ts[1]; tk <= (k0 + nk - 1) / ts[1]; tk++)
+      for (uint32_t tj = j0 / ts[0]; tj <= (j0 + nj - 1) / ts[0]; tj++)
+      {
+        // Tile origin and extent, and window part of tile in tile local cells [a, b)
+        long origin[3] = { (long)(tj * ts[0]), (long)(tk * ts[1]), (long)(tl * ts[2]) };
+        long ext[3], a[3], b[3];
+        for (int d = 0; d < 3; d++)
+        {
+          ext[d] = std::min((long)ts[d], (long)titem.dims[d] - origin[d]);
+          a[d] = std::max(start[d], origin[d]) - origin[d];
+          b[d] = std::min(start[d] + count[d], origin[d] + ext[d]) - origin[d];
+        }
+
+        // Read only the span of the tile from the first to the last cell of the window
+        size_t first = (a[2] * ext[1] + a[1]) * ext[0] + a[0];
+        size_t last  = ((b[2] - 1) * ext[1] + b[1] - 1) * ext[0] + b[0] - 1;
+        size_t bytes = (last - first + 1) * w;
+        reader->buffer.resize(bytes);
+        size_t t = (tl * titem.ntiles[1] + tk) * titem.ntiles[0] + tj;
+        if (_fseeki64(reader->fp, base + titem.tile_offsets[t] + first * w, SEEK_SET) != 0 ||
+            fread(reader->buffer.data(), 1, bytes, reader->fp) != bytes)
+          return F_ERR_READ;
+        reader->num_tiles_read++;
+
+        for (long l = a[2]; l < b[2]; l++)
+          for (long k = a[1]; k < b[1]; k++)
+          {
+            size_t src = (l * ext[1] + k) * ext[0] + a[0] - first;
+            size_t dst = ((origin[2] + l - l0) * nk + origin[1] + k - k0) * nj + origin[0] + a[0] - j0;
+            memcpy(out + dst * w, &reader->buffer[src * w], (b[0] - a[0]) * w);
+          }
+      }
+
+  *time = reader->times[tstep];
+  return F_NO_ERROR;
+}
+
+void DfsTilesClose(DfsTilesReader* reader)
+{
+  if (reader->fp)
+    fclose(reader->fp);
+  reader->fp = nullptr;
+  reader->items.clear();
+  reader->times.clear();
+  reader->offsets.clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+ * Tiled cache of the dynamic items of a dfs2 or dfs3 file.
+ *
+ * A dfs file stores each item-timestep as one contiguous slab, so reading a small
+ * window requires reading the entire grid. The tile file splits each item-timestep
+ * into tiles of tile_j x tile_k x tile_l cells, each tile stored contiguously with
+ * j (x) running fastest, such that a window read only touches the tiles that overlap
+ * the window. Tiles at the upper grid edges are clipped to the grid size.
+ *
+ * The file consists of a header, the tiles of all item-timesteps, in the order
+ * time step, item, tile (l, k, j), and an index with the grid size of each item,
+ * the time of each time step and the file offset of each item-timestep.
+ */
+
+/** Grid and tiling of one item in a tile file */
+struct DfsTilesItem
+{
+  uint32_t dims[3];     ///< Number of cells in j, k and l direction, l is 1 for dfs2 items
+  uint32_t width;       ///< Size of one value, in bytes
+  uint32_t ntiles[3];   ///< Number of tiles in j, k and l direction
+  std::vector<uint64_t> tile_offsets;  ///< Offset of each tile relative to start of item-timestep
+};
+
+/** Tile file opened for reading */
+struct DfsTilesReader
+{
+  FILE*    fp = nullptr;
+  uint32_t num_items = 0;
+  uint32_t num_timesteps = 0;
+  uint32_t tile_size[3] = { 0, 0, 0 };
+  std::vector<DfsTilesItem> items;
+  std::vector<double>       times;     ///< Time of each time step, as returned by dfsReadItemTimeStep
+  std::vector<uint64_t>     offsets;   ///< Offset of (tstep, item) at offsets[tstep * num_items + item - 1]
+  std::vector<uint8_t>      buffer;    ///< Tile read buffer
+  long num_tiles_read = 0;             ///< Number of tiles read, for statistics
+};
+
+/**
+ * Transcode the dynamic items of a dfs2 or dfs3 file to a tile file.
+ * All dynamic items must have an equidistant 2D or 3D axis.
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long DfsTilesWrite(LPCTSTR dfsFilename, LPCTSTR tileFilename, int tile_j = 64, int tile_k = 64, int tile_l = 1);
+
+/** Open tile file for windowed reads. Returns false on failure */
+bool DfsTilesOpen(DfsTilesReader* reader, LPCTSTR tileFilename);
+
+/**
+ * Read window of nj x nk x nl cells starting at cell (j0, k0, l0) of one item-timestep,
+ * time step zero based and item one based, as dfsReadItemTimeStep. For dfs2 items use l0 = 0 and nl = 1.
+ * Data is returned with j running fastest, as in a dfs file with the window dimensions.
+ * Returns F_NO_ERROR on success.
+ */
+long DfsTilesReadWindow(DfsTilesReader* reader, long tstep, int item,
+                        long j0, long k0, long l0, long nj, long nk, long nl,
+                        double* time, void* data);
+
+void DfsTilesClose(DfsTilesReader* reader);
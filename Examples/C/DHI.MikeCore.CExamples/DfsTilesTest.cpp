@@ -0,0 +1,75 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsTiles.h"
+#include <CppUnitTest.h>
+
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsTiles_tests)
+  {
+  public:
+
+    /// Tile OresundHD.dfs2, and read windows from the tile file
+    TEST_METHOD(TileDfs2Test)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char tileFullPath[_MAX_PATH];
+      snprintf(tileFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_C.dfst");
+
+      long rc = DfsTilesWrite(inputFullPath, tileFullPath, 16, 16);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+
+      DfsTilesReader reader;
+      Assert::IsTrue(DfsTilesOpen(&reader, tileFullPath));
+      Assert::AreEqual((uint32_t)3, reader.num_items);
+      Assert::AreEqual((uint32_t)13, reader.num_timesteps);
+      Assert::AreEqual((uint32_t)71, reader.items[0].dims[0]);
+      Assert::AreEqual((uint32_t)91, reader.items[0].dims[1]);
+      Assert::AreEqual((uint32_t)5, reader.items[0].ntiles[0]);
+      Assert::AreEqual((uint32_t)6, reader.items[0].ntiles[1]);
+
+      // Single cell (3,4), see ReadDfs2Test, touches one tile only
+      float value;
+      double time;
+      rc = DfsTilesReadWindow(&reader, 2, 1, 3, 4, 0, 1, 1, 1, &time, &value);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::AreEqual(11.3634329f, value);
+      Assert::AreEqual(1L, reader.num_tiles_read);
+
+      // Window crossing tile boundaries must match the dfs file
+      long j0 = 10, k0 = 5, nj = 40, nk = 30;
+      std::vector<float> window(nj * nk);
+      rc = DfsTilesReadWindow(&reader, 7, 2, j0, k0, 0, nj, nk, 1, &time, window.data());
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      rc = DfsTilesReadWindow(&reader, 7, 2, 60, 80, 0, 20, 20, 1, &time, window.data());
+      Assert::AreEqual((long)F_ERR_DATA, rc);
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      std::vector<float> data(71 * 91);
+      double dfs_time;
+      rc = dfsFindItemDynamic(pdfs, fp, 7, 2);
+      CheckRc(rc, "Error finding item-timestep");
+      rc = dfsReadItemTimeStep(pdfs, fp, &dfs_time, data.data());
+      CheckRc(rc, "Error reading item-timestep");
+      Assert::AreEqual(dfs_time, time);
+      for (long k = 0; k < nk; k++)
+        for (long j = 0; j < nj; j++)
+          Assert::AreEqual(data[(k0 + k) * 71 + j0 + j], window[k * nj + j]);
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      DfsTilesClose(&reader);
+    }
+
+  };
+}
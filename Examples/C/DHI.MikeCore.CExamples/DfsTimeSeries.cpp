@@ -0,0 +1,296 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsTimeSeries.h"
+
+#include <CppUnitTestLogger.h>
+#include <math.h>
+#include <algorithm>
+
+
+/** Load all items from an open dfs0 file, from the first time step */
+static bool ReadDfsTimeSeries(LPHEAD pdfs, LPFILE fp, LPCTSTR dfs0Filename, DfsTimeSeries* ts)
+{
+  long num_items = dfsGetNoOfItems(pdfs);
+  std::vector<SimpleType> datatypes(num_items);
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LPITEM item = dfsItemD(pdfs, i_item);
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &datatypes[i_item - 1]);
+    if (dfsGetItemElements(item) != 1 || (datatypes[i_item - 1] != UFS_FLOAT && datatypes[i_item - 1] != UFS_DOUBLE))
+    {
+      LOG("Item %d is not a float or double item with one element: %s", i_item, dfs0Filename);
+      return false;
+    }
+  }
+
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  TimeAxisType taxis_type = GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+  TimeAxisType t;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep, tspan;
+  long n, neum_unit, index;
+  GetDfsTimeAxis(pdfs, &t, &n, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+  bool equidistant = taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS;
+
+  ts->num_items = num_items;
+  ts->num_timesteps = num_timesteps;
+  ts->calendar = taxis_type == F_CAL_EQ_AXIS || taxis_type == F_CAL_NEQ_AXIS;
+  ts->times.resize(num_timesteps);
+  ts->values.resize((size_t)num_items * num_timesteps);
+  ts->delete_value = dfsGetDeleteValDouble(pdfs);
+  float delete_float = dfsGetDeleteValFloat(pdfs);
+
+  long rc = F_NO_ERROR;
+  if (num_timesteps > 0)
+  {
+    rc = dfsFindTimeStep(pdfs, fp, 0);
+    CheckRc(rc, "Error finding time step");
+  }
+  for (long i_tstep = 0; i_tstep < num_timesteps; i_tstep++)
+  {
+    double time;
+    for (int i_item = 1; i_item <= num_items; i_item++)
+    {
+      double value;
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, &value);
+      CheckRc(rc, "Error reading dynamic item data");
+      if (datatypes[i_item - 1] == UFS_FLOAT)
+      {
+        float valuef = *(float*)&value;
+        value = valuef == delete_float ? ts->delete_value : valuef;
+      }
+      ts->Item(i_item)[i_tstep] = value;
+    }
+    // For equidistant axes the time returned is the time step index
+    if (equidistant)
+      ts->times[i_tstep] = start_sec + i_tstep * tstep_sec;
+    else
+      ts->times[i_tstep] = time * unit_sec + (ts->calendar ? DfsDateTimeToSeconds(start_date, start_time) : 0);
+  }
+  return true;
+}
+
+bool ReadDfsTimeSeries(LPCTSTR dfs0Filename, DfsTimeSeries* ts)
+{
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(dfs0Filename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+  bool ok = ReadDfsTimeSeries(pdfs, fp, dfs0Filename, ts);
+  rc = dfsFileClose(pdfs, &fp);
+  rc = dfsHeaderDestroy(&pdfs);
+  return ok;
+}
+
+/**
+ * Interval of each query time: Values i0 and i1 are combined with weight w as
+ * (1 - w) * v[i0] + w * v[i1]. i0 is -1 when the query time is outside the series.
+ */
+struct DfsInterpWeights
+{
+  std::vector<long>   i0, i1;
+  std::vector<double> w;
+};
+
+static void GetDfsInterpWeights(const double* times, long num_timesteps, const double* query_times, long num_queries,
+                                DfsInterpolationType interp_type, DfsInterpWeights* weights)
+{
+  weights->i0.resize(num_queries);
+  weights->i1.resize(num_queries);
+  weights->w.resize(num_queries);
+
+  bool sorted = true;
+  for (long q = 1; q < num_queries && sorted; q++)
+    sorted = query_times[q - 1] <= query_times[q];
+
+  // k is the last time step at or before the query time, -1 if before the first
+  long k = -1;
+  for (long q = 0; q < num_queries; q++)
+  {
+    double qt = query_times[q];
+    if (sorted)
+    {
+      // Sweep forward from the interval of the previous query
+      while (k + 1 < num_timesteps && times[k + 1] <= qt)
+        k++;
+    }
+    else
+      k = (long)(std::upper_bound(times, times + num_timesteps, qt) - times) - 1;
+
+    long i0 = -1, i1 = -1;
+    double w = 0;
+    bool at_time = k >= 0 && times[k] == qt;
+    if (at_time)
+      i0 = i1 = k;
+    else if (k >= 0 && k + 1 < num_timesteps)
+    {
+      switch (interp_type)
+      {
+      case DfsInterpLinear:
+        i0 = k;
+        i1 = k + 1;
+        w = (qt - times[k]) / (times[k + 1] - times[k]);
+        break;
+      case DfsInterpStepForward:
+        i0 = i1 = k;
+        break;
+      case DfsInterpStepBackward:
+        i0 = i1 = k + 1;
+        break;
+      }
+    }
+    weights->i0[q] = i0;
+    weights->i1[q] = i1;
+    weights->w[q] = w;
+  }
+}
+
+static void ApplyDfsInterpWeights(const DfsInterpWeights& weights, const double* values, double delete_value, double* result)
+{
+  long num_queries = (long)weights.w.size();
+  for (long q = 0; q < num_queries; q++)
+  {
+    long i0 = weights.i0[q];
+    if (i0 < 0)
+    {
+      result[q] = delete_value;
+      continue;
+    }
+    double v0 = values[i0];
+    double v1 = values[weights.i1[q]];
+    double w = weights.w[q];
+    if (v0 == delete_value || (w != 0 && v1 == delete_value))
+      result[q] = delete_value;
+    else
+      result[q] = w == 0 ? v0 : v0 + w * (v1 - v0);
+  }
+}
+
+void DfsInterpolate(const double* times, const double* values, long num_timesteps, double delete_value,
+                    const double* query_times, long num_queries, DfsInterpolationType interp_type, double* result)
+{
+  DfsInterpWeights weights;
+  GetDfsInterpWeights(times, num_timesteps, query_times, num_queries, interp_type, &weights);
+  ApplyDfsInterpWeights(weights, values, delete_value, result);
+}
+
+void DfsTimeSeriesInterpolate(const DfsTimeSeries& ts, const double* query_times, long num_queries,
+                              DfsInterpolationType interp_type, double* result)
+{
+  DfsInterpWeights weights;
+  GetDfsInterpWeights(ts.times.data(), ts.num_timesteps, query_times, num_queries, interp_type, &weights);
+  for (int i_item = 1; i_item <= ts.num_items; i_item++)
+    ApplyDfsInterpWeights(weights, ts.Item(i_item), ts.delete_value, result + (size_t)(i_item - 1) * num_queries);
+}
+
+void DfsTimeSeriesResample(const DfsTimeSeries& ts, double start, double step, long count,
+                           DfsInterpolationType interp_type, DfsTimeSeries* resampled)
+{
+  resampled->num_items = ts.num_items;
+  resampled->num_timesteps = count;
+  resampled->calendar = ts.calendar;
+  resampled->delete_value = ts.delete_value;
+  resampled->times.resize(count);
+  for (long i = 0; i < count; i++)
+    resampled->times[i] = start + i * step;
+  resampled->values.resize((size_t)ts.num_items * count);
+  DfsTimeSeriesInterpolate(ts, resampled->times.data(), count, interp_type, resampled->values.data());
+}
+
+long WriteDfsTimeSeriesData(LPHEAD pdfsWr, LPFILE fpWr, const DfsTimeSeries& ts)
+{
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  TimeAxisType taxis_type = GetDfsTimeAxisSeconds(pdfsWr, &start_sec, &tstep_sec, &num_timesteps);
+  TimeAxisType t;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep, tspan;
+  long n, neum_unit, index;
+  GetDfsTimeAxis(pdfsWr, &t, &n, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+  double base_sec = taxis_type == F_CAL_NEQ_AXIS ? DfsDateTimeToSeconds(start_date, start_time) : 0;
+  bool equidistant = taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS;
+
+  std::vector<SimpleType> datatypes(ts.num_items);
+  for (int i_item = 1; i_item <= ts.num_items; i_item++)
+  {
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    dfsGetItemInfo(dfsItemD(pdfsWr, i_item), &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &datatypes[i_item - 1]);
+  }
+  float delete_float = dfsGetDeleteValFloat(pdfsWr);
+  long rc = F_NO_ERROR;
+  for (long i_tstep = 0; i_tstep < ts.num_timesteps; i_tstep++)
+  {
+    // Inverse of the time conversion when reading
+    double time = equidistant ? (double)i_tstep : (ts.times[i_tstep] - base_sec) / unit_sec;
+    for (int i_item = 1; i_item <= ts.num_items; i_item++)
+    {
+      double value = ts.Item(i_item)[i_tstep];
+      if (datatypes[i_item - 1] == UFS_FLOAT)
+      {
+        float valuef = value == ts.delete_value ? delete_float : (float)value;
+        rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time, &valuef);
+      }
+      else
+        rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time, &value);
+      CheckRc(rc, "Error writing dynamic item data");
+    }
+  }
+  return rc;
+}
+
+long DfsTimeSeriesResampleFile(LPCTSTR dfs0Filename, LPCTSTR outputFilename, double tstep_sec, DfsInterpolationType interp_type)
+{
+  if (tstep_sec <= 0)
+  {
+    LOG("Time step must be positive: %g", tstep_sec);
+    return -1;
+  }
+  DfsTimeSeries ts;
+  if (!ReadDfsTimeSeries(dfs0Filename, &ts))
+    return -1;
+
+  // Equidistant times in seconds, from the first time to the last time of the input
+  double start = ts.num_timesteps > 0 ? ts.times[0] : 0;
+  double span = ts.num_timesteps > 0 ? ts.times[ts.num_timesteps - 1] - start : 0;
+  long count = ts.num_timesteps > 0 ? (long)floor(span / tstep_sec + 1e-9) + 1 : 0;
+  DfsTimeSeries resampled;
+  DfsTimeSeriesResample(ts, start, tstep_sec, count, interp_type, &resampled);
+
+  LPHEAD pdfsIn, pdfsWr;
+  LPFILE fpIn, fpWr;
+  long rc = dfsFileRead(dfs0Filename, &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfsIn);
+  CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+  // Time axis in seconds, whole seconds in the calendar start date and time
+  if (ts.calendar)
+  {
+    char date[11], time[9];
+    DfsSecondsToDateTime(start, date, time);
+    rc = dfsSetEqCalendarAxis(pdfsWr, date, time, 1400, start - floor(start), tstep_sec, 0);
+  }
+  else
+    rc = dfsSetEqTimeAxis(pdfsWr, 1400, start, tstep_sec, 0);
+  CheckRc(rc, "Error setting time axis");
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+  rc = dfsFileCreate(outputFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating file");
+  CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
+  rc = dfsFileClose(pdfsIn, &fpIn);
+  rc = dfsHeaderDestroy(&pdfsIn);
+
+  WriteDfsTimeSeriesData(pdfsWr, fpWr, resampled);
+
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  return count;
+}
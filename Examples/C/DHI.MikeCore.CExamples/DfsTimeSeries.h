@@ -0,0 +1,83 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <vector>
+
+/**
+ * In-memory time series engine for dfs0 files.
+ *
+ * All items of a dfs0 file are loaded into contiguous arrays, the times of all
+ * time steps in one array and the values of each item in one array, such that
+ * values at arbitrary times can be found without going through the file.
+ * This is useful for files with a non-equidistant time axis, where the time of each
+ * value comes with the value, and finding the value at a given time requires a search.
+ *
+ * Interpolation is batched: The interval of each query time is found once, by a
+ * merge-like sweep if the query times are sorted, otherwise by binary search, and
+ * then applied to all items. Interpolating many gauges to the same model time steps
+ * thereby costs one search for all gauges.
+ */
+
+/** Interpolation between time steps */
+enum DfsInterpolationType
+{
+  DfsInterpLinear       = 0,  ///< Linear between the two neighbouring time steps
+  DfsInterpStepForward  = 1,  ///< Value of a time step holds until the next time step
+  DfsInterpStepBackward = 2,  ///< Value of a time step holds from the previous time step
+};
+
+/** All items of a dfs0 file in memory */
+struct DfsTimeSeries
+{
+  long num_items = 0;
+  long num_timesteps = 0;
+  bool calendar = false;          ///< Calendar axis: Times are seconds since 1970-01-01, otherwise relative to the time axis
+  std::vector<double> times;      ///< Time of each time step, in seconds
+  std::vector<double> values;     ///< Values, item by item, num_timesteps values for each item
+  double delete_value = 1e-255;   ///< Delete value, float delete values are converted to this
+
+  /** Values of item, 1 based */
+  const double* Item(int i_item) const { return values.data() + (size_t)(i_item - 1) * num_timesteps; }
+  double* Item(int i_item) { return values.data() + (size_t)(i_item - 1) * num_timesteps; }
+};
+
+/**
+ * Load all items of a dfs0 file. Items must have one element of type float or double.
+ * Returns false if the file is not such a dfs0 file.
+ */
+bool ReadDfsTimeSeries(LPCTSTR dfs0Filename, DfsTimeSeries* ts);
+
+/**
+ * Interpolate values of all items at the query times, in seconds as DfsTimeSeries::times.
+ * result holds num_queries values for each item, item by item.
+ * Query times outside the time series, or next to a delete value, give the delete value.
+ */
+void DfsTimeSeriesInterpolate(const DfsTimeSeries& ts, const double* query_times, long num_queries,
+                              DfsInterpolationType interp_type, double* result);
+
+/**
+ * Interpolate one series at the query times, sorted or not.
+ * times must be increasing.
+ */
+void DfsInterpolate(const double* times, const double* values, long num_timesteps, double delete_value,
+                    const double* query_times, long num_queries, DfsInterpolationType interp_type, double* result);
+
+/**
+ * Write all time steps of ts to a new dfs0 file, after static items are written.
+ * The file must have the items of ts, and a time axis matching the times of ts.
+ */
+long WriteDfsTimeSeriesData(LPHEAD pdfsWr, LPFILE fpWr, const DfsTimeSeries& ts);
+
+/** Resample all items to count equidistant times, start, start + step, ... */
+void DfsTimeSeriesResample(const DfsTimeSeries& ts, double start, double step, long count,
+                           DfsInterpolationType interp_type, DfsTimeSeries* resampled);
+
+/**
+ * Resample a dfs0 file to an equidistant time axis with time step tstep_sec, in seconds,
+ * from the first time of the input to its last time. Calendar axes stay calendar axes.
+ * Returns the number of time steps written, or -1 if the input is not a dfs0 file.
+ */
+long DfsTimeSeriesResampleFile(LPCTSTR dfs0Filename, LPCTSTR outputFilename, double tstep_sec, DfsInterpolationType interp_type);
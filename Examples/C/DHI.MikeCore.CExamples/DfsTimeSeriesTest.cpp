@@ -0,0 +1,122 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsTimeSeries.h"
+#include <CppUnitTest.h>
+
+#include <math.h>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsTimeSeries_tests)
+  {
+  public:
+
+    /// Interpolate TemporalNeqCal.dfs0 at its own times and at midpoints, sorted and unsorted
+    TEST_METHOD(InterpolateNeqCalTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "TemporalNeqCal.dfs0");
+
+      DfsTimeSeries ts;
+      Assert::IsTrue(ReadDfsTimeSeries(inputFullPath, &ts));
+      Assert::IsTrue(ts.calendar);
+      Assert::IsTrue(ts.num_timesteps > 2);
+      for (long i = 1; i < ts.num_timesteps; i++)
+        Assert::IsTrue(ts.times[i - 1] < ts.times[i]);
+
+      // Own times give the values of the file
+      std::vector<double> result(ts.num_items * ts.num_timesteps);
+      DfsTimeSeriesInterpolate(ts, ts.times.data(), ts.num_timesteps, DfsInterpLinear, result.data());
+      Assert::IsTrue(result == ts.values);
+
+      // Midpoints, reversed such that the queries are not sorted
+      long n = ts.num_timesteps - 1;
+      std::vector<double> mid(n);
+      for (long i = 0; i < n; i++)
+        mid[i] = 0.5 * (ts.times[n - 1 - i] + ts.times[n - i]);
+      std::vector<double> linear(ts.num_items * n), forward(ts.num_items * n), backward(ts.num_items * n);
+      DfsTimeSeriesInterpolate(ts, mid.data(), n, DfsInterpLinear, linear.data());
+      DfsTimeSeriesInterpolate(ts, mid.data(), n, DfsInterpStepForward, forward.data());
+      DfsTimeSeriesInterpolate(ts, mid.data(), n, DfsInterpStepBackward, backward.data());
+      for (int i_item = 1; i_item <= ts.num_items; i_item++)
+      {
+        const double* v = ts.Item(i_item);
+        for (long i = 0; i < n; i++)
+        {
+          long k = n - 1 - i;
+          size_t r = (i_item - 1) * n + i;
+          if (v[k] == ts.delete_value || v[k + 1] == ts.delete_value)
+            Assert::AreEqual(ts.delete_value, linear[r]);
+          else
+            Assert::AreEqual(v[k] + 0.5 * (v[k + 1] - v[k]), linear[r], 1e-9);
+          Assert::AreEqual(v[k], forward[r]);
+          Assert::AreEqual(v[k + 1], backward[r]);
+        }
+      }
+    }
+
+    /// Interpolation of a small series, with delete values and times outside the series
+    TEST_METHOD(InterpolateTest)
+    {
+      const double d = 1e-255;
+      double times[4] = { 0, 10, 20, 40 };
+      double values[4] = { 1, 2, d, 6 };
+      double query[6] = { -1, 5, 10, 15, 30, 50 };
+      double result[6];
+      DfsInterpolate(times, values, 4, d, query, 6, DfsInterpLinear, result);
+      Assert::AreEqual(d, result[0]);
+      Assert::AreEqual(1.5, result[1]);
+      Assert::AreEqual(2.0, result[2]);
+      Assert::AreEqual(d, result[3]);
+      Assert::AreEqual(d, result[4]);
+      Assert::AreEqual(d, result[5]);
+      DfsInterpolate(times, values, 4, d, query, 6, DfsInterpStepForward, result);
+      Assert::AreEqual(1.0, result[1]);
+      Assert::AreEqual(2.0, result[3]);
+      Assert::AreEqual(d, result[4]);
+      DfsInterpolate(times, values, 4, d, query, 6, DfsInterpStepBackward, result);
+      Assert::AreEqual(2.0, result[1]);
+      Assert::AreEqual(d, result[3]);
+      Assert::AreEqual(6.0, result[4]);
+      Assert::AreEqual(d, result[5]);
+    }
+
+    /// Resample TemporalNeqTime.dfs0 to 10 equidistant intervals, and compare with the in-memory resampling
+    TEST_METHOD(ResampleFileTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "TemporalNeqTime.dfs0");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_TemporalNeqTime_Cresampled.dfs0");
+
+      DfsTimeSeries ts;
+      Assert::IsTrue(ReadDfsTimeSeries(inputFullPath, &ts));
+      Assert::IsFalse(ts.calendar);
+      double step = (ts.times[ts.num_timesteps - 1] - ts.times[0]) / 10;
+      long count = DfsTimeSeriesResampleFile(inputFullPath, outputFullPath, step, DfsInterpLinear);
+      Assert::AreEqual(11L, count);
+
+      DfsTimeSeries resampled, written;
+      DfsTimeSeriesResample(ts, ts.times[0], step, count, DfsInterpLinear, &resampled);
+      Assert::IsTrue(ReadDfsTimeSeries(outputFullPath, &written));
+      Assert::AreEqual(count, written.num_timesteps);
+      Assert::AreEqual(ts.num_items, written.num_items);
+      for (long i = 0; i < count; i++)
+        Assert::AreEqual(resampled.times[i], written.times[i], 1e-6);
+      for (size_t i = 0; i < written.values.size(); i++)
+      {
+        if (resampled.values[i] == resampled.delete_value)
+          Assert::AreEqual(written.delete_value, written.values[i]);
+        else
+          Assert::AreEqual(resampled.values[i], written.values[i], 1e-5 * (1 + fabs(resampled.values[i])));
+      }
+    }
+
+  };
+}
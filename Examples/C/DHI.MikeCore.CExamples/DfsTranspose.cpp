@@ -0,0 +1,264 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsTranspose.h"
+
+#include <CppUnitTestLogger.h>
+#include <algorithm>
+#include <string.h>
+#include <string>
+
+
+/** Cell-major file header, at the start of the file */
+struct DfsTransposeHeader
+{
+  char     magic[8];          ///< "DFSCELL1"
+  uint32_t num_items;
+  uint32_t num_timesteps;
+  uint64_t index_offset;      ///< Items, followed by times
+  uint64_t reserved[4];
+};
+
+static const char DfsTransposeMagic[8] = { 'D', 'F', 'S', 'C', 'E', 'L', 'L', '1' };
+
+/**
+ * Transpose nt x ne values, row t starting at in + t * in_stride, to ne x nt values in out.
+ * Done in tiles, such that both input and output tile stay in cache.
+ */
+template <typename T>
+static void TransposeBlock(const uint8_t* in, size_t in_stride, size_t nt, size_t ne, uint8_t* out)
+{
+  const size_t tile = 64;
+  for (size_t e0 = 0; e0 < ne; e0 += tile)
+  {
+    size_t e1 = std::min(e0 + tile, ne);
+    for (size_t t0 = 0; t0 < nt; t0 += tile)
+    {
+      size_t t1 = std::min(t0 + tile, nt);
+      for (size_t t = t0; t < t1; t++)
+      {
+        const uint8_t* row = in + t * in_stride;
+        for (size_t e = e0; e < e1; e++)
+        {
+          T v;
+          memcpy(&v, row + e * sizeof(T), sizeof(T));
+          memcpy(out + (e * nt + t) * sizeof(T), &v, sizeof(T));
+        }
+      }
+    }
+  }
+}
+
+static void TransposeBlock(const uint8_t* in, size_t in_stride, size_t nt, size_t ne, size_t width, uint8_t* out)
+{
+  switch (width)
+  {
+  case 1: TransposeBlock<uint8_t>(in, in_stride, nt, ne, out); break;
+  case 2: TransposeBlock<uint16_t>(in, in_stride, nt, ne, out); break;
+  case 4: TransposeBlock<uint32_t>(in, in_stride, nt, ne, out); break;
+  case 8: TransposeBlock<uint64_t>(in, in_stride, nt, ne, out); break;
+  default:
+    for (size_t t = 0; t < nt; t++)
+      for (size_t e = 0; e < ne; e++)
+        memcpy(out + (e * nt + t) * width, in + t * in_stride + e * width, width);
+  }
+}
+
+long DfsTransposeWrite(LPCTSTR dfsFilename, LPCTSTR cellFilename, size_t memory_bytes)
+{
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(dfsFilename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfs);
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  GetDfsTimeAxisSeconds(pdfs, &start_sec, &tstep_sec, &num_timesteps);
+
+  // Item layout within one time step
+  std::vector<DfsTransposeItem> items(num_items);
+  std::vector<size_t> item_bytes(num_items);
+  std::vector<size_t> tstep_offsets(num_items);
+  size_t tstep_bytes = 0;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LPITEM item = dfsItemD(pdfs, i_item);
+    DfsTransposeItem& titem = items[i_item - 1];
+    titem.num_elmts = dfsGetItemElements(item);
+    titem.width = titem.num_elmts > 0 ? dfsGetItemBytes(item) / titem.num_elmts : 1;
+    item_bytes[i_item - 1] = dfsGetItemBytes(item);
+    tstep_offsets[i_item - 1] = tstep_bytes;
+    tstep_bytes += item_bytes[i_item - 1];
+  }
+
+  // Number of time steps in each run: A block as read and the transposed block must fit in memory
+  size_t block_tsteps = std::max((size_t)1, memory_bytes / (2 * std::max(tstep_bytes, (size_t)1)));
+  block_tsteps = std::min(block_tsteps, (size_t)std::max(num_timesteps, 1L));
+  bool single_run = block_tsteps >= (size_t)num_timesteps;
+  std::vector<uint8_t> block(block_tsteps * tstep_bytes);
+  std::vector<uint8_t> run(block_tsteps * tstep_bytes);
+
+  DfsTransposeHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DfsTransposeMagic, 8);
+  header.num_items = num_items;
+  header.num_timesteps = num_timesteps;
+
+  std::string runFilename = std::string(cellFilename) + ".runs.tmp";
+  FILE* fc = fopen(cellFilename, "wb");
+  FILE* fr = (fc && !single_run) ? fopen(runFilename.c_str(), "w+b") : nullptr;
+  bool ok = fc && (single_run || fr) && fwrite(&header, sizeof(header), 1, fc) == 1;
+  if (!ok)
+    LOG("Error creating file: %s", fc ? runFilename.c_str() : cellFilename);
+
+  // Pass 1: Read blocks of time steps, transpose each block and write it as a run
+  std::vector<double> times;
+  std::vector<uint64_t> run_offsets;
+  std::vector<size_t> run_tsteps;
+  uint64_t run_pos = 0;
+  if (ok)
+  {
+    rc = dfsFindTimeStep(pdfs, fp, 0);
+    CheckRc(rc, "Error finding time step");
+  }
+  for (long t_start = 0; t_start < num_timesteps && ok; t_start += (long)block_tsteps)
+  {
+    size_t nt = std::min(block_tsteps, (size_t)(num_timesteps - t_start));
+    for (size_t t = 0; t < nt; t++)
+    {
+      for (int i_item = 1; i_item <= num_items; i_item++)
+      {
+        double time;
+        rc = dfsReadItemTimeStep(pdfs, fp, &time, &block[t * tstep_bytes + tstep_offsets[i_item - 1]]);
+        CheckRc(rc, "Error reading dynamic item data");
+        if (i_item == 1)
+          times.push_back(time);
+      }
+    }
+    // Run layout: For each item, the nt values of each element
+    size_t run_bytes = 0;
+    for (int i = 0; i < num_items; i++)
+    {
+      TransposeBlock(&block[tstep_offsets[i]], tstep_bytes, nt, items[i].num_elmts, items[i].width, &run[run_bytes]);
+      run_bytes += nt * item_bytes[i];
+    }
+    if (single_run)
+    {
+      ok = fwrite(run.data(), 1, run_bytes, fc) == run_bytes;
+    }
+    else
+    {
+      run_offsets.push_back(run_pos);
+      run_tsteps.push_back(nt);
+      ok = fwrite(run.data(), 1, run_bytes, fr) == run_bytes;
+      run_pos += run_bytes;
+    }
+  }
+
+  // Pass 2: Merge runs into the cell-major file, one range of elements of one item at a time
+  uint64_t pos = sizeof(header);
+  uint64_t item_run_offset = 0;
+  for (int i = 0; i < num_items && ok; i++)
+  {
+    DfsTransposeItem& titem = items[i];
+    titem.offset = pos;
+    pos += (uint64_t)num_timesteps * item_bytes[i];
+    if (single_run)
+      continue;
+
+    size_t w = titem.width;
+    size_t series_bytes = num_timesteps * w;
+    size_t chunk_elmts = std::max((size_t)1, memory_bytes / (2 * std::max(series_bytes, (size_t)1)));
+    std::vector<uint8_t> out(std::min(chunk_elmts, (size_t)titem.num_elmts) * series_bytes);
+    for (size_t e0 = 0; e0 < titem.num_elmts && ok; e0 += chunk_elmts)
+    {
+      size_t ne = std::min(chunk_elmts, titem.num_elmts - e0);
+      size_t t_start = 0;
+      for (size_t r = 0; r < run_offsets.size() && ok; r++)
+      {
+        // Elements of one item are contiguous within a run
+        size_t nt = run_tsteps[r];
+        size_t bytes = ne * nt * w;
+        uint64_t offset = run_offsets[r] + item_run_offset * nt + e0 * nt * w;
+        ok = _fseeki64(fr, offset, SEEK_SET) == 0 && fread(block.data(), 1, bytes, fr) == bytes;
+        for (size_t e = 0; e < ne && ok; e++)
+          memcpy(&out[e * series_bytes + t_start * w], &block[e * nt * w], nt * w);
+        t_start += nt;
+      }
+      if (ok)
+        ok = _fseeki64(fc, titem.offset + e0 * series_bytes, SEEK_SET) == 0 &&
+             fwrite(out.data(), 1, ne * series_bytes, fc) == ne * series_bytes;
+    }
+    item_run_offset += item_bytes[i];
+  }
+
+  // Index at the end, and update header with its location
+  header.index_offset = pos;
+  if (ok)
+    ok = _fseeki64(fc, pos, SEEK_SET) == 0 &&
+         fwrite(items.data(), sizeof(DfsTransposeItem), items.size(), fc) == items.size() &&
+         fwrite(times.data(), sizeof(double), times.size(), fc) == times.size() &&
+         _fseeki64(fc, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, fc) == 1;
+  if (fc && fclose(fc) != 0)
+    ok = false;
+  if (fr)
+  {
+    fclose(fr);
+    remove(runFilename.c_str());
+  }
+  if (fc && !ok)
+    LOG("Error writing cell-major file: %s", cellFilename);
+
+  rc = dfsFileClose(pdfs, &fp);
+  rc = dfsHeaderDestroy(&pdfs);
+  return ok ? F_NO_ERROR : -1;
+}
+
+bool DfsTransposeOpen(DfsTransposeReader* reader, LPCTSTR cellFilename)
+{
+  DfsTransposeHeader header;
+  reader->fp = fopen(cellFilename, "rb");
+  bool ok = reader->fp && fread(&header, sizeof(header), 1, reader->fp) == 1 &&
+            memcmp(header.magic, DfsTransposeMagic, 8) == 0;
+  if (ok)
+  {
+    reader->num_items = header.num_items;
+    reader->num_timesteps = header.num_timesteps;
+    reader->items.resize(header.num_items);
+    reader->times.resize(header.num_timesteps);
+    ok = _fseeki64(reader->fp, header.index_offset, SEEK_SET) == 0 &&
+         fread(reader->items.data(), sizeof(DfsTransposeItem), reader->items.size(), reader->fp) == reader->items.size() &&
+         fread(reader->times.data(), sizeof(double), reader->times.size(), reader->fp) == reader->times.size();
+  }
+  if (!ok)
+  {
+    LOG("Not a valid cell-major file: %s", cellFilename);
+    DfsTransposeClose(reader);
+  }
+  return ok;
+}
+
+long DfsTransposeReadCell(DfsTransposeReader* reader, int item, long elmt, void* data)
+{
+  if (item < 1 || item > (int)reader->num_items)
+    return F_FAIL_ILLEGEAL_ITEM;
+  const DfsTransposeItem& titem = reader->items[item - 1];
+  if (elmt < 0 || elmt >= (long)titem.num_elmts)
+    return F_ERR_DATA;
+  size_t bytes = (size_t)reader->num_timesteps * titem.width;
+  if (_fseeki64(reader->fp, titem.offset + elmt * bytes, SEEK_SET) != 0 ||
+      fread(data, 1, bytes, reader->fp) != bytes)
+    return F_ERR_READ;
+  return F_NO_ERROR;
+}
+
+void DfsTransposeClose(DfsTransposeReader* reader)
+{
+  if (reader->fp)
+    fclose(reader->fp);
+  reader->fp = nullptr;
+  reader->items.clear();
+  reader->times.clear();
+}
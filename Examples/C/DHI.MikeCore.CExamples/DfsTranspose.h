@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+ * Cell-major companion file of a dfs file.
+ *
+ * A dfs file stores data time step by time step, so reading the full time series
+ * of one cell requires reading the entire file. The cell-major file stores, for each
+ * dynamic item, the time series of each element contiguously, such that the full
+ * time series of any element is one sequential read.
+ *
+ * The transposition is done out-of-core, in bounded memory: The dfs file is read once,
+ * in blocks of time steps, each block is transposed in memory and written as a run to
+ * a temporary run file. The runs are then merged, element range by element range,
+ * into the cell-major file. If all time steps fit in memory, no run file is used.
+ *
+ * The file consists of a header, the data of all items, and an index with the number
+ * of elements, value size and data offset of each item and the time of each time step.
+ */
+
+/** One dynamic item in a cell-major file */
+struct DfsTransposeItem
+{
+  uint64_t offset;      ///< Offset of item data in file
+  uint32_t num_elmts;   ///< Number of elements
+  uint32_t width;       ///< Size of one value, in bytes
+};
+
+/** Cell-major file opened for reading */
+struct DfsTransposeReader
+{
+  FILE*    fp = nullptr;
+  uint32_t num_items = 0;
+  uint32_t num_timesteps = 0;
+  std::vector<DfsTransposeItem> items;
+  std::vector<double>           times;   ///< Time of each time step, as returned by dfsReadItemTimeStep
+};
+
+/**
+ * Transpose the dynamic items of a dfs file to a cell-major file, using at most
+ * about memory_bytes of buffer memory. Run files are written next to the cell-major file.
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long DfsTransposeWrite(LPCTSTR dfsFilename, LPCTSTR cellFilename, size_t memory_bytes = 256 << 20);
+
+/** Open cell-major file for reading. Returns false on failure */
+bool DfsTransposeOpen(DfsTransposeReader* reader, LPCTSTR cellFilename);
+
+/**
+ * Read full time series of element elmt (zero based) of item (one based),
+ * num_timesteps values of the item data type.
+ * Returns F_NO_ERROR on success.
+ */
+long DfsTransposeReadCell(DfsTransposeReader* reader, int item, long elmt, void* data);
+
+void DfsTransposeClose(DfsTransposeReader* reader);
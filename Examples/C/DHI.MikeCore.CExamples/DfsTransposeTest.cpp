@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsTranspose.h"
+#include <CppUnitTest.h>
+
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsTranspose_tests)
+  {
+  public:
+
+    /// Transpose OresundHD.dfs2 in little memory, using one run per time step
+    TEST_METHOD(TransposeDfs2RunsTest)
+    {
+      TransposeDfs2(200000, "test_OresundHD_Cruns.dfsc");
+    }
+
+    /// Transpose OresundHD.dfs2 entirely in memory
+    TEST_METHOD(TransposeDfs2InMemoryTest)
+    {
+      TransposeDfs2(64 << 20, "test_OresundHD_C.dfsc");
+    }
+
+    /// Transpose, and check time series of cell (3,4), see ReadDfs2Test, against the dfs file
+    static void TransposeDfs2(size_t memory_bytes, const char* cellFilename)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char cellFullPath[_MAX_PATH];
+      snprintf(cellFullPath, _MAX_PATH, "%s%s", TestDataPath(), cellFilename);
+
+      long rc = DfsTransposeWrite(inputFullPath, cellFullPath, memory_bytes);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+
+      DfsTransposeReader reader;
+      Assert::IsTrue(DfsTransposeOpen(&reader, cellFullPath));
+      Assert::AreEqual((uint32_t)3, reader.num_items);
+      Assert::AreEqual((uint32_t)13, reader.num_timesteps);
+      Assert::AreEqual((uint32_t)(71 * 91), reader.items[0].num_elmts);
+      int index34 = 71 * 4 + 3;
+      std::vector<float> series(13);
+      rc = DfsTransposeReadCell(&reader, 1, index34, series.data());
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::AreEqual(11.3634329f, series[2]);
+      std::vector<float> series3(13);
+      rc = DfsTransposeReadCell(&reader, 3, index34, series3.data());
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      std::vector<float> data(71 * 91);
+      double time;
+      for (long i_tstep = 0; i_tstep < 13; i_tstep++)
+      {
+        rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+        CheckRc(rc, "Error reading item-timestep");
+        Assert::AreEqual(data[index34], series[i_tstep]);
+        Assert::AreEqual(time, reader.times[i_tstep]);
+        rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+        rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+        CheckRc(rc, "Error reading item-timestep");
+        Assert::AreEqual(data[index34], series3[i_tstep]);
+      }
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      DfsTransposeClose(&reader);
+    }
+
+  };
+}
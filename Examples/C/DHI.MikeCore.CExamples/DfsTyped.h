@@ -0,0 +1,207 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+
+#include <CppUnitTestLogger.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Typed access to item data.
+ *
+ * Item data is stored as one of the SimpleType's. Instead of passing void* buffers
+ * around, and checking the SimpleType of an item for every item-timestep, the SimpleType
+ * is dispatched once per item with DfsVisitSimpleType, to code templated on the element
+ * type. Kernels working on item data are thereby instantiated for each element type,
+ * with fully typed inner loops, and double data is processed as double, not converted
+ * to float and back.
+ */
+
+/** Tag type carrying an element type, passed to the visitor of DfsVisitSimpleType */
+template <typename T>
+struct DfsTypeTag
+{
+  using type = T;
+};
+
+/** SimpleType of element type T */
+template <typename T> struct DfsSimpleTypeOf;
+template <> struct DfsSimpleTypeOf<float>          { static constexpr SimpleType value = UFS_FLOAT;    };
+template <> struct DfsSimpleTypeOf<double>         { static constexpr SimpleType value = UFS_DOUBLE;   };
+template <> struct DfsSimpleTypeOf<char>           { static constexpr SimpleType value = UFS_CHAR;     };
+template <> struct DfsSimpleTypeOf<int>            { static constexpr SimpleType value = UFS_INT;      };
+template <> struct DfsSimpleTypeOf<unsigned int>   { static constexpr SimpleType value = UFS_UNSIGNED; };
+template <> struct DfsSimpleTypeOf<short>          { static constexpr SimpleType value = UFS_SHORT;    };
+template <> struct DfsSimpleTypeOf<unsigned short> { static constexpr SimpleType value = UFS_USHORT;   };
+
+/**
+ * Call visitor with a DfsTypeTag of the element type of simple_type, as
+ *   DfsVisitSimpleType(item_datatype, [&](auto tag) { using T = typename decltype(tag)::type; ... });
+ * Returns false if simple_type is not supported.
+ */
+template <typename F>
+bool DfsVisitSimpleType(SimpleType simple_type, F&& visitor)
+{
+  switch (simple_type)
+  {
+  case UFS_FLOAT:    visitor(DfsTypeTag<float>());          return true;
+  case UFS_DOUBLE:   visitor(DfsTypeTag<double>());         return true;
+  case UFS_CHAR:     visitor(DfsTypeTag<char>());           return true;
+  case UFS_INT:      visitor(DfsTypeTag<int>());            return true;
+  case UFS_UNSIGNED: visitor(DfsTypeTag<unsigned int>());   return true;
+  case UFS_SHORT:    visitor(DfsTypeTag<short>());          return true;
+  case UFS_USHORT:   visitor(DfsTypeTag<unsigned short>()); return true;
+  default:
+    LOG("Simple type not supported: %d", (int)simple_type);
+    return false;
+  }
+}
+
+/** Delete value of element type T, empty for types without a delete value in the header */
+template <typename T>
+std::optional<T> DfsDeleteValue(LPHEAD pdfs)
+{
+  if constexpr (std::is_same_v<T, float>)
+    return dfsGetDeleteValFloat(pdfs);
+  else if constexpr (std::is_same_v<T, double>)
+    return dfsGetDeleteValDouble(pdfs);
+  else if constexpr (std::is_same_v<T, char>)
+    return dfsGetDeleteValByte(pdfs);
+  else if constexpr (std::is_same_v<T, int>)
+    return dfsGetDeleteValInt(pdfs);
+  else if constexpr (std::is_same_v<T, unsigned int>)
+    return dfsGetDeleteValUnsignedInt(pdfs);
+  else
+    return std::nullopt;
+}
+
+/**
+ * Convert n values from S to T, delete values of S becoming delete values of T.
+ * If either type has no delete value, all values are converted as they are.
+ */
+template <typename S, typename T>
+void DfsConvertValues(const S* in, size_t n, std::optional<std::type_identity_t<S>> delete_in,
+                      T* out, std::optional<std::type_identity_t<T>> delete_out)
+{
+  if (!delete_in || !delete_out)
+  {
+    for (size_t i = 0; i < n; i++)
+      out[i] = (T)in[i];
+    return;
+  }
+  S del_in = *delete_in;
+  T del_out = *delete_out;
+  for (size_t i = 0; i < n; i++)
+    out[i] = in[i] == del_in ? del_out : (T)in[i];
+}
+
+/**
+ * Read the next static item into data, converting from the data type of the item to T.
+ * The name of the static item must match name.
+ * Returns false if there are no more static items, or if the name does not match.
+ * Errors from the DFS library exit, as CheckRc does.
+ */
+template <typename T>
+bool ReadDfsStaticItem(LPFILE fp, LPHEAD pdfs, LPCSTR name, std::vector<T>* data)
+{
+  LONG error;
+  LPVECTOR pvec = dfsStaticRead(fp, &error);
+  if (pvec == NULL)
+    return false;
+
+  LONG item_type, item_unit;
+  LPCTSTR item_type_str, item_name, item_unit_str;
+  SimpleType item_datatype;
+  LPITEM static_item = dfsItemS(pvec);
+  long rc = dfsGetItemInfo(static_item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+  CheckRc(rc, "Error reading static item info");
+  bool ok = strcmp(name, item_name) == 0;
+  if (!ok)
+    LOG("Static item name not matching: %s vs %s", name, item_name);
+
+  size_t n = dfsGetItemElements(static_item);
+  data->resize(n);
+  if (ok)
+  {
+    ok = DfsVisitSimpleType(item_datatype, [&](auto tag)
+    {
+      using S = typename decltype(tag)::type;
+      if constexpr (std::is_same_v<S, T>)
+        rc = dfsStaticGetData(pvec, data->data());
+      else
+      {
+        std::vector<S> raw(n);
+        rc = dfsStaticGetData(pvec, raw.data());
+        DfsConvertValues(raw.data(), n, DfsDeleteValue<S>(pdfs), data->data(), DfsDeleteValue<T>(pdfs));
+      }
+      CheckRc(rc, "Error reading static data");
+    });
+  }
+  rc = dfsStaticDestroy(&pvec);
+  CheckRc(rc, "Error destroying static item");
+  return ok;
+}
+
+/**
+ * Copy num_timesteps time steps of all items, applying kernel to each item-timestep
+ * before it is written. kernel is called as kernel(i_item, std::span<T> values), T being
+ * the element type of the item, such that a generic lambda is instantiated for each type:
+ *
+ *   CopyDfsTemporalDataTyped(pdfsIn, fpIn, pdfsWr, fpWr, num_timesteps, num_items, [&](int i_item, auto values)
+ *   {
+ *     using T = typename decltype(values)::element_type;
+ *     ...
+ *   });
+ *
+ * The data type of each item is dispatched once, and buffers of the item type are allocated here.
+ * Exits, as CheckRc does, if an item has a data type that is not supported, before any data is copied.
+ */
+template <typename F>
+void CopyDfsTemporalDataTyped(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, long num_timesteps, long num_items, F&& kernel)
+{
+  // Read-process-write of one item-timestep, typed for each item
+  std::vector<std::function<void()>> item_steps(num_items);
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LPITEM item = dfsItemD(pdfsIn, i_item);
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    SimpleType item_datatype;
+    long rc = dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+    CheckRc(rc, "Error getting dynamic item info");
+    size_t n = dfsGetItemElements(item);
+    bool supported = DfsVisitSimpleType(item_datatype, [&](auto tag)
+    {
+      using T = typename decltype(tag)::type;
+      auto buffer = std::make_shared<std::vector<T>>(n);
+      item_steps[i_item - 1] = [=, &kernel]()
+      {
+        double time;
+        long rc = dfsReadItemTimeStep(pdfsIn, fpIn, &time, buffer->data());
+        CheckRc(rc, "Error reading dynamic item data");
+        kernel(i_item, std::span<T>(*buffer));
+        rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time, buffer->data());
+        CheckRc(rc, "Error writing dynamic item data");
+      };
+    });
+    if (!supported)
+    {
+      LOG("Dynamic item %d data type not supported: %d\n", i_item, item_datatype);
+      exit(-1);
+    }
+  }
+
+  for (long i_tstep = 0; i_tstep < num_timesteps; i_tstep++)
+  {
+    for (int i_item = 1; i_item <= num_items; i_item++)
+      item_steps[i_item - 1]();
+  }
+}
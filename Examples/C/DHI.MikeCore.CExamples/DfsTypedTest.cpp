@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsTyped.h"
+#include <CppUnitTest.h>
+
+#include <type_traits>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsTyped_tests)
+  {
+  public:
+
+    /// Dispatch of simple types to element types, and back
+    TEST_METHOD(VisitSimpleTypeTest)
+    {
+      SimpleType types[7] = { UFS_FLOAT, UFS_DOUBLE, UFS_CHAR, UFS_INT, UFS_UNSIGNED, UFS_SHORT, UFS_USHORT };
+      for (SimpleType type : types)
+      {
+        SimpleType visited = (SimpleType)0;
+        Assert::IsTrue(DfsVisitSimpleType(type, [&](auto tag)
+        {
+          using T = typename decltype(tag)::type;
+          visited = DfsSimpleTypeOf<T>::value;
+        }));
+        Assert::AreEqual((int)type, (int)visited);
+      }
+
+      const float d = 1e-35f;
+      float in[3] = { 1.5f, d, -2 };
+      double out[3];
+      DfsConvertValues(in, 3, d, out, -1e255);
+      Assert::AreEqual(1.5, out[0]);
+      Assert::AreEqual(-1e255, out[1]);
+      Assert::AreEqual(-2.0, out[2]);
+
+      // Short has no delete value, zeros are values
+      short in_short[3] = { 0, 7, -3 };
+      float out_float[3];
+      DfsConvertValues(in_short, 3, std::optional<short>(), out_float, std::optional<float>(d));
+      Assert::AreEqual(0.0f, out_float[0]);
+      Assert::AreEqual(-3.0f, out_float[2]);
+    }
+
+    /// Static items of OresundHD.dfsu, read as their own type and converted
+    TEST_METHOD(ReadStaticItemTest)
+    {
+      char filename[_MAX_PATH];
+      snprintf(filename, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(filename, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+
+      std::vector<int> node_ids;
+      Assert::IsTrue(ReadDfsStaticItem(fp, pdfs, "Node id", &node_ids));
+      Assert::IsTrue(node_ids.size() > 0);
+      // X-coord is stored as double, read as float
+      std::vector<float> node_x;
+      Assert::IsTrue(ReadDfsStaticItem(fp, pdfs, "X-coord", &node_x));
+      Assert::AreEqual(node_ids.size(), node_x.size());
+      // Name not matching
+      std::vector<double> node_y;
+      Assert::IsFalse(ReadDfsStaticItem(fp, pdfs, "Z-coord", &node_y));
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+    /// Copy OresundHD.dfs2, the kernel seeing the float data of each item-timestep
+    TEST_METHOD(CopyTemporalDataTypedTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Ctyped.dfs2");
+
+      LPHEAD pdfsIn, pdfsWr;
+      LPFILE fpIn, fpWr;
+      long rc = dfsFileRead(inputFullPath, &pdfsIn, &fpIn);
+      CheckRc(rc, "Error opening file");
+      long num_items = dfsGetNoOfItems(pdfsIn);
+      long num_timesteps = CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+      CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+      rc = dfsFileCreate(outputFullPath, pdfsWr, &fpWr);
+      CheckRc(rc, "Error creating file");
+      CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
+
+      int num_calls = 0;
+      bool all_float = true;
+      float value = 0;
+      CopyDfsTemporalDataTyped(pdfsIn, fpIn, pdfsWr, fpWr, num_timesteps, num_items, [&](int, auto values)
+      {
+        using T = typename decltype(values)::element_type;
+        all_float = all_float && std::is_same_v<T, float>;
+        if (num_calls == 2 * num_items)
+          value = (float)values[71 * 4 + 3];
+        num_calls++;
+      });
+      Assert::AreEqual(13 * 3, num_calls);
+      Assert::IsTrue(all_float);
+      Assert::AreEqual(11.3634329f, value, 1e-5f);
+
+      rc = dfsFileClose(pdfsWr, &fpWr);
+      rc = dfsHeaderDestroy(&pdfsWr);
+      rc = dfsFileClose(pdfsIn, &fpIn);
+      rc = dfsHeaderDestroy(&pdfsIn);
+    }
+
+  };
+}
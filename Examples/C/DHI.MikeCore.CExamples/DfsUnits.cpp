@@ -0,0 +1,138 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsUnits.h"
+#include "DfsTyped.h"
+
+#include <CppUnitTestLogger.h>
+#include <map>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/** Cached unit scales, by (from, to) unit pair, first being false for units that are not equivalent */
+static std::map<std::pair<long, long>, std::pair<bool, DfsUnitScale>> unitScaleCache;
+static std::mutex unitScaleCacheMutex;
+
+bool GetDfsUnitScale(long from_unit, long to_unit, DfsUnitScale* unit_scale)
+{
+  std::lock_guard<std::mutex> lock(unitScaleCacheMutex);
+  auto key = std::make_pair(from_unit, to_unit);
+  auto it = unitScaleCache.find(key);
+  if (it == unitScaleCache.end())
+  {
+    std::pair<bool, DfsUnitScale> entry(false, DfsUnitScale());
+    if (from_unit == to_unit)
+      entry.first = true;
+    else if (eumUnitsEqv(from_unit, to_unit))
+    {
+      // Conversion is affine: Converting 0 gives the offset, converting 1 the scale plus the offset
+      double zero = 0, one = 0;
+      entry.first = eumConvertUnit(from_unit, 0.0, to_unit, &zero) && eumConvertUnit(from_unit, 1.0, to_unit, &one);
+      entry.second.offset = zero;
+      entry.second.scale = one - zero;
+    }
+    it = unitScaleCache.insert(std::make_pair(key, entry)).first;
+  }
+  *unit_scale = it->second.second;
+  return it->second.first;
+}
+
+bool GetDfsItemUnitScale(LPITEM item, long to_unit, DfsUnitScale* unit_scale)
+{
+  LONG item_type, item_unit;
+  LPCTSTR item_type_str, item_name, item_unit_str;
+  SimpleType item_datatype;
+  long rc = dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+  CheckRc(rc, "Error getting dynamic item info");
+  return GetDfsUnitScale(item_unit, to_unit, unit_scale);
+}
+
+/** Multiply-add of values that are not the delete value, using an integer mask instead of a conditional */
+template <typename T>
+static void ConvertUnit(T* __restrict data, size_t n, T scale, T offset, T del)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    int m = data[i] != del;
+    T v = data[i] * scale + offset;
+    data[i] = v * (T)m + del * (T)(1 - m);
+  }
+}
+
+void DfsConvertUnit(float* data, size_t n, const DfsUnitScale& unit_scale, float delete_value)
+{
+  ConvertUnit(data, n, (float)unit_scale.scale, (float)unit_scale.offset, delete_value);
+}
+
+void DfsConvertUnit(double* data, size_t n, const DfsUnitScale& unit_scale, double delete_value)
+{
+  ConvertUnit(data, n, unit_scale.scale, unit_scale.offset, delete_value);
+}
+
+long CopyDfsFileConvertUnits(LPCTSTR inputFilename, LPCTSTR outputFilename, const long* to_units)
+{
+  LPHEAD pdfsIn, pdfsWr;
+  LPFILE fpIn, fpWr;
+  long rc = dfsFileRead(inputFilename, &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfsIn);
+  long num_timesteps = CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+
+  // Scale and offset of each item, and the new unit in the target
+  std::vector<bool> convert(num_items, false);
+  std::vector<DfsUnitScale> unit_scales(num_items);
+  std::vector<SimpleType> datatypes(num_items);
+  long num_converted = 0;
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    LPITEM itemIn = dfsItemD(pdfsIn, i_item);
+    rc = dfsGetItemInfo(itemIn, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &datatypes[i_item - 1]);
+    CheckRc(rc, "Error getting dynamic item info");
+    long to_unit = to_units[i_item - 1];
+    if (to_unit == 0 || to_unit == item_unit)
+      continue;
+    if (datatypes[i_item - 1] != UFS_FLOAT && datatypes[i_item - 1] != UFS_DOUBLE)
+    {
+      LOG("Item %d is not a float or double item, not converted", i_item);
+      continue;
+    }
+    if (!GetDfsUnitScale(item_unit, to_unit, &unit_scales[i_item - 1]))
+    {
+      LOG("Item %d unit %ld can not be converted to unit %ld", i_item, (long)item_unit, to_unit);
+      continue;
+    }
+    rc = dfsSetItemInfo(pdfsWr, dfsItemD(pdfsWr, i_item), item_type, item_name, to_unit, datatypes[i_item - 1]);
+    CheckRc(rc, "Error setting dynamic item info");
+    convert[i_item - 1] = true;
+    num_converted++;
+  }
+
+  rc = dfsFileCreate(outputFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating file");
+  CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
+
+  // Item data type is dispatched once per item, the kernel being instantiated for float and double
+  CopyDfsTemporalDataTyped(pdfsIn, fpIn, pdfsWr, fpWr, num_timesteps, num_items, [&](int i_item, auto values)
+  {
+    using T = typename decltype(values)::element_type;
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      if (convert[i_item - 1])
+        DfsConvertUnit(values.data(), values.size(), unit_scales[i_item - 1], *DfsDeleteValue<T>(pdfsIn));
+    }
+  });
+
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  rc = dfsFileClose(pdfsIn, &fpIn);
+  rc = dfsHeaderDestroy(&pdfsIn);
+  return num_converted;
+}
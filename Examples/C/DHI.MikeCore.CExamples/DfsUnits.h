@@ -0,0 +1,47 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <stddef.h>
+
+/**
+ * Conversion of item data between EUM units.
+ *
+ * EUM unit conversions are affine, value_to = scale * value_from + offset, so instead of
+ * calling eumConvertUnit for each value, the scale and offset are found once for a pair
+ * of units, by converting 0 and 1, and are cached by unit pair. Item-timestep buffers are
+ * then converted by a multiply-add over the entire buffer, keeping delete values.
+ * The conversion kernels are loops without conditionals, such that they vectorize.
+ */
+
+/** Affine conversion between two units */
+struct DfsUnitScale
+{
+  double scale  = 1;
+  double offset = 0;
+};
+
+/**
+ * Get scale and offset converting from_unit to to_unit, EUM unit ids.
+ * Returns false if the units are not equivalent, i.e. not of the same quantity.
+ * Thread safe.
+ */
+bool GetDfsUnitScale(long from_unit, long to_unit, DfsUnitScale* unit_scale);
+
+/** Get scale and offset converting the unit of item, from dfsGetItemInfo, to to_unit */
+bool GetDfsItemUnitScale(LPITEM item, long to_unit, DfsUnitScale* unit_scale);
+
+/** Convert n values in place, keeping delete values */
+void DfsConvertUnit(float* data, size_t n, const DfsUnitScale& unit_scale, float delete_value);
+void DfsConvertUnit(double* data, size_t n, const DfsUnitScale& unit_scale, double delete_value);
+
+/**
+ * Copy a dfs file, converting dynamic float and double items to the units in to_units,
+ * to_units[i_item-1] being the EUM unit id of item i_item, 0 to keep the unit.
+ * Items that can not be converted to the unit are copied as they are.
+ * Static items are copied as they are.
+ * Returns the number of items converted.
+ */
+long CopyDfsFileConvertUnits(LPCTSTR inputFilename, LPCTSTR outputFilename, const long* to_units);
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsUnits.h"
+#include <CppUnitTest.h>
+
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsUnits_tests)
+  {
+  public:
+
+    /// Scale and offset of unit pairs, and conversion of a buffer with delete values
+    TEST_METHOD(UnitScaleTest)
+    {
+      DfsUnitScale unit_scale;
+      Assert::IsTrue(GetDfsUnitScale(1000, 1014, &unit_scale));     // meter to feet
+      Assert::AreEqual(1 / 0.3048, unit_scale.scale, 1e-9);
+      Assert::AreEqual(0.0, unit_scale.offset, 1e-12);
+      Assert::IsTrue(GetDfsUnitScale(1000, 1014, &unit_scale));     // cached
+      Assert::IsFalse(GetDfsUnitScale(1000, 1400, &unit_scale));    // meter to second
+
+      const float d = 1e-35f;
+      float data[5] = { 1, d, 2.5f, 0, d };
+      Assert::IsTrue(GetDfsUnitScale(1000, 1002, &unit_scale));     // meter to millimeter
+      DfsConvertUnit(data, 5, unit_scale, d);
+      Assert::AreEqual(1000.0f, data[0]);
+      Assert::AreEqual(d, data[1]);
+      Assert::AreEqual(2500.0f, data[2]);
+      Assert::AreEqual(0.0f, data[3]);
+      Assert::AreEqual(d, data[4]);
+    }
+
+    /// Copy OresundHD.dfs2 with item 1 converted from meter to millimeter
+    TEST_METHOD(CopyConvertUnitsTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cunits.dfs2");
+
+      long to_units[3] = { 1002, 0, 0 };
+      Assert::AreEqual(1L, CopyDfsFileConvertUnits(inputFullPath, outputFullPath, to_units));
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(outputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      LONG item_type, item_unit;
+      LPCTSTR item_type_str, item_name, item_unit_str;
+      SimpleType item_datatype;
+      rc = dfsGetItemInfo(dfsItemD(pdfs, 1), &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+      Assert::AreEqual(1002L, (long)item_unit);
+
+      std::vector<float> data(71 * 91);
+      double time;
+      rc = dfsFindItemDynamic(pdfs, fp, 2, 1);
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+      CheckRc(rc, "Error reading item-timestep");
+      Assert::AreEqual(11363.4329f, data[71 * 4 + 3], 1e-2f);
+      Assert::AreEqual(dfsGetDeleteValFloat(pdfs), data[0]);
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+  };
+}
@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsValueType.h"
+
+#include <CppUnitTestLogger.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+
+/** v if mask is 1, delete value if mask is 0, without a conditional */
+static inline double Masked(double v, int mask, double del)
+{
+  return v * (double)mask + del * (double)(1 - mask);
+}
+
+/** Length of the interval ending at each time step, the first taken as the second */
+static void GetIntervals(const double* times, long n, double rate_seconds, double* dt)
+{
+  for (long i = 1; i < n; i++)
+    dt[i] = times[i] - times[i - 1];
+  if (n > 0)
+    dt[0] = n > 1 ? dt[1] : rate_seconds;
+}
+
+/** Step amounts s from values in of value type from */
+static void ToStepAmounts(const double* __restrict in, const double* __restrict dt, long n, DataValueType from,
+                          double rate_seconds, double del, double* __restrict s)
+{
+  if (n == 0)
+    return;
+  double f = 1 / rate_seconds;
+  switch (from)
+  {
+  case Accumulated:
+    s[0] = in[0];
+    for (long i = 1; i < n; i++)
+      s[i] = Masked(in[i] - in[i - 1], (in[i] != del) & (in[i - 1] != del), del);
+    break;
+  case StepAccumulated:
+    memcpy(s, in, n * sizeof(double));
+    break;
+  case MeanStepBackward:
+    for (long i = 0; i < n; i++)
+      s[i] = Masked(in[i] * dt[i] * f, in[i] != del, del);
+    break;
+  case MeanStepForward:
+    s[0] = 0;
+    for (long i = 1; i < n; i++)
+      s[i] = Masked(in[i - 1] * dt[i] * f, in[i - 1] != del, del);
+    break;
+  case Instantaneous:
+    // Trapezoidal rule
+    s[0] = 0;
+    for (long i = 1; i < n; i++)
+      s[i] = Masked(0.5 * (in[i - 1] + in[i]) * dt[i] * f, (in[i] != del) & (in[i - 1] != del), del);
+    break;
+  }
+}
+
+/** Values out of value type to from step amounts s */
+static void FromStepAmounts(const double* __restrict s, const double* __restrict dt, long n, DataValueType to,
+                            double rate_seconds, double del, double* __restrict out)
+{
+  if (n == 0)
+    return;
+  switch (to)
+  {
+  case Accumulated:
+  {
+    // Prefix sum, skipping delete values
+    double acc = 0;
+    for (long i = 0; i < n; i++)
+    {
+      int m = s[i] != del;
+      acc += s[i] * (double)m;
+      out[i] = Masked(acc, m, del);
+    }
+    break;
+  }
+  case StepAccumulated:
+    memcpy(out, s, n * sizeof(double));
+    break;
+  case MeanStepBackward:
+    for (long i = 0; i < n; i++)
+      out[i] = Masked(s[i] * rate_seconds / dt[i], s[i] != del, del);
+    break;
+  case MeanStepForward:
+    for (long i = 0; i < n - 1; i++)
+      out[i] = Masked(s[i + 1] * rate_seconds / dt[i + 1], s[i + 1] != del, del);
+    out[n - 1] = del;
+    break;
+  case Instantaneous:
+  {
+    // Average of mean rates on each side, the one interval at the ends
+    std::vector<double> r(n);
+    for (long i = 0; i < n; i++)
+      r[i] = s[i] * rate_seconds / dt[i];
+    for (long i = 1; i < n - 1; i++)
+      out[i] = Masked(0.5 * (r[i] + r[i + 1]), (s[i] != del) & (s[i + 1] != del), del);
+    if (n == 1)
+      out[0] = Masked(r[0], s[0] != del, del);
+    else
+    {
+      out[0] = Masked(r[1], s[1] != del, del);
+      out[n - 1] = Masked(r[n - 1], s[n - 1] != del, del);
+    }
+    break;
+  }
+  }
+}
+
+void DfsConvertValueType(const double* times, const double* in, long num_timesteps, DataValueType from, DataValueType to,
+                         double rate_seconds, double delete_value, double* out)
+{
+  std::vector<double> dt(num_timesteps);
+  std::vector<double> s(num_timesteps);
+  GetIntervals(times, num_timesteps, rate_seconds, dt.data());
+  ToStepAmounts(in, dt.data(), num_timesteps, from, rate_seconds, delete_value, s.data());
+  FromStepAmounts(s.data(), dt.data(), num_timesteps, to, rate_seconds, delete_value, out);
+}
+
+void DfsTimeSeriesConvertValueType(DfsTimeSeries* ts, const DataValueType* from, DataValueType to, double rate_seconds, int num_threads)
+{
+  long n = ts->num_timesteps;
+  std::vector<double> dt(n);
+  GetIntervals(ts->times.data(), n, rate_seconds, dt.data());
+
+  if (num_threads <= 0)
+    num_threads = (int)std::thread::hardware_concurrency();
+  if (num_threads < 1)
+    num_threads = 1;
+  if (num_threads > ts->num_items)
+    num_threads = ts->num_items;
+
+  // Each thread takes every num_threads'th item, with its own step amount buffer
+  auto convert = [&](int t)
+  {
+    std::vector<double> s(n);
+    for (int i = t; i < ts->num_items; i += num_threads)
+    {
+      double* values = ts->Item(i + 1);
+      ToStepAmounts(values, dt.data(), n, from[i], rate_seconds, ts->delete_value, s.data());
+      FromStepAmounts(s.data(), dt.data(), n, to, rate_seconds, ts->delete_value, values);
+    }
+  };
+  if (num_threads <= 1)
+    convert(0);
+  else
+  {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++)
+      threads.emplace_back(convert, t);
+    for (int t = 0; t < num_threads; t++)
+      threads[t].join();
+  }
+}
+
+long DfsConvertValueTypeFile(LPCTSTR dfs0Filename, LPCTSTR outputFilename, DataValueType to, double rate_seconds, int num_threads)
+{
+  if (rate_seconds <= 0)
+  {
+    LOG("Rate time unit must be positive: %g", rate_seconds);
+    return -1;
+  }
+  DfsTimeSeries ts;
+  if (!ReadDfsTimeSeries(dfs0Filename, &ts))
+    return -1;
+
+  LPHEAD pdfsIn, pdfsWr;
+  LPFILE fpIn, fpWr;
+  long rc = dfsFileRead(dfs0Filename, &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfsIn);
+  std::vector<DataValueType> from(num_items);
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    rc = dfsGetItemValueType(dfsItemD(pdfsIn, i_item), &from[i_item - 1]);
+    CheckRc(rc, "Error getting item value type");
+  }
+  DfsTimeSeriesConvertValueType(&ts, from.data(), to, rate_seconds, num_threads);
+
+  CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    rc = dfsSetItemValueType(dfsItemD(pdfsWr, i_item), to);
+    CheckRc(rc, "Error setting item value type");
+  }
+  rc = dfsFileCreate(outputFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating file");
+  CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
+  rc = dfsFileClose(pdfsIn, &fpIn);
+  rc = dfsHeaderDestroy(&pdfsIn);
+
+  WriteDfsTimeSeriesData(pdfsWr, fpWr, ts);
+
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  return F_NO_ERROR;
+}
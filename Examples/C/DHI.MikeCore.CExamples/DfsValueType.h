@@ -0,0 +1,50 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "DfsTimeSeries.h"
+
+/**
+ * Conversion of dfs0 items between item value types, as used by rainfall series:
+ *
+ *  - Accumulated: Amount since the start of the series
+ *  - StepAccumulated: Amount since the previous time step
+ *  - MeanStepBackward: Mean rate since the previous time step
+ *  - MeanStepForward: Mean rate until the next time step
+ *  - Instantaneous: Rate at the time step
+ *
+ * Values are converted through step amounts, S[i] being the amount in the interval ending at time step i:
+ * Accumulated values are prefix sums of step amounts, and step amounts are differences of accumulated values.
+ * Rates are amounts per rate_seconds, e.g. 3600 for rates in mm/h and amounts in mm. Item units are
+ * not changed by the conversion, so rate_seconds must match the units of the items.
+ *
+ * Time steps need not be equidistant. Before the first time step, the interval is taken as the
+ * first interval of the series, and the amount as the first value for Accumulated, StepAccumulated
+ * and MeanStepBackward, zero otherwise. The last MeanStepForward value is the delete value, as
+ * there is no next interval. Instantaneous rates from step amounts are the average of the mean rates
+ * of the intervals on each side, the mean rate of the one interval at the ends. A delete value gives
+ * the delete value for the values depending on it, Accumulated values otherwise skipping it.
+ *
+ * Kernels are loops without conditionals, such that they vectorize, except the prefix sum
+ * which carries a dependency from one time step to the next. Items are converted in parallel.
+ */
+
+/**
+ * Convert values of one item from one value type to another.
+ * times are the times of the num_timesteps values, in seconds, see DfsTimeSeries.
+ */
+void DfsConvertValueType(const double* times, const double* in, long num_timesteps, DataValueType from, DataValueType to,
+                         double rate_seconds, double delete_value, double* out);
+
+/**
+ * Convert all items of ts to value type to, in place, item i_item having value type from[i_item-1].
+ * num_threads <= 0 uses the number of hardware threads.
+ */
+void DfsTimeSeriesConvertValueType(DfsTimeSeries* ts, const DataValueType* from, DataValueType to, double rate_seconds, int num_threads = 0);
+
+/**
+ * Convert all items of a dfs0 file to value type to, keeping time axis, items and units.
+ * Returns F_NO_ERROR on success, or -1 if the input is not a dfs0 file.
+ */
+long DfsConvertValueTypeFile(LPCTSTR dfs0Filename, LPCTSTR outputFilename, DataValueType to, double rate_seconds, int num_threads = 0);
@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsTimeSeries.h"
+#include "DfsValueType.h"
+#include <CppUnitTest.h>
+
+#include <math.h>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsValueType_tests)
+  {
+  public:
+
+    /// Rain_accumulated.dfs0 converted to step accumulated matches Rain_stepaccumulated.dfs0
+    TEST_METHOD(AccumulatedToStepTest)
+    {
+      char accFullPath[_MAX_PATH];
+      snprintf(accFullPath, _MAX_PATH, "%s%s", TestDataPath(), "Rain_accumulated.dfs0");
+      char stepFullPath[_MAX_PATH];
+      snprintf(stepFullPath, _MAX_PATH, "%s%s", TestDataPath(), "Rain_stepaccumulated.dfs0");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_Rain_Cstepaccumulated.dfs0");
+
+      long rc = DfsConvertValueTypeFile(accFullPath, outputFullPath, StepAccumulated, 3600, 2);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+
+      DfsTimeSeries step, converted;
+      Assert::IsTrue(ReadDfsTimeSeries(stepFullPath, &step));
+      Assert::IsTrue(ReadDfsTimeSeries(outputFullPath, &converted));
+      Assert::AreEqual(step.num_timesteps, converted.num_timesteps);
+      Assert::AreEqual(0.36, step.Item(1)[2], 1e-6);
+      // First value depends on the amount before the series, compare the following
+      for (long i = 1; i < step.num_timesteps; i++)
+        Assert::AreEqual(step.Item(1)[i], converted.Item(1)[i], 1e-4);
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      rc = dfsFileRead(outputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      DataValueType value_type;
+      rc = dfsGetItemValueType(dfsItemD(pdfs, 1), &value_type);
+      Assert::IsTrue(value_type == StepAccumulated);
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+    /// Step accumulated through all other value types and back, on a non-equidistant axis with a delete value
+    TEST_METHOD(RoundTripTest)
+    {
+      const double d = 1e-255;
+      double times[6] = { 0, 3600, 7200, 14400, 18000, 25200 };
+      double step[6]  = { 0, 1.5, 2, d, 0.5, 3 };
+      double values[6], back[6];
+
+      DataValueType types[3] = { Accumulated, MeanStepBackward, MeanStepForward };
+      for (int t = 0; t < 3; t++)
+      {
+        DfsConvertValueType(times, step, 6, StepAccumulated, types[t], 3600, d, values);
+        DfsConvertValueType(times, values, 6, types[t], StepAccumulated, 3600, d, back);
+        for (int i = 1; i < 6; i++)
+        {
+          // Differences of accumulated values next to a delete value are deleted
+          if (types[t] == Accumulated && i == 4)
+            Assert::AreEqual(d, back[i]);
+          else
+            Assert::AreEqual(step[i], back[i], 1e-12);
+        }
+      }
+
+      DfsConvertValueType(times, step, 6, StepAccumulated, Accumulated, 3600, d, values);
+      Assert::AreEqual(3.5, values[2]);
+      Assert::AreEqual(d, values[3]);
+      Assert::AreEqual(7.0, values[5]);
+      DfsConvertValueType(times, step, 6, StepAccumulated, MeanStepBackward, 3600, d, values);
+      Assert::AreEqual(1.5, values[5]);
+      DfsConvertValueType(times, step, 6, StepAccumulated, MeanStepForward, 3600, d, values);
+      Assert::AreEqual(1.5, values[4]);
+      Assert::AreEqual(d, values[5]);
+    }
+
+  };
+}
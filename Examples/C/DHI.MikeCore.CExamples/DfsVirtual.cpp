@@ -0,0 +1,182 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsConcat.h"
+#include "DfsVirtual.h"
+
+#include <CppUnitTestLogger.h>
+
+
+bool DfsVirtualOpen(DfsVirtualDataset* ds, LPCTSTR* filenames, int num_files, int max_open_files)
+{
+  std::vector<int>  skip_first(num_files);
+  std::vector<long> num_timesteps(num_files);
+  if (num_files < 1 || !DfsConcatValidate(filenames, num_files, skip_first.data(), num_timesteps.data()))
+    return false;
+
+  // Keep header of first file, for header and item info
+  LPFILE fp0;
+  long rc = dfsFileRead(filenames[0], &ds->pdfs, &fp0);
+  CheckRc(rc, "Error opening file");
+  rc = dfsFileClose(ds->pdfs, &fp0);
+  ds->taxis_type = dfsGetTimeAxisType(ds->pdfs);
+  ds->num_items = dfsGetNoOfItems(ds->pdfs);
+  long n;
+  TimeAxisType taxis_type;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep, tspan;
+  long neum_unit, index;
+  GetDfsTimeAxis(ds->pdfs, &taxis_type, &n, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+
+  // Build global time step index
+  ds->files.resize(num_files);
+  ds->num_timesteps = 0;
+  for (int k = 0; k < num_files; k++)
+  {
+    DfsVirtualFile& file = ds->files[k];
+    file.filename = filenames[k];
+    file.first_tstep = ds->num_timesteps;
+    file.skip = skip_first[k];
+    file.num_tsteps = num_timesteps[k] - skip_first[k];
+    for (long i = 0; i < file.num_tsteps; i++)
+    {
+      ds->tstep_file.push_back(k);
+      ds->tstep_local.push_back(file.skip + i);
+    }
+    ds->num_timesteps += file.num_tsteps;
+  }
+
+  // Time offsets of each file. Equidistant axes return the local time step index.
+  // Non-equidistant axes return the time relative to the start date of the file,
+  // including tstart, so only calendar axes are shifted, by the difference in start date.
+  for (int k = 0; k < num_files; k++)
+  {
+    DfsVirtualFile& file = ds->files[k];
+    if (ds->taxis_type == F_TM_EQ_AXIS || ds->taxis_type == F_CAL_EQ_AXIS)
+      file.time_offset = file.first_tstep - file.skip;
+    else if (k > 0 && ds->taxis_type == F_CAL_NEQ_AXIS)
+    {
+      LPHEAD pdfs;
+      LPFILE fp;
+      LPCTSTR start_date_k, start_time_k;
+      rc = dfsFileRead(filenames[k], &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      GetDfsTimeAxis(pdfs, &taxis_type, &n, &start_date_k, &start_time_k, &tstart, &tstep, &tspan, &neum_unit, &index);
+      file.time_offset = (DfsDateTimeToSeconds(start_date_k, start_time_k) - DfsDateTimeToSeconds(start_date, start_time)) / unit_sec;
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+  }
+
+  ds->max_open_files = max_open_files < 1 ? 1 : max_open_files;
+  ds->num_open = 0;
+  ds->use_counter = 0;
+  ds->next_tstep = 0;
+  ds->next_item = 1;
+  return true;
+}
+
+/** Get file k open, closing the least recently used file if too many files are open */
+static DfsVirtualFile& DfsVirtualGetFile(DfsVirtualDataset* ds, int k)
+{
+  DfsVirtualFile& file = ds->files[k];
+  file.last_used = ++ds->use_counter;
+  if (file.fp)
+    return file;
+
+  if (ds->num_open >= ds->max_open_files)
+  {
+    int lru = -1;
+    for (size_t j = 0; j < ds->files.size(); j++)
+      if (ds->files[j].fp && (lru < 0 || ds->files[j].last_used < ds->files[lru].last_used))
+        lru = (int)j;
+    DfsVirtualFile& lru_file = ds->files[lru];
+    long rc = dfsFileClose(lru_file.pdfs, &lru_file.fp);
+    rc = dfsHeaderDestroy(&lru_file.pdfs);
+    lru_file.fp = nullptr;
+    lru_file.pdfs = nullptr;
+    ds->num_open--;
+  }
+
+  long rc = dfsFileRead(file.filename.c_str(), &file.pdfs, &file.fp);
+  CheckRc(rc, "Error opening file");
+  file.pos_tstep = -1;
+  file.pos_item = -1;
+  ds->num_open++;
+  return file;
+}
+
+long DfsVirtualFindItemDynamic(DfsVirtualDataset* ds, long tstep, int item)
+{
+  if (tstep < 0 || tstep >= ds->num_timesteps)
+    return F_FAIL_ILLEGEAL_TSTEP;
+  if (item < 1 || item > ds->num_items)
+    return F_FAIL_ILLEGEAL_ITEM;
+  ds->next_tstep = tstep;
+  ds->next_item = item;
+  return F_NO_ERROR;
+}
+
+long DfsVirtualReadItemTimeStep(DfsVirtualDataset* ds, double* time, void* data)
+{
+  if (ds->next_tstep >= ds->num_timesteps)
+    return F_END_OF_FILE;
+
+  DfsVirtualFile& file = DfsVirtualGetFile(ds, ds->tstep_file[ds->next_tstep]);
+  long local_tstep = ds->tstep_local[ds->next_tstep];
+
+  // Only seek when the file is not already positioned at the item-timestep,
+  // i.e. sequential reading does not seek.
+  long rc;
+  if (file.pos_tstep != local_tstep || file.pos_item != ds->next_item)
+  {
+    rc = dfsFindItemDynamic(file.pdfs, file.fp, local_tstep, ds->next_item);
+    if (rc != F_NO_ERROR)
+      return rc;
+  }
+  rc = dfsReadItemTimeStep(file.pdfs, file.fp, time, data);
+  if (rc != F_NO_ERROR)
+  {
+    file.pos_tstep = -1;
+    return rc;
+  }
+  *time += file.time_offset;
+
+  // Advance file position and virtual position
+  file.pos_tstep = local_tstep;
+  file.pos_item = ds->next_item + 1;
+  if (file.pos_item > ds->num_items)
+  {
+    file.pos_tstep++;
+    file.pos_item = 1;
+  }
+  if (++ds->next_item > ds->num_items)
+  {
+    ds->next_tstep++;
+    ds->next_item = 1;
+  }
+  return F_NO_ERROR;
+}
+
+void DfsVirtualClose(DfsVirtualDataset* ds)
+{
+  long rc;
+  for (size_t j = 0; j < ds->files.size(); j++)
+  {
+    DfsVirtualFile& file = ds->files[j];
+    if (file.fp)
+    {
+      rc = dfsFileClose(file.pdfs, &file.fp);
+      rc = dfsHeaderDestroy(&file.pdfs);
+    }
+  }
+  if (ds->pdfs)
+    rc = dfsHeaderDestroy(&ds->pdfs);
+  ds->files.clear();
+  ds->tstep_file.clear();
+  ds->tstep_local.clear();
+  ds->num_open = 0;
+  ds->num_timesteps = 0;
+}
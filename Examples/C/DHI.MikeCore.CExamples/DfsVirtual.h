@@ -0,0 +1,78 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <string>
+#include <vector>
+
+/** One file of a virtual dataset */
+struct DfsVirtualFile
+{
+  std::string filename;
+  long   first_tstep = 0;     ///< Global time step of first time step used from this file
+  long   skip = 0;            ///< Number of time steps skipped at the beginning of the file (hotstart overlap)
+  long   num_tsteps = 0;      ///< Number of time steps used from this file
+  double time_offset = 0;     ///< Offset to add to time read from this file, in time axis units
+
+  LPHEAD pdfs = nullptr;      ///< Open header and file, or NULL if not open
+  LPFILE fp = nullptr;
+  unsigned long last_used = 0;///< Access counter value at last use, for LRU eviction
+  long   pos_tstep = -1;      ///< Local time step and item that fp is positioned at, -1 if unknown
+  int    pos_item = -1;
+};
+
+/**
+ * A virtual dataset, presenting a number of dfs files following each other in time
+ * as one file, without concatenating them on disk.
+ *
+ * A global time step index maps each time step to a file and a local time step.
+ * Files are opened when data is read from them, and at most max_open_files
+ * files are kept open, closing the least recently used file first.
+ */
+struct DfsVirtualDataset
+{
+  std::vector<DfsVirtualFile> files;
+  std::vector<int>  tstep_file;      ///< File index of each global time step
+  std::vector<long> tstep_local;     ///< Local time step in file of each global time step
+
+  LPHEAD pdfs = nullptr;             ///< Header of first file, for header and item info
+  TimeAxisType taxis_type = F_UNDEFINED_TAXIS;
+  long   num_items = 0;
+  long   num_timesteps = 0;
+
+  int    max_open_files = 4;
+  int    num_open = 0;
+  unsigned long use_counter = 0;
+
+  long   next_tstep = 0;             ///< Item-timestep read by next call to DfsVirtualReadItemTimeStep
+  int    next_item = 1;
+};
+
+/**
+ * Open a virtual dataset of a number of dfs files, in time order.
+ * The files must be compatible as checked by DfsConcatValidate. A file
+ * starting with the last time step of the previous file (a hotstart) is
+ * only included once.
+ *
+ * Returns false if files are not compatible.
+ */
+bool DfsVirtualOpen(DfsVirtualDataset* ds, LPCTSTR* filenames, int num_files, int max_open_files = 4);
+
+/**
+ * Position the virtual dataset at the given global time step (zero based) and
+ * item (one based), similar to dfsFindItemDynamic.
+ */
+long DfsVirtualFindItemDynamic(DfsVirtualDataset* ds, long tstep, int item);
+
+/**
+ * Read the next item-timestep, similar to dfsReadItemTimeStep.
+ *
+ * For equidistant time axes, time is the global timestep index. For non-equidistant
+ * time axes, time is the time from the start of the first file.
+ */
+long DfsVirtualReadItemTimeStep(DfsVirtualDataset* ds, double* time, void* data);
+
+/** Close all files of the virtual dataset */
+void DfsVirtualClose(DfsVirtualDataset* ds);
@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsVirtual.h"
+#include <CppUnitTest.h>
+
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsVirtual_tests)
+  {
+  public:
+
+    /// Split OresundHD.dfs2 in two segments, sharing one time step, and read them as one virtual dataset
+    TEST_METHOD(VirtualDfs2SegmentsTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char segment1FullPath[_MAX_PATH];
+      snprintf(segment1FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_vsegment1.dfs2");
+      char segment2FullPath[_MAX_PATH];
+      snprintf(segment2FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_vsegment2.dfs2");
+
+      DfsTimeWindow window1, window2;
+      window1.end = 6;
+      window2.start = 6;
+      Assert::AreEqual((long)F_NO_ERROR, CopyDfsFileTimeWindow(inputFullPath, segment1FullPath, window1));
+      Assert::AreEqual((long)F_NO_ERROR, CopyDfsFileTimeWindow(inputFullPath, segment2FullPath, window2));
+
+      // Allow only one open file, forcing files to be closed and reopened
+      LPCTSTR sources[2] = { segment1FullPath, segment2FullPath };
+      DfsVirtualDataset ds;
+      Assert::IsTrue(DfsVirtualOpen(&ds, sources, 2, 1));
+      Assert::AreEqual((long)13, ds.num_timesteps);
+      Assert::AreEqual((long)3, ds.num_items);
+
+      std::vector<float> data(dfsGetItemElements(dfsItemD(ds.pdfs, 1)));
+      double time;
+      long rc = DfsVirtualFindItemDynamic(&ds, 2, 1);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      rc = DfsVirtualReadItemTimeStep(&ds, &time, data.data());
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::AreEqual(2.0, time);
+      Assert::AreEqual(11.3634329f, data[71 * 4 + 3]);
+
+      // Read all item-timesteps in reverse order, switching between files, and compare with original file
+      LPHEAD pdfs;
+      LPFILE fp;
+      rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      std::vector<float> expected(data.size());
+      double expected_time;
+      for (long i_tstep = 12; i_tstep >= 0; i_tstep--)
+      {
+        for (int i_item = 1; i_item <= 3; i_item++)
+        {
+          rc = dfsFindItemDynamic(pdfs, fp, i_tstep, i_item);
+          CheckRc(rc, "Error finding item-timestep");
+          rc = dfsReadItemTimeStep(pdfs, fp, &expected_time, expected.data());
+          CheckRc(rc, "Error reading item-timestep");
+          rc = DfsVirtualFindItemDynamic(&ds, i_tstep, i_item);
+          Assert::AreEqual((long)F_NO_ERROR, rc);
+          rc = DfsVirtualReadItemTimeStep(&ds, &time, data.data());
+          Assert::AreEqual((long)F_NO_ERROR, rc);
+          Assert::AreEqual((double)i_tstep, time);
+          Assert::IsTrue(expected == data);
+        }
+      }
+      Assert::AreEqual(1, ds.num_open);
+
+      // Sequential read continues from one file into the next
+      rc = DfsVirtualFindItemDynamic(&ds, 6, 3);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      rc = DfsVirtualReadItemTimeStep(&ds, &time, data.data());
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      rc = DfsVirtualReadItemTimeStep(&ds, &time, data.data());
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+      Assert::AreEqual(7.0, time);
+      rc = dfsFindItemDynamic(pdfs, fp, 7, 1);
+      rc = dfsReadItemTimeStep(pdfs, fp, &expected_time, expected.data());
+      Assert::IsTrue(expected == data);
+
+      Assert::AreEqual((long)F_FAIL_ILLEGEAL_TSTEP, DfsVirtualFindItemDynamic(&ds, 13, 1));
+
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+      DfsVirtualClose(&ds);
+    }
+
+    /// Non-equidistant calendar axis, second file with an earlier start date and a tstart
+    TEST_METHOD(VirtualNeqCalendarTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "TemporalNeqCal.dfs0");
+      char segment1FullPath[_MAX_PATH];
+      snprintf(segment1FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_TemporalNeqCal_vsegment1.dfs0");
+      char segment2FullPath[_MAX_PATH];
+      snprintf(segment2FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_TemporalNeqCal_vsegment2.dfs0");
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      TimeAxisType taxis_type;
+      LPCTSTR start_date, start_time;
+      double tstart, tstep, tspan;
+      long num_timesteps, neum_unit, index;
+      GetDfsTimeAxis(pdfs, &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+      Assert::AreEqual((int)F_CAL_NEQ_AXIS, (int)taxis_type);
+      Assert::IsTrue(num_timesteps > 2);
+      int num_items = dfsGetNoOfItems(pdfs);
+
+      // Times and data of all item-timesteps of the original file
+      std::vector<double> times(num_timesteps);
+      std::vector<std::vector<double>> data(num_timesteps * num_items);
+      for (long i_tstep = 0; i_tstep < num_timesteps; i_tstep++)
+      {
+        for (int i_item = 1; i_item <= num_items; i_item++)
+        {
+          std::vector<double>& buf = data[i_tstep * num_items + i_item - 1];
+          buf.resize((dfsGetItemBytes(dfsItemD(pdfs, i_item)) + sizeof(double) - 1) / sizeof(double));
+          rc = dfsReadItemTimeStep(pdfs, fp, &times[i_tstep], buf.data());
+          CheckRc(rc, "Error reading item-timestep");
+        }
+      }
+
+      // First segment up to and including time step m
+      long m = num_timesteps / 2;
+      DfsTimeWindow window1;
+      window1.end = m;
+      Assert::AreEqual((long)F_NO_ERROR, CopyDfsFileTimeWindow(inputFullPath, segment1FullPath, window1));
+
+      // Second segment from time step m, with a start date one day earlier, times
+      // relative to that start date, and tstart being the first time
+      double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+      double shift = 86400 / unit_sec;
+      char date2[11], time2[9];
+      DfsSecondsToDateTime(DfsDateTimeToSeconds(start_date, start_time) - 86400, date2, time2);
+      LPHEAD pdfsWr;
+      LPFILE fpWr;
+      CreateDfsHeaderFromSource(pdfs, &pdfsWr, num_items);
+      rc = dfsSetNeqCalendarAxis(pdfsWr, date2, time2, neum_unit, times[m] + shift, 0);
+      CheckRc(rc, "Error setting time axis");
+      CopyDfsDynamicItemInfo(pdfs, pdfsWr, num_items);
+      rc = dfsFileCreate(segment2FullPath, pdfsWr, &fpWr);
+      CheckRc(rc, "Error creating file");
+      CopyDfsStaticItems(pdfs, fp, pdfsWr, fpWr);
+      for (long i_tstep = m; i_tstep < num_timesteps; i_tstep++)
+      {
+        for (int i_item = 1; i_item <= num_items; i_item++)
+        {
+          rc = dfsWriteItemTimeStep(pdfsWr, fpWr, times[i_tstep] + shift, data[i_tstep * num_items + i_item - 1].data());
+          CheckRc(rc, "Error writing item-timestep");
+        }
+      }
+      rc = dfsFileClose(pdfsWr, &fpWr);
+      rc = dfsHeaderDestroy(&pdfsWr);
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+
+      // Virtual times are relative to the start date of the first file
+      LPCTSTR sources[2] = { segment1FullPath, segment2FullPath };
+      DfsVirtualDataset ds;
+      Assert::IsTrue(DfsVirtualOpen(&ds, sources, 2, 2));
+      Assert::AreEqual(num_timesteps, ds.num_timesteps);
+      for (long i_tstep = 0; i_tstep < num_timesteps; i_tstep++)
+      {
+        for (int i_item = 1; i_item <= num_items; i_item++)
+        {
+          const std::vector<double>& expected = data[i_tstep * num_items + i_item - 1];
+          std::vector<double> buf(expected.size());
+          double time;
+          rc = DfsVirtualFindItemDynamic(&ds, i_tstep, i_item);
+          Assert::AreEqual((long)F_NO_ERROR, rc);
+          rc = DfsVirtualReadItemTimeStep(&ds, &time, buf.data());
+          Assert::AreEqual((long)F_NO_ERROR, rc);
+          Assert::AreEqual(times[i_tstep], time, 1e-6);
+          Assert::IsTrue(expected == buf);
+        }
+      }
+      DfsVirtualClose(&ds);
+    }
+
+  };
+}
@@ -0,0 +1,154 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsWetCells.h"
+
+#include <CppUnitTestLogger.h>
+#include <string.h>
+
+
+void BuildDfsWetMask(const float* grid, long nj, long nk, float delete_value, DfsWetMask* mask)
+{
+  BuildDfsWetMask(grid, nj, nk, delete_value, delete_value, mask);
+}
+
+void BuildDfsWetMask(const float* grid, long nj, long nk, float delete_value, float land_value, DfsWetMask* mask)
+{
+  mask->nj = nj;
+  mask->nk = nk;
+  mask->delete_value = delete_value;
+  mask->float_items = false;
+  mask->wet_cells.clear();
+  mask->run_starts.clear();
+  mask->run_lengths.clear();
+  mask->grid_to_wet.assign(nj * nk, -1);
+  for (int32_t i = 0; i < (int32_t)(nj * nk); i++)
+  {
+    if (grid[i] == delete_value || grid[i] == land_value)
+      continue;
+    mask->grid_to_wet[i] = (int32_t)mask->wet_cells.size();
+    mask->wet_cells.push_back(i);
+    // Extend current run, or start a new one
+    if (!mask->run_starts.empty() && mask->run_starts.back() + mask->run_lengths.back() == i)
+      mask->run_lengths.back()++;
+    else
+    {
+      mask->run_starts.push_back(i);
+      mask->run_lengths.push_back(1);
+    }
+  }
+}
+
+bool DfsWetValidateItems(LPHEAD pdfs, DfsWetMask* mask)
+{
+  long nj = mask->nj, nk = mask->nk;
+  mask->float_items = false;
+  for (int i_item = 1; i_item <= dfsGetNoOfItems(pdfs); i_item++)
+  {
+    LPITEM item = dfsItemD(pdfs, i_item);
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    SimpleType item_datatype;
+    long rc = dfsGetItemInfo(item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+    if (rc != F_NO_ERROR || item_datatype != UFS_FLOAT || dfsGetItemElements(item) != nj * nk)
+    {
+      LOG("Dynamic item %d is not a float item on the %ld x %ld grid", i_item, nj, nk);
+      return false;
+    }
+  }
+  mask->float_items = true;
+  return true;
+}
+
+bool ReadDfsWetMask(LPHEAD pdfs, LPFILE fp, DfsWetMask* mask)
+{
+  LONG    axis_unit;
+  LPCTSTR axis_unit_str;
+  LONG    nj, nk, j, k;
+  float   x0, y0, dx, dy;
+  if (dfsGetNoOfItems(pdfs) < 1 || dfsGetItemAxisType(dfsItemD(pdfs, 1)) != F_EQ_AXIS_D2)
+  {
+    LOG("Dynamic item 1 is not an equidistant 2D item");
+    return false;
+  }
+  dfsGetItemAxisEqD2(dfsItemD(pdfs, 1), &axis_unit, &axis_unit_str, &nj, &nk, &x0, &y0, &dx, &dy);
+  // Land is either the land value of the "M21_MISC" custom block or the delete value
+  float delete_value = dfsGetDeleteValFloat(pdfs);
+  float land_value = delete_value;
+  GetDfsLandValue(pdfs, &land_value);
+
+  // Read all static items, using the first float item on the grid
+  bool found = false;
+  long rc;
+  LPVECTOR pvec;
+  while (nullptr != (pvec = dfsStaticRead(fp, &rc)))
+  {
+    LPITEM static_item = dfsItemS(pvec);
+    LONG item_type, item_unit;
+    LPCTSTR item_type_str, item_name, item_unit_str;
+    SimpleType item_datatype;
+    rc = dfsGetItemInfo(static_item, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+    if (!found && item_datatype == UFS_FLOAT && dfsGetItemAxisType(static_item) == F_EQ_AXIS_D2)
+    {
+      dfsGetItemAxisEqD2(static_item, &axis_unit, &axis_unit_str, &j, &k, &x0, &y0, &dx, &dy);
+      if (j == nj && k == nk)
+      {
+        std::vector<float> grid(nj * nk);
+        rc = dfsStaticGetData(pvec, grid.data());
+        CheckRc(rc, "Error reading static data");
+        BuildDfsWetMask(grid.data(), nj, nk, delete_value, land_value, mask);
+        found = true;
+      }
+    }
+    rc = dfsStaticDestroy(&pvec);
+  }
+  if (!found)
+    LOG("No static float item on the %ld x %ld grid", (long)nj, (long)nk);
+  return found && DfsWetValidateItems(pdfs, mask);
+}
+
+void DfsWetCompact(const DfsWetMask& mask, const float* grid, float* wet)
+{
+  size_t n = 0;
+  for (size_t r = 0; r < mask.run_starts.size(); r++)
+  {
+    memcpy(wet + n, grid + mask.run_starts[r], mask.run_lengths[r] * sizeof(float));
+    n += mask.run_lengths[r];
+  }
+}
+
+void DfsWetScatter(const DfsWetMask& mask, const float* wet, float* grid)
+{
+  // Dry cells are the gaps between runs
+  size_t n = 0;
+  int32_t next = 0;
+  for (size_t r = 0; r < mask.run_starts.size(); r++)
+  {
+    for (int32_t i = next; i < mask.run_starts[r]; i++)
+      grid[i] = mask.delete_value;
+    memcpy(grid + mask.run_starts[r], wet + n, mask.run_lengths[r] * sizeof(float));
+    n += mask.run_lengths[r];
+    next = mask.run_starts[r] + mask.run_lengths[r];
+  }
+  for (int32_t i = next; i < (int32_t)(mask.nj * mask.nk); i++)
+    grid[i] = mask.delete_value;
+}
+
+long DfsReadItemTimeStepWet(LPHEAD pdfs, LPFILE fp, const DfsWetMask& mask, double* time, float* wet, float* grid)
+{
+  if (!mask.float_items)
+    return -1;
+  long rc = dfsReadItemTimeStep(pdfs, fp, time, grid);
+  if (rc == F_NO_ERROR)
+    DfsWetCompact(mask, grid, wet);
+  return rc;
+}
+
+long DfsWriteItemTimeStepWet(LPHEAD pdfs, LPFILE fp, const DfsWetMask& mask, double time, const float* wet, float* grid)
+{
+  if (!mask.float_items)
+    return -1;
+  DfsWetScatter(mask, wet, grid);
+  return dfsWriteItemTimeStep(pdfs, fp, time, grid);
+}
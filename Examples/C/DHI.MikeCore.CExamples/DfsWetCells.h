@@ -0,0 +1,78 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Sparse wet-cell representation of a dfs2 grid.
+ *
+ * In coastal dfs2 results most cells are land, holding the delete value in every
+ * item-timestep. The wet-cell mask is derived once from the static bathymetry item,
+ * where land cells hold the land value of the "M21_MISC" custom block,
+ * and each item-timestep is compacted into a dense vector of the wet cell values only.
+ * Kernels work on the compact vector, which is scattered back to the full grid
+ * only when writing a dfs2 file.
+ *
+ * Wet cells are stored in grid order, and as runs of consecutive wet cells,
+ * such that compacting and scattering are block copies of each run.
+ */
+struct DfsWetMask
+{
+  long nj = 0, nk = 0;                ///< Grid size
+  std::vector<int32_t> wet_cells;     ///< Grid index (k * nj + j) of each wet cell
+  std::vector<int32_t> grid_to_wet;   ///< Wet cell index of each grid cell, -1 for dry cells
+  std::vector<int32_t> run_starts;    ///< Grid index of the first cell of each run of wet cells
+  std::vector<int32_t> run_lengths;   ///< Number of cells in each run of wet cells
+  float delete_value = 1e-35f;        ///< Delete value of the file, written to dry cells
+  bool  float_items = false;          ///< True if the dynamic items are validated to be float items on the grid
+
+  long NumWet() const { return (long)wet_cells.size(); }
+};
+
+/**
+ * Build mask from the first static float item on the grid of dynamic item 1, usually
+ * the bathymetry, a cell being wet if the static value is neither the land value of the
+ * "M21_MISC" custom block nor the delete value.
+ * Must be called right after opening the file, before any dynamic data is read,
+ * as it reads the static items. Returns false if there is no such static item, or if
+ * the dynamic items are not all float items on the grid, see DfsWetValidateItems.
+ */
+bool ReadDfsWetMask(LPHEAD pdfs, LPFILE fp, DfsWetMask* mask);
+
+/**
+ * Validate once that all dynamic items of the file are float items on the grid of the mask,
+ * as required by DfsReadItemTimeStepWet and DfsWriteItemTimeStepWet, setting float_items.
+ * Masks built by BuildDfsWetMask must be validated before reading or writing.
+ */
+bool DfsWetValidateItems(LPHEAD pdfs, DfsWetMask* mask);
+
+/** Build mask from a grid, a cell being wet if its value is not the delete value */
+void BuildDfsWetMask(const float* grid, long nj, long nk, float delete_value, DfsWetMask* mask);
+
+/** Build mask from a grid, a cell being wet if its value is neither the delete value nor the land value */
+void BuildDfsWetMask(const float* grid, long nj, long nk, float delete_value, float land_value, DfsWetMask* mask);
+
+/** Compact wet cell values of grid (nj * nk values) into wet (NumWet() values) */
+void DfsWetCompact(const DfsWetMask& mask, const float* grid, float* wet);
+
+/** Scatter wet cell values into grid, setting dry cells to the delete value */
+void DfsWetScatter(const DfsWetMask& mask, const float* wet, float* grid);
+
+/**
+ * Read the next item-timestep, as dfsReadItemTimeStep, and compact it into wet.
+ * grid is a buffer of nj * nk values for the full item-timestep.
+ * Returns -1 if the mask is not validated for float items, see DfsWetValidateItems.
+ */
+long DfsReadItemTimeStepWet(LPHEAD pdfs, LPFILE fp, const DfsWetMask& mask, double* time, float* wet, float* grid);
+
+/**
+ * Scatter wet into the full grid and write it as the next item-timestep, as dfsWriteItemTimeStep.
+ * grid is a buffer of nj * nk values for the full item-timestep. The file must have the
+ * dynamic items of the file the mask was validated for.
+ * Returns -1 if the mask is not validated for float items, see DfsWetValidateItems.
+ */
+long DfsWriteItemTimeStepWet(LPHEAD pdfs, LPFILE fp, const DfsWetMask& mask, double time, const float* wet, float* grid);
@@ -0,0 +1,96 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsWetCells.h"
+#include <CppUnitTest.h>
+
+#include <string.h>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(DfsWetCells_tests)
+  {
+  public:
+
+    /// Wet cells of OresundHD.dfs2 from bathymetry, compact and scatter all item-timesteps
+    TEST_METHOD(WetCellsDfs2Test)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+
+      DfsWetMask mask;
+      Assert::IsTrue(ReadDfsWetMask(pdfs, fp, &mask));
+      Assert::AreEqual(71L, mask.nj);
+      Assert::AreEqual(91L, mask.nk);
+      // Land cells of the bathymetry hold the land value 10
+      Assert::AreEqual(71L * 91 - 3712, mask.NumWet());
+      Assert::IsTrue(mask.float_items);
+      long run_cells = 0;
+      for (size_t r = 0; r < mask.run_lengths.size(); r++)
+        run_cells += mask.run_lengths[r];
+      Assert::AreEqual(mask.NumWet(), run_cells);
+      Assert::IsTrue(mask.run_starts.size() < (size_t)mask.NumWet());
+
+      // Land cells are delete values in all item-timesteps, so compact and scatter is lossless
+      std::vector<float> grid(71 * 91);
+      std::vector<float> grid2(71 * 91);
+      std::vector<float> wet(mask.NumWet());
+      int index34 = 71 * 4 + 3;
+      double time;
+      for (long i_tstep = 0; i_tstep < 13; i_tstep++)
+      {
+        for (int i_item = 1; i_item <= 3; i_item++)
+        {
+          rc = DfsReadItemTimeStepWet(pdfs, fp, mask, &time, wet.data(), grid.data());
+          CheckRc(rc, "Error reading item-timestep");
+          DfsWetScatter(mask, wet.data(), grid2.data());
+          Assert::AreEqual(0, memcmp(grid.data(), grid2.data(), grid.size() * sizeof(float)));
+          if (i_tstep == 2 && i_item == 1)
+          {
+            Assert::AreNotEqual(-1, mask.grid_to_wet[index34]);
+            Assert::AreEqual(11.3634329f, wet[mask.grid_to_wet[index34]]);
+          }
+        }
+      }
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+    /// Runs and scatter of a small grid
+    TEST_METHOD(WetMaskRunsTest)
+    {
+      const float d = 1e-35f;
+      float grid[8] = { d, 1, 2, d, d, 3, d, 4 };
+      DfsWetMask mask;
+      BuildDfsWetMask(grid, 4, 2, d, &mask);
+      Assert::AreEqual(4L, mask.NumWet());
+      Assert::AreEqual((size_t)3, mask.run_starts.size());
+      Assert::AreEqual(2, mask.run_lengths[0]);
+      float wet[4];
+      DfsWetCompact(mask, grid, wet);
+      Assert::AreEqual(3.0f, wet[2]);
+      float grid2[8];
+      DfsWetScatter(mask, wet, grid2);
+      Assert::AreEqual(0, memcmp(grid, grid2, sizeof(grid)));
+
+      // Land value cells are dry as well
+      float bathy[8] = { 10, -1, -2, d, d, -3, 10, 10 };
+      BuildDfsWetMask(bathy, 4, 2, d, 10.0f, &mask);
+      Assert::AreEqual(3L, mask.NumWet());
+      Assert::IsFalse(mask.float_items);
+      Assert::AreEqual(-1, mask.grid_to_wet[0]);
+      Assert::AreEqual(2, mask.grid_to_wet[5]);
+    }
+
+  };
+}
@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsuUtil.h"
+
+#include <CppUnitTestLogger.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+/**
+ * Read Geometry from DFSU file:
+ * Mesh sizes are read from custom block "MIKE_FM"
+ * Mesh definition are read from static items
+ */
+void ReadDfsuGeometry(LPHEAD pdfs, LPFILE fp, MeshGeometry* mesh)
+{
+  // Get reference to the first custom block
+  LPBLOCK customblock_ptr;
+  long rc = dfsGetCustomBlockRef(pdfs, &customblock_ptr);
+  CheckRc(rc, "Error reading custom block");
+  // Search for "MIKE_FM" custom block containing int data
+  while (customblock_ptr)
+  {
+    SimpleType csdata_type;      // Type of data stored in custom block
+    LPCTSTR name;                // Name of custom block
+    LONG size;                   // Number of values in custom block
+    void* customblock_data_ptr;  // custom block data, updated with every call below to next custom block
+    rc = dfsGetCustomBlock(customblock_ptr, &csdata_type, &name,
+                           &size, &customblock_data_ptr, &customblock_ptr);
+    CheckRc(rc, "Error reading custom block");
+    if (0 == strcmp(name, "MIKE_FM") && csdata_type == UFS_INT)
+    {
+      int* intData         = (int*)customblock_data_ptr;
+      mesh->num_nodes      = intData[0];
+      mesh->num_elmts      = intData[1];
+      mesh->dimension      = intData[2];
+      mesh->max_num_layers = intData[3];
+      if (size < 5)
+        mesh->num_sigma_layers = mesh->max_num_layers;
+      else
+        mesh->num_sigma_layers = intData[4];
+      break;
+    }
+  }
+  if (mesh->num_nodes < 0)
+  {
+    Logger::WriteMessage("Error in Geometry definition: Could not find custom block \"MIKE_FM\"\n");
+    exit(-1);
+  }
+  if (mesh->dimension != 2 || mesh->max_num_layers > 0 || mesh->num_sigma_layers > 0)
+  {
+    Logger::WriteMessage("This tool currently only supports standard 2D (horizontal) dfsu files\n");
+    exit(-1);
+  }
+
+  // Read mesh geometry from static items in DFSU file
+  mesh->node_ids       = (int*)    ReadDfsStaticItem(fp, pdfs, "Node id", UFS_INT);
+  mesh->node_x         = (double*) ReadDfsStaticItem(fp, pdfs, "X-coord", UFS_DOUBLE);
+  mesh->node_y         = (double*) ReadDfsStaticItem(fp, pdfs, "Y-coord", UFS_DOUBLE);
+  mesh->node_z         = (float*)  ReadDfsStaticItem(fp, pdfs, "Z-coord", UFS_FLOAT);
+  mesh->node_codes     = (int*)    ReadDfsStaticItem(fp, pdfs, "Code", UFS_INT);
+
+  mesh->elmt_ids       = (int*)    ReadDfsStaticItem(fp, pdfs, "Element id", UFS_INT);
+  mesh->elmt_types     = (int*)    ReadDfsStaticItem(fp, pdfs, "Element type", UFS_INT);
+  mesh->elmt_num_nodes = (int*)    ReadDfsStaticItem(fp, pdfs, "No of nodes", UFS_INT);
+  mesh->elmt_conn      = (int*)    ReadDfsStaticItem(fp, pdfs, "Connectivity", UFS_INT, &(mesh->num_conn));
+}
+
+/**
+ * Write Geometry to DFSU file:
+ * Mesh sizes are written to custom block "MIKE_FM"
+ */
+void WriteDfsuGeometryHeader(LPHEAD pdfs, MeshGeometry* mesh)
+{
+  int custblock_data[5];
+  custblock_data[0] = mesh->num_nodes;
+  custblock_data[1] = mesh->num_elmts;
+  custblock_data[2] = mesh->dimension;
+  custblock_data[3] = mesh->max_num_layers;
+  custblock_data[4] = mesh->num_sigma_layers;
+  long rc = dfsAddCustomBlock(pdfs, UFS_INT, "MIKE_FM", 5, custblock_data);
+  CheckRc(rc, "Error adding MIKE_FM Custom block");
+}
+
+/**
+ * Write Geometry to DFSU file:
+ * Mesh definition are written to static items
+ */
+void WriteDfsuGeometryStatic(LPHEAD pdfs, LPFILE fp, MeshGeometry* mesh)
+{
+  // Write mesh geometry from static items in DFSU file
+  WriteDfsStaticItem(fp, pdfs, "Node id"     , UFS_INT   , mesh->num_nodes, mesh->node_ids      );
+  WriteDfsStaticItem(fp, pdfs, "X-coord"     , UFS_DOUBLE, mesh->num_nodes, mesh->node_x        );
+  WriteDfsStaticItem(fp, pdfs, "Y-coord"     , UFS_DOUBLE, mesh->num_nodes, mesh->node_y        );
+  WriteDfsStaticItem(fp, pdfs, "Z-coord"     , UFS_FLOAT , mesh->num_nodes, mesh->node_z        );
+  WriteDfsStaticItem(fp, pdfs, "Code"        , UFS_INT   , mesh->num_nodes, mesh->node_codes    );
+
+  WriteDfsStaticItem(fp, pdfs, "Element id"  , UFS_INT   , mesh->num_elmts, mesh->elmt_ids      );
+  WriteDfsStaticItem(fp, pdfs, "Element type", UFS_INT   , mesh->num_elmts, mesh->elmt_types    );
+  WriteDfsStaticItem(fp, pdfs, "No of nodes" , UFS_INT   , mesh->num_elmts, mesh->elmt_num_nodes);
+  WriteDfsStaticItem(fp, pdfs, "Connectivity", UFS_INT   , mesh->num_conn,  mesh->elmt_conn     );
+}
+
+/** Free arrays of mesh geometry */
+void CleanupMeshGeometry(MeshGeometry* mesh)
+{
+  free(mesh->node_ids);
+  free(mesh->node_x);
+  free(mesh->node_y);
+  free(mesh->node_z);
+  free(mesh->node_codes);
+  free(mesh->elmt_ids);
+  free(mesh->elmt_types);
+  free(mesh->elmt_num_nodes);
+  free(mesh->elmt_conn);
+}
+
+/** True if the file has a "MIKE_FM" custom block of a 2D mesh, as supported by ReadDfsuGeometry */
+bool IsDfsu2D(LPHEAD pdfs)
+{
+  LPBLOCK customblock_ptr;
+  long rc = dfsGetCustomBlockRef(pdfs, &customblock_ptr);
+  while (rc == F_NO_ERROR && customblock_ptr)
+  {
+    SimpleType csdata_type;
+    LPCTSTR name;
+    LONG size;
+    void* customblock_data_ptr;
+    rc = dfsGetCustomBlock(customblock_ptr, &csdata_type, &name, &size, &customblock_data_ptr, &customblock_ptr);
+    if (rc == F_NO_ERROR && 0 == strcmp(name, "MIKE_FM") && csdata_type == UFS_INT && size >= 4)
+    {
+      int* intData = (int*)customblock_data_ptr;
+      int num_sigma_layers = size < 5 ? intData[3] : intData[4];
+      return intData[2] == 2 && intData[3] == 0 && num_sigma_layers == 0;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+
+/**
+ * Geometry of mesh in DFSU file. For details, read the
+ * "DFS Flexible File Formats, DFSU 2D/3D, Vertical Profile/Column, and Mesh File, Technical Documentation"
+ * https://manuals.mikepoweredbydhi.help/2020/General/FM_FileSpecification.pdf
+ * available from the "MIKE SDK Documentation Index"
+ * https://manuals.mikepoweredbydhi.help/2020/MIKE_SDK.htm
+ */
+struct MeshGeometry
+{
+  MeshGeometry() = default;
+
+  int num_nodes = 0;                ///< Number of nodes
+  int num_elmts = 0;                ///< Number of elements
+  int dimension = 0;                ///< Dimension of the file 
+  int max_num_layers = 0;           ///< Maximum number of layers, vertical 
+  int num_sigma_layers = 0;         ///< Number of sigma layers, vertical
+
+  int num_conn = 0;                 ///< Size of elmt_conn array
+
+  int*    node_ids = nullptr;       ///< Node Id's
+  double* node_x = nullptr;         ///< X coordinates of nodes
+  double* node_y = nullptr;         ///< Y Coordinates of nodes
+  float*  node_z = nullptr;         ///< Z Coordinates of nodes
+  int*    node_codes = nullptr;     ///< Node boundary code
+
+  int*    elmt_ids = nullptr;       ///< Element Id's
+  int*    elmt_types = nullptr;     ///< Element Type
+  int*    elmt_num_nodes = nullptr; ///< Number of nodes in each element
+  int*    elmt_conn = nullptr;      ///< Indices of nodes in each element
+};
+
+bool IsDfsu2D(LPHEAD pdfs);
+void ReadDfsuGeometry(LPHEAD pdfs, LPFILE fp, MeshGeometry* mesh);
+void WriteDfsuGeometryHeader(LPHEAD pdfs, MeshGeometry* mesh);
+void WriteDfsuGeometryStatic(LPHEAD pdfs, LPFILE fp, MeshGeometry* mesh);
+void CleanupMeshGeometry(MeshGeometry* mesh);
@@ -435,13 +435,8 @@ namespace UnitestForC_MikeCore
 
       CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
 
-      // Buffer for reading dynamic item data
-      // As void pointer values, since the type is not known (double vs float)
-      void** item_timestep_dataf = (void**)malloc(num_items*sizeof(void*));
-      for (int i_item = 1; i_item <= num_items; i_item++)
-        item_timestep_dataf[i_item - 1] = malloc(dfsGetItemBytes(dfsItemD(pdfsIn, i_item)));
-
-      CopyDfsTemporalData(pdfsIn, fpIn, pdfsWr, fpWr, item_timestep_dataf, num_timesteps, num_items);
+      // Buffers for dynamic item data are of the type of each item (double vs float)
+      CopyDfsTemporalData(pdfsIn, fpIn, pdfsWr, fpWr, num_timesteps, num_items);
 
       // Close file and destroy header
       rc = dfsFileClose(pdfsWr, &fpWr);
@@ -449,10 +444,6 @@ namespace UnitestForC_MikeCore
       // Close file and destroy header
       rc = dfsFileClose(pdfsIn, &fpIn);
       rc = dfsHeaderDestroy(&pdfsIn);
-
-      for (int i_item = 1; i_item <= num_items; i_item++)
-        free(item_timestep_dataf[i_item - 1]);
-      free(item_timestep_dataf);
     }
 
     void GetDfsDeleteVals(LPHEAD pdfsIn, float* deleteF, double* deleteD, char* deleteByte, int* deleteInt, unsigned int* deleteUint)
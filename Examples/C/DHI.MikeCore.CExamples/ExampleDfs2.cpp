@@ -194,9 +194,10 @@ namespace UnitestForC_MikeCore
       item_timestep_dataf[2] = new float[item_num_elmts];
 
       // Copy first 10 time steps
-      long num_timesteps = 10;
+      DfsTimeWindow window;
+      window.end = 9;
       long num_items = dfsGetNoOfItems(pdfs);
-      CopyDfsTemporalData(pdfs, fp, pdfsWr, fpWr, (void**)item_timestep_dataf, num_timesteps, num_items);
+      CopyDfsTemporalDataWindow(pdfs, fp, pdfsWr, fpWr, (void**)item_timestep_dataf, num_items, window);
 
       // Close file and destroy header
       rc = dfsFileClose(pdfsWr, &fpWr);
@@ -260,12 +261,8 @@ namespace UnitestForC_MikeCore
 
       CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
 
-      // Buffer for reading dynamic item data
-      float** item_timestep_dataf = new float*[num_items];
-      for (int i_item = 1; i_item <= num_items; i_item++)
-        item_timestep_dataf[i_item - 1] = new float[dfsGetItemElements(dfsItemD(pdfsIn, i_item))];
-
-      CopyDfsTemporalData(pdfsIn, fpIn, pdfsWr, fpWr, item_timestep_dataf, num_timesteps, num_items);
+      // Buffers for dynamic item data are of the type of each item (double vs float)
+      CopyDfsTemporalData(pdfsIn, fpIn, pdfsWr, fpWr, num_timesteps, num_items);
 
       // Close file and destroy header
       rc = dfsFileClose(pdfsWr, &fpWr);
@@ -273,10 +270,6 @@ namespace UnitestForC_MikeCore
       // Close file and destroy header
       rc = dfsFileClose(pdfsIn, &fpIn);
       rc = dfsHeaderDestroy(&pdfsIn);
-      // Clean up
-      for (int i_item = 1; i_item <= num_items; i_item++)
-        delete[] item_timestep_dataf[i_item - 1];
-      delete[] item_timestep_dataf;
     }
 
 
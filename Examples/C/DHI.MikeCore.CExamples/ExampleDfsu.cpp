@@ -2,6 +2,8 @@
 #include "eum.h"
 #include "dfsio.h"
 #include "Util.h"
+#include "DfsuUtil.h"
+#include "MeshExport.h"
 #include <CppUnitTest.h>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -14,38 +16,6 @@ namespace UnitestForC_MikeCore
   {
   public:
 
-    /**
-     * Geometry of mesh in DFSU file. For details, read the
-     * "DFS Flexible File Formats, DFSU 2D/3D, Vertical Profile/Column, and Mesh File, Technical Documentation"
-     * https://manuals.mikepoweredbydhi.help/2020/General/FM_FileSpecification.pdf
-     * available from the "MIKE SDK Documentation Index"
-     * https://manuals.mikepoweredbydhi.help/2020/MIKE_SDK.htm
-     */
-    struct MeshGeometry
-    {
-      MeshGeometry() = default;
-
-      int num_nodes = 0;                ///< Number of nodes
-      int num_elmts = 0;                ///< Number of elements
-      int dimension = 0;                ///< Dimension of the file 
-      int max_num_layers = 0;           ///< Maximum number of layers, vertical 
-      int num_sigma_layers = 0;         ///< Number of sigma layers, vertical
-
-      int num_conn = 0;                 ///< Size of elmt_conn array
-
-      int*    node_ids = nullptr;       ///< Node Id's
-      double* node_x = nullptr;         ///< X coordinates of nodes
-      double* node_y = nullptr;         ///< Y Coordinates of nodes
-      float*  node_z = nullptr;         ///< Z Coordinates of nodes
-      int*    node_codes = nullptr;     ///< Node boundary code
-
-      int*    elmt_ids = nullptr;       ///< Element Id's
-      int*    elmt_types = nullptr;     ///< Element Type
-      int*    elmt_num_nodes = nullptr; ///< Number of nodes in each element
-      int*    elmt_conn = nullptr;      ///< Indices of nodes in each element
-    };
-
-
     /**
      * Reads the file OresundHD.dfsu and create a gnuplot input file plotting the geometry 
      */
@@ -206,7 +176,7 @@ namespace UnitestForC_MikeCore
       }
 
       // Clean up
-      Cleanup(&mesh);
+      CleanupMeshGeometry(&mesh);
       for (int i_item = 1; i_item <= num_items; i_item++)
       {
         delete[] item_timestep_dataf[i_item - 1];
@@ -292,14 +262,7 @@ namespace UnitestForC_MikeCore
       /***********************************
        * Write dynamic item-timestep data, copy from source file
        ***********************************/
-      // All items are element based, so reuse elmtData array for all items
-      float* item_timestep_dataf[3];
-      float* elmtData = new float[mesh.num_elmts];
-      item_timestep_dataf[0] = elmtData;
-      item_timestep_dataf[1] = elmtData;
-      item_timestep_dataf[2] = elmtData;
-
-      CopyDfsTemporalData(pdfsIn, fpIn, pdfsWr, fpWr, item_timestep_dataf, 13, 3);
+      CopyDfsTemporalData(pdfsIn, fpIn, pdfsWr, fpWr, 13, 3);
 
       /***********************************
        * Close file and destroy header
@@ -308,109 +271,14 @@ namespace UnitestForC_MikeCore
       rc = dfsHeaderDestroy(&pdfsWr);   CheckRc(rc, "Error destroying header");
       rc = dfsFileClose(pdfsIn, &fpIn); CheckRc(rc, "Error closing file");
       rc = dfsHeaderDestroy(&pdfsIn);   CheckRc(rc, "Error destroying header");
-      Cleanup(&mesh);
-      delete[] elmtData;
+      CleanupMeshGeometry(&mesh);
 
     }
 
-    /**
-     * Read Geometry from DFSU file:
-     * Mesh sizes are read from custom block "MIKE_FM"
-     * Mesh definition are read from static items
-     */
-    static void ReadDfsuGeometry(LPHEAD pdfs, LPFILE fp, MeshGeometry* mesh)
-    {
-      // Get reference to the first custom block
-      LPBLOCK customblock_ptr;
-      long rc = dfsGetCustomBlockRef(pdfs, &customblock_ptr);
-      CheckRc(rc, "Error reading custom block");
-      // Search for "MIKE_FM" custom block containing int data
-      while (customblock_ptr)
-      {
-        SimpleType csdata_type;      // Type of data stored in custom block
-        LPCTSTR name;                // Name of custom block
-        LONG size;                   // Number of values in custom block
-        void* customblock_data_ptr;  // custom block data, updated with every call below to next custom block
-        rc = dfsGetCustomBlock(customblock_ptr, &csdata_type, &name,
-                               &size, &customblock_data_ptr, &customblock_ptr);
-        CheckRc(rc, "Error reading custom block");
-        if (0 == strcmp(name, "MIKE_FM") && csdata_type == UFS_INT)
-        {
-          int* intData         = (int*)customblock_data_ptr;
-          mesh->num_nodes      = intData[0];
-          mesh->num_elmts      = intData[1];
-          mesh->dimension      = intData[2];
-          mesh->max_num_layers = intData[3];
-          if (size < 5)
-            mesh->num_sigma_layers = mesh->max_num_layers;
-          else
-            mesh->num_sigma_layers = intData[4];
-          break;
-        }
-      }
-      if (mesh->num_nodes < 0)
-      {
-        Logger::WriteMessage("Error in Geometry definition: Could not find custom block \"MIKE_FM\"\n");
-        exit(-1);
-      }
-      if (mesh->dimension != 2 || mesh->max_num_layers > 0 || mesh->num_sigma_layers > 0)
-      {
-        Logger::WriteMessage("This tool currently only supports standard 2D (horizontal) dfsu files\n");
-        exit(-1);
-      }
-
-      // Read mesh geometry from static items in DFSU file
-      mesh->node_ids       = (int*)    ReadDfsStaticItem(fp, pdfs, "Node id", UFS_INT);
-      mesh->node_x         = (double*) ReadDfsStaticItem(fp, pdfs, "X-coord", UFS_DOUBLE);
-      mesh->node_y         = (double*) ReadDfsStaticItem(fp, pdfs, "Y-coord", UFS_DOUBLE);
-      mesh->node_z         = (float*)  ReadDfsStaticItem(fp, pdfs, "Z-coord", UFS_FLOAT);
-      mesh->node_codes     = (int*)    ReadDfsStaticItem(fp, pdfs, "Code", UFS_INT);
-
-      mesh->elmt_ids       = (int*)    ReadDfsStaticItem(fp, pdfs, "Element id", UFS_INT);
-      mesh->elmt_types     = (int*)    ReadDfsStaticItem(fp, pdfs, "Element type", UFS_INT);
-      mesh->elmt_num_nodes = (int*)    ReadDfsStaticItem(fp, pdfs, "No of nodes", UFS_INT);
-      mesh->elmt_conn      = (int*)    ReadDfsStaticItem(fp, pdfs, "Connectivity", UFS_INT, &(mesh->num_conn));
-    }
-
-    /**
-     * Write Geometry to DFSU file:
-     * Mesh sizes are written to custom block "MIKE_FM"
-     */
-    static void WriteDfsuGeometryHeader(LPHEAD pdfs, MeshGeometry* mesh)
-    {
-      int custblock_data[5];
-      custblock_data[0] = mesh->num_nodes;
-      custblock_data[1] = mesh->num_elmts;
-      custblock_data[2] = mesh->dimension;
-      custblock_data[3] = mesh->max_num_layers;
-      custblock_data[4] = mesh->num_sigma_layers;
-      long rc = dfsAddCustomBlock(pdfs, UFS_INT, "MIKE_FM", 5, custblock_data);
-      CheckRc(rc, "Error adding MIKE_FM Custom block");
-    }
-
-    /**
-     * Write Geometry to DFSU file:
-     * Mesh definition are written to static items
-     */
-    static void WriteDfsuGeometryStatic(LPHEAD pdfs, LPFILE fp, MeshGeometry* mesh)
-    {
-      // Write mesh geometry from static items in DFSU file
-      WriteDfsStaticItem(fp, pdfs, "Node id"     , UFS_INT   , mesh->num_nodes, mesh->node_ids      );
-      WriteDfsStaticItem(fp, pdfs, "X-coord"     , UFS_DOUBLE, mesh->num_nodes, mesh->node_x        );
-      WriteDfsStaticItem(fp, pdfs, "Y-coord"     , UFS_DOUBLE, mesh->num_nodes, mesh->node_y        );
-      WriteDfsStaticItem(fp, pdfs, "Z-coord"     , UFS_FLOAT , mesh->num_nodes, mesh->node_z        );
-      WriteDfsStaticItem(fp, pdfs, "Code"        , UFS_INT   , mesh->num_nodes, mesh->node_codes    );
-
-      WriteDfsStaticItem(fp, pdfs, "Element id"  , UFS_INT   , mesh->num_elmts, mesh->elmt_ids      );
-      WriteDfsStaticItem(fp, pdfs, "Element type", UFS_INT   , mesh->num_elmts, mesh->elmt_types    );
-      WriteDfsStaticItem(fp, pdfs, "No of nodes" , UFS_INT   , mesh->num_elmts, mesh->elmt_num_nodes);
-      WriteDfsStaticItem(fp, pdfs, "Connectivity", UFS_INT   , mesh->num_conn,  mesh->elmt_conn     );
-    }
-
-
     /***
-     * Example of how to navigate the Geometry of a DFSU file.
-     * This method writes the DFSU mesh to a text file in a gnuplot compatible format
+     * Example of how to export the Geometry of a DFSU file.
+     * This method writes the DFSU mesh to a text file in a gnuplot compatible format.
+     * See FormatElement in MeshExport.cpp for how to navigate the geometry.
      */
     static void MakeGnuPlotFile(LPCTSTR inputFullPath, MeshGeometry mesh)
     {
@@ -424,53 +292,10 @@ namespace UnitestForC_MikeCore
       strcpy(filename_gnuplot, inputFullPath);
       strcpy(&filename_gnuplot[fnLen], ".gplot.txt");
 
-      FILE *fgp_ptr = fopen(filename_gnuplot, "w");
-      fprintf(fgp_ptr, "# The content of this file can be plotted in gnuplot with one or more of the following commands:\n");
-      fprintf(fgp_ptr, "# set size ratio -1\n");
-      fprintf(fgp_ptr, "# plot \"filename.dfsu.gplot.txt\" with lines lc rgb 'black' title \"mesh\"\n");
-      fprintf(fgp_ptr, "# \n");
-      fprintf(fgp_ptr, "# The file contains coordinates for a closed polygon, for each element in the 2D dfsu file\n");
-      fprintf(fgp_ptr, "# X Y\n");
-      fprintf(fgp_ptr, "# \n");
-
-      int curr_elmt_conn_index = 0;
-      int nodeIndex;
-      // Loop over all elements
-      for (int i = 0; i < mesh.num_elmts; i++)
-      {
-        fprintf(fgp_ptr, "# Element %6d, id = %6d\n", i + 1, mesh.elmt_ids[i]);
-        int num_nodes_in_elmt = mesh.elmt_num_nodes[i];
-        // Loop over all nodes in element, print out node coordinate for all nodes in the element
-        for (int j = 0; j < num_nodes_in_elmt; j++)
-        {
-          // Lookup nodes of element in connectivity table (elmt_conn).
-          // The elmt_conn is 1-based, so subtract 1 to get zero-based indices
-          nodeIndex = mesh.elmt_conn[curr_elmt_conn_index + j] - 1;
-          fprintf(fgp_ptr, "%f %f\n", mesh.node_x[nodeIndex], mesh.node_y[nodeIndex]);
-        }
-        // Print out the first element-node coordinate again, to close the polygon
-        nodeIndex = mesh.elmt_conn[curr_elmt_conn_index] - 1;
-        fprintf(fgp_ptr, "%f %f\n", mesh.node_x[nodeIndex], mesh.node_y[nodeIndex]);
-        // Empty line to tell gnuplot that a new polygon is coming
-        fprintf(fgp_ptr, "\n");
-        // Prepare for next element
-        curr_elmt_conn_index += num_nodes_in_elmt;
-      }
-
-      fclose(fgp_ptr);
-    }
-
-    static void Cleanup(MeshGeometry* mesh)
-    {
-      free(mesh->node_ids);
-      free(mesh->node_x);
-      free(mesh->node_y);
-      free(mesh->node_z);
-      free(mesh->node_codes);
-      free(mesh->elmt_ids);
-      free(mesh->elmt_types);
-      free(mesh->elmt_num_nodes);
-      free(mesh->elmt_conn);
+      // Write closed polygon of each element, formatted in parallel chunks
+      MeshExportOptions options;
+      options.format = MeshExportGnuplot;
+      ExportMesh(filename_gnuplot, mesh, options);
     }
 
   };
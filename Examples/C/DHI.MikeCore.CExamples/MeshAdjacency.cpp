@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "MeshAdjacency.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+#include <thread>
+
+
+/** Face of an element, as collected before sorting */
+struct MeshFaceRecord
+{
+  uint64_t key;          ///< Smallest node number in the high bits, largest in the low bits
+  int      elmt;         ///< Element of the face
+  int      conn_index;   ///< Index in elmt_conn of the from node of the face
+};
+
+/** Run func(t) on num_threads threads, t being the thread number */
+static void RunThreads(int num_threads, const std::function<void(int t)>& func)
+{
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++)
+    threads.emplace_back(func, t);
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
+/** Part t of num_parts parts of the range 0 to n */
+static inline int PartBegin(int n, int t, int num_parts)
+{
+  return (int)((long long)n * t / num_parts);
+}
+
+/** Boundary code of a face from the codes of its nodes, see BuildMeshAdjacency */
+static inline int FaceCode(int code1, int code2)
+{
+  if (code1 == code2 || code2 == 0)
+    return code1;
+  if (code1 == 0)
+    return code2;
+  return std::min(code1, code2);
+}
+
+void BuildMeshAdjacency(const MeshGeometry& mesh, MeshAdjacency* adj, int num_threads)
+{
+  if (num_threads < 1)
+    num_threads = (int)std::thread::hardware_concurrency();
+  if (num_threads > mesh.num_elmts)
+    num_threads = mesh.num_elmts;
+  if (num_threads < 1)
+    num_threads = 1;
+  const int T = num_threads;
+  const int* conn = mesh.elmt_conn;
+
+  std::vector<int> conn_offsets(mesh.num_elmts + 1, 0);
+  for (int i_elmt = 0; i_elmt < mesh.num_elmts; i_elmt++)
+    conn_offsets[i_elmt + 1] = conn_offsets[i_elmt] + mesh.elmt_num_nodes[i_elmt];
+
+  // Faces of element i_elmt, as func(conn_index, key, part), part being from the smallest node number
+  auto for_each_face = [&](int i_elmt, auto&& func)
+  {
+    int first = conn_offsets[i_elmt];
+    int num_nodes = mesh.elmt_num_nodes[i_elmt];
+    for (int j = 0; j < num_nodes; j++)
+    {
+      uint32_t a = conn[first + j];
+      uint32_t b = conn[first + (j + 1) % num_nodes];
+      uint32_t n1 = std::min(a, b);
+      int part = (int)((long long)(n1 - 1) * T / mesh.num_nodes);
+      func(first + j, ((uint64_t)n1 << 32) | std::max(a, b), part);
+    }
+  };
+
+  // Count the faces of each part, per thread, and the position of each thread in each part
+  std::vector<size_t> counts(T * T, 0);
+  RunThreads(T, [&](int t)
+  {
+    for (int i_elmt = PartBegin(mesh.num_elmts, t, T); i_elmt < PartBegin(mesh.num_elmts, t + 1, T); i_elmt++)
+      for_each_face(i_elmt, [&](int, uint64_t, int part) { counts[t * T + part]++; });
+  });
+  std::vector<size_t> positions(T * T);
+  std::vector<size_t> part_offsets(T + 1, 0);
+  for (int part = 0; part < T; part++)
+  {
+    part_offsets[part + 1] = part_offsets[part];
+    for (int t = 0; t < T; t++)
+    {
+      positions[t * T + part] = part_offsets[part + 1];
+      part_offsets[part + 1] += counts[t * T + part];
+    }
+  }
+
+  // Collect faces into their part, and sort each part
+  std::vector<MeshFaceRecord> faces(mesh.num_conn);
+  RunThreads(T, [&](int t)
+  {
+    for (int i_elmt = PartBegin(mesh.num_elmts, t, T); i_elmt < PartBegin(mesh.num_elmts, t + 1, T); i_elmt++)
+    {
+      for_each_face(i_elmt, [&](int conn_index, uint64_t key, int part)
+      {
+        faces[positions[t * T + part]++] = MeshFaceRecord{ key, i_elmt, conn_index };
+      });
+    }
+  });
+  std::vector<int> part_faces(T + 1, 0);
+  RunThreads(T, [&](int part)
+  {
+    auto begin = faces.begin() + part_offsets[part];
+    auto end = faces.begin() + part_offsets[part + 1];
+    std::sort(begin, end, [](const MeshFaceRecord& f1, const MeshFaceRecord& f2)
+    {
+      return f1.key < f2.key || (f1.key == f2.key && f1.elmt < f2.elmt);
+    });
+    int num_faces = 0;
+    for (auto it = begin; it != end; ++it)
+      if (it == begin || it->key != (it - 1)->key)
+        num_faces++;
+    part_faces[part + 1] = num_faces;
+  });
+  for (int part = 0; part < T; part++)
+    part_faces[part + 1] += part_faces[part];
+
+  // Number the faces, the first element of a face, lowest element number, being the left element
+  adj->num_faces = part_faces[T];
+  adj->face_nodes.resize(2 * (size_t)adj->num_faces);
+  adj->face_elmts.resize(2 * (size_t)adj->num_faces);
+  adj->face_codes.resize(adj->num_faces);
+  adj->elmt_faces.resize(mesh.num_conn);
+  RunThreads(T, [&](int part)
+  {
+    int i_face = part_faces[part] - 1;
+    for (size_t i = part_offsets[part]; i < part_offsets[part + 1]; i++)
+    {
+      const MeshFaceRecord& face = faces[i];
+      if (i == part_offsets[part] || face.key != faces[i - 1].key)
+      {
+        i_face++;
+        int first = conn_offsets[face.elmt];
+        int next = first + (face.conn_index - first + 1) % mesh.elmt_num_nodes[face.elmt];
+        adj->face_nodes[2 * i_face] = conn[face.conn_index] - 1;
+        adj->face_nodes[2 * i_face + 1] = conn[next] - 1;
+        adj->face_elmts[2 * i_face] = face.elmt;
+        adj->face_elmts[2 * i_face + 1] = -1;
+      }
+      else
+        adj->face_elmts[2 * i_face + 1] = face.elmt;
+      adj->elmt_faces[face.conn_index] = i_face;
+    }
+    for (i_face = part_faces[part]; i_face < part_faces[part + 1]; i_face++)
+    {
+      adj->face_codes[i_face] = adj->face_elmts[2 * i_face + 1] >= 0 ? 0 :
+        FaceCode(mesh.node_codes[adj->face_nodes[2 * i_face]], mesh.node_codes[adj->face_nodes[2 * i_face + 1]]);
+    }
+  });
+
+  adj->boundary_faces.clear();
+  for (int i_face = 0; i_face < adj->num_faces; i_face++)
+    if (adj->face_elmts[2 * i_face + 1] < 0)
+      adj->boundary_faces.push_back(i_face);
+
+  // Element neighbours: The other element of each inner face of an element
+  auto other_elmt = [&](int i_elmt, int i_face)
+  {
+    return adj->face_elmts[2 * i_face] == i_elmt ? adj->face_elmts[2 * i_face + 1] : adj->face_elmts[2 * i_face];
+  };
+  adj->nbr_offsets.assign(mesh.num_elmts + 1, 0);
+  RunThreads(T, [&](int t)
+  {
+    for (int i_elmt = PartBegin(mesh.num_elmts, t, T); i_elmt < PartBegin(mesh.num_elmts, t + 1, T); i_elmt++)
+      for (int k = conn_offsets[i_elmt]; k < conn_offsets[i_elmt + 1]; k++)
+        if (other_elmt(i_elmt, adj->elmt_faces[k]) >= 0)
+          adj->nbr_offsets[i_elmt + 1]++;
+  });
+  for (int i_elmt = 0; i_elmt < mesh.num_elmts; i_elmt++)
+    adj->nbr_offsets[i_elmt + 1] += adj->nbr_offsets[i_elmt];
+  adj->nbrs.resize(adj->nbr_offsets[mesh.num_elmts]);
+  RunThreads(T, [&](int t)
+  {
+    for (int i_elmt = PartBegin(mesh.num_elmts, t, T); i_elmt < PartBegin(mesh.num_elmts, t + 1, T); i_elmt++)
+    {
+      int pos = adj->nbr_offsets[i_elmt];
+      for (int k = conn_offsets[i_elmt]; k < conn_offsets[i_elmt + 1]; k++)
+      {
+        int nbr = other_elmt(i_elmt, adj->elmt_faces[k]);
+        if (nbr >= 0)
+          adj->nbrs[pos++] = nbr;
+      }
+    }
+  });
+}
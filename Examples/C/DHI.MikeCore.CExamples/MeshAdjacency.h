@@ -0,0 +1,50 @@
+#pragma once
+
+#include "pch.h"
+#include "DfsuUtil.h"
+
+#include <vector>
+
+/**
+ * Face table and element neighbours of a 2D mesh of triangles and quadrilaterals.
+ *
+ * A face is the edge between two consecutive nodes of an element. Inner faces are shared
+ * by two elements, boundary faces belong to one element only. Faces are found by sorting
+ * the faces of all elements by their node numbers, such that the two elements of an inner
+ * face are next to each other, instead of looking up faces in a hash map.
+ *
+ * The faces are partitioned by their smallest node number, and each part is collected,
+ * sorted and numbered on a thread of its own, for meshes of millions of elements.
+ *
+ *   MeshAdjacency adj;
+ *   BuildMeshAdjacency(mesh, &adj);
+ *   for (int k = adj.nbr_offsets[i_elmt]; k < adj.nbr_offsets[i_elmt + 1]; k++)
+ *     int neighbour = adj.nbrs[k];
+ *
+ * All indices are zero based. The mesh is assumed valid, i.e. no face is shared by more
+ * than two elements.
+ */
+struct MeshAdjacency
+{
+  int num_faces = 0;
+
+  std::vector<int> face_nodes;       ///< From and to node of each face, 2 per face, the from-to direction of the left element
+  std::vector<int> face_elmts;       ///< Left and right element of each face, 2 per face, right being -1 for boundary faces
+  std::vector<int> face_codes;       ///< Boundary code of each face from node_codes, 0 for inner faces
+
+  std::vector<int> elmt_faces;       ///< Face between node j and j+1 of each element, same layout as elmt_conn
+  std::vector<int> nbr_offsets;      ///< Neighbours of element e are nbrs[nbr_offsets[e]] to nbrs[nbr_offsets[e+1]-1]
+  std::vector<int> nbrs;             ///< Neighbour elements, in the order of the faces of each element
+
+  std::vector<int> boundary_faces;   ///< Boundary faces, increasing
+};
+
+/**
+ * Build the face table and element neighbours of mesh, using num_threads threads,
+ * 0 for one per hardware thread.
+ *
+ * The code of a boundary face is the code of its nodes when they are equal, otherwise
+ * the smallest non-zero code of the two, such that a face from a land node (code 1) to
+ * the end node of an open boundary is a land face.
+ */
+void BuildMeshAdjacency(const MeshGeometry& mesh, MeshAdjacency* adj, int num_threads = 0);
@@ -0,0 +1,101 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsuUtil.h"
+#include "MeshAdjacency.h"
+#include <CppUnitTest.h>
+
+#include <algorithm>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(MeshAdjacency_tests)
+  {
+  public:
+
+    /// Triangle and quadrilateral sharing one face, nodes 1-2-3 and 2-4-5-3
+    TEST_METHOD(MeshAdjacencySmallTest)
+    {
+      int    node_codes[] = { 1, 0, 1, 2, 2 };
+      int    elmt_num_nodes[] = { 3, 4 };
+      int    elmt_conn[] = { 1, 2, 3,  2, 4, 5, 3 };
+      MeshGeometry mesh;
+      mesh.num_nodes = 5;
+      mesh.num_elmts = 2;
+      mesh.num_conn = 7;
+      mesh.node_codes = node_codes;
+      mesh.elmt_num_nodes = elmt_num_nodes;
+      mesh.elmt_conn = elmt_conn;
+
+      MeshAdjacency adj;
+      BuildMeshAdjacency(mesh, &adj, 2);
+      Assert::AreEqual(6, adj.num_faces);
+      Assert::AreEqual((size_t)5, adj.boundary_faces.size());
+      Assert::IsTrue(std::vector<int>({ 0, 1, 2 }) == adj.nbr_offsets);
+      Assert::IsTrue(std::vector<int>({ 1, 0 }) == adj.nbrs);
+
+      // Face 2-3 is the inner face, from node 2 to 3 of the triangle, left of it
+      int inner = adj.elmt_faces[1];
+      Assert::AreEqual(inner, adj.elmt_faces[6]);
+      Assert::AreEqual(1, adj.face_nodes[2 * inner]);
+      Assert::AreEqual(2, adj.face_nodes[2 * inner + 1]);
+      Assert::AreEqual(0, adj.face_elmts[2 * inner]);
+      Assert::AreEqual(1, adj.face_elmts[2 * inner + 1]);
+      Assert::AreEqual(0, adj.face_codes[inner]);
+
+      // Boundary codes: 1-2 land (1), 4-5 open boundary (2), 5-3 land
+      Assert::AreEqual(1, adj.face_codes[adj.elmt_faces[0]]);
+      Assert::AreEqual(2, adj.face_codes[adj.elmt_faces[4]]);
+      Assert::AreEqual(1, adj.face_codes[adj.elmt_faces[5]]);
+      Assert::AreEqual(-1, adj.face_elmts[2 * adj.elmt_faces[5] + 1]);
+    }
+
+    /// Faces of OresundHD.dfsu are consistent, and the same for any number of threads
+    TEST_METHOD(MeshAdjacencyDfsuTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      MeshGeometry mesh;
+      ReadDfsuGeometry(pdfs, fp, &mesh);
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+
+      MeshAdjacency adj1, adj4;
+      BuildMeshAdjacency(mesh, &adj1, 1);
+      BuildMeshAdjacency(mesh, &adj4, 4);
+      Assert::IsTrue(adj1.face_elmts == adj4.face_elmts);
+      Assert::IsTrue(adj1.elmt_faces == adj4.elmt_faces);
+      Assert::IsTrue(adj1.nbrs == adj4.nbrs);
+
+      // Each inner face is counted by two elements, each boundary face by one
+      int num_boundary = (int)adj1.boundary_faces.size();
+      Assert::AreEqual(mesh.num_conn, 2 * adj1.num_faces - num_boundary);
+      Assert::AreEqual((size_t)(2 * (adj1.num_faces - num_boundary)), adj1.nbrs.size());
+      for (int i_face : adj1.boundary_faces)
+        Assert::IsTrue(adj1.face_codes[i_face] > 0);
+
+      // Neighbours are symmetric
+      for (int i_elmt = 0; i_elmt < mesh.num_elmts; i_elmt++)
+      {
+        for (int k = adj1.nbr_offsets[i_elmt]; k < adj1.nbr_offsets[i_elmt + 1]; k++)
+        {
+          int nbr = adj1.nbrs[k];
+          auto first = adj1.nbrs.begin() + adj1.nbr_offsets[nbr];
+          auto last = adj1.nbrs.begin() + adj1.nbr_offsets[nbr + 1];
+          Assert::IsTrue(std::find(first, last, i_elmt) != last);
+        }
+      }
+      CleanupMeshGeometry(&mesh);
+    }
+
+  };
+}
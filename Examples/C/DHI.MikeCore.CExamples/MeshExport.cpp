@@ -0,0 +1,334 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "MeshExport.h"
+
+#include <CppUnitTestLogger.h>
+#include <charconv>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+
+/** Upper bound on number of characters of one formatted number */
+static const size_t MaxNumberChars = 32;
+
+static inline char* FormatDouble(char* p, double v)
+{
+  return std::to_chars(p, p + MaxNumberChars, v).ptr;
+}
+
+static inline char* FormatFloat(char* p, float v)
+{
+  return std::to_chars(p, p + MaxNumberChars, v).ptr;
+}
+
+static inline char* FormatInt(char* p, int v)
+{
+  return std::to_chars(p, p + MaxNumberChars, v).ptr;
+}
+
+/** Format integer right-aligned in a field of the given width, as printf("%6d") */
+static inline char* FormatInt(char* p, int v, int width)
+{
+  char tmp[MaxNumberChars];
+  int len = (int)(std::to_chars(tmp, tmp + MaxNumberChars, v).ptr - tmp);
+  for (; len < width; width--)
+    *p++ = ' ';
+  memcpy(p, tmp, len);
+  return p + len;
+}
+
+static inline char* FormatString(char* p, const char* s)
+{
+  size_t len = strlen(s);
+  memcpy(p, s, len);
+  return p + len;
+}
+
+/** Format value of element, or the missing string for delete values */
+static inline char* FormatValue(char* p, const MeshExportOptions& options, int i_elmt, const char* missing)
+{
+  float v = options.elmt_values[i_elmt];
+  if (v == options.delete_value)
+    return FormatString(p, missing);
+  return FormatFloat(p, v);
+}
+
+/** Format one element, starting at index conn_index in the connectivity table */
+static char* FormatElement(char* p, const MeshGeometry& mesh, const MeshExportOptions& options, int i_elmt, int conn_index)
+{
+  int num_nodes_in_elmt = mesh.elmt_num_nodes[i_elmt];
+  const int* conn = &mesh.elmt_conn[conn_index];
+  int nodeIndex;
+  switch (options.format)
+  {
+  case MeshExportGnuplot:
+    p = FormatString(p, "# Element ");
+    p = FormatInt(p, i_elmt + 1, 6);
+    p = FormatString(p, ", id = ");
+    p = FormatInt(p, mesh.elmt_ids[i_elmt], 6);
+    *p++ = '\n';
+    // All nodes of element, and the first node again to close the polygon.
+    // The elmt_conn is 1-based, so subtract 1 to get zero-based indices
+    for (int j = 0; j <= num_nodes_in_elmt; j++)
+    {
+      nodeIndex = conn[j < num_nodes_in_elmt ? j : 0] - 1;
+      p = FormatDouble(p, mesh.node_x[nodeIndex]);
+      *p++ = ' ';
+      p = FormatDouble(p, mesh.node_y[nodeIndex]);
+      if (options.elmt_values)
+      {
+        *p++ = ' ';
+        p = FormatValue(p, options, i_elmt, "NaN");
+      }
+      *p++ = '\n';
+    }
+    // Empty line to tell gnuplot that a new polygon is coming
+    *p++ = '\n';
+    break;
+  case MeshExportCsv:
+    for (int j = 0; j < num_nodes_in_elmt; j++)
+    {
+      nodeIndex = conn[j] - 1;
+      p = FormatInt(p, mesh.elmt_ids[i_elmt]);
+      *p++ = ',';
+      p = FormatInt(p, j + 1);
+      *p++ = ',';
+      p = FormatDouble(p, mesh.node_x[nodeIndex]);
+      *p++ = ',';
+      p = FormatDouble(p, mesh.node_y[nodeIndex]);
+      if (options.elmt_values)
+      {
+        *p++ = ',';
+        p = FormatValue(p, options, i_elmt, "");
+      }
+      *p++ = '\n';
+    }
+    break;
+  case MeshExportWkt:
+    p = FormatInt(p, mesh.elmt_ids[i_elmt]);
+    p = FormatString(p, ";POLYGON ((");
+    for (int j = 0; j <= num_nodes_in_elmt; j++)
+    {
+      nodeIndex = conn[j < num_nodes_in_elmt ? j : 0] - 1;
+      if (j > 0)
+        p = FormatString(p, ", ");
+      p = FormatDouble(p, mesh.node_x[nodeIndex]);
+      *p++ = ' ';
+      p = FormatDouble(p, mesh.node_y[nodeIndex]);
+    }
+    p = FormatString(p, "))");
+    if (options.elmt_values)
+    {
+      *p++ = ';';
+      p = FormatValue(p, options, i_elmt, "");
+    }
+    *p++ = '\n';
+    break;
+  default:
+    break;
+  }
+  return p;
+}
+
+/**
+ * Format elements [first_elmt, end_elmt) into buffer, growing the buffer
+ * to an upper bound of the formatted size. Returns number of characters.
+ */
+static size_t FormatChunk(std::vector<char>& buffer, const MeshGeometry& mesh, const MeshExportOptions& options,
+                          int first_elmt, int end_elmt, int conn_index)
+{
+  // Each node line holds at most 4 numbers and separators, plus an element line and the closing node
+  size_t max_size = 0;
+  for (int i = first_elmt; i < end_elmt; i++)
+    max_size += (mesh.elmt_num_nodes[i] + 2) * 4 * (MaxNumberChars + 2);
+  if (buffer.size() < max_size)
+    buffer.resize(max_size);
+
+  char* p = buffer.data();
+  for (int i = first_elmt; i < end_elmt; i++)
+  {
+    p = FormatElement(p, mesh, options, i, conn_index);
+    conn_index += mesh.elmt_num_nodes[i];
+  }
+  return p - buffer.data();
+}
+
+static long ExportMeshText(FILE* fp, const MeshGeometry& mesh, const MeshExportOptions& options)
+{
+  switch (options.format)
+  {
+  case MeshExportGnuplot:
+    fprintf(fp, "# The content of this file can be plotted in gnuplot with one or more of the following commands:\n");
+    fprintf(fp, "# set size ratio -1\n");
+    fprintf(fp, "# plot \"filename.dfsu.gplot.txt\" with lines lc rgb 'black' title \"mesh\"\n");
+    fprintf(fp, "# \n");
+    fprintf(fp, "# The file contains coordinates for a closed polygon, for each element in the 2D dfsu file\n");
+    fprintf(fp, options.elmt_values ? "# X Y %s\n" : "# X Y\n", options.value_name);
+    fprintf(fp, "# \n");
+    break;
+  case MeshExportCsv:
+    fprintf(fp, options.elmt_values ? "element_id,node,x,y,%s\n" : "element_id,node,x,y\n", options.value_name);
+    break;
+  case MeshExportWkt:
+    fprintf(fp, options.elmt_values ? "element_id;wkt;%s\n" : "element_id;wkt\n", options.value_name);
+    break;
+  default:
+    break;
+  }
+
+  int chunk_elmts = options.chunk_elmts > 0 ? options.chunk_elmts : 16384;
+  int num_chunks = (mesh.num_elmts + chunk_elmts - 1) / chunk_elmts;
+  int num_threads = options.num_threads > 0 ? options.num_threads : (int)std::thread::hardware_concurrency();
+  if (num_threads < 1)
+    num_threads = 1;
+  if (num_threads > num_chunks)
+    num_threads = num_chunks > 0 ? num_chunks : 1;
+
+  // Connectivity index of first element in each chunk
+  std::vector<int> chunk_conn(num_chunks + 1);
+  int conn_index = 0;
+  for (int i = 0; i < mesh.num_elmts; i++)
+  {
+    if (i % chunk_elmts == 0)
+      chunk_conn[i / chunk_elmts] = conn_index;
+    conn_index += mesh.elmt_num_nodes[i];
+  }
+
+  // Format num_threads chunks at a time, and write them in order
+  std::vector<std::vector<char>> buffers(num_threads);
+  std::vector<size_t> lengths(num_threads);
+  for (int first_chunk = 0; first_chunk < num_chunks; first_chunk += num_threads)
+  {
+    int n = num_chunks - first_chunk < num_threads ? num_chunks - first_chunk : num_threads;
+    auto format = [&](int t)
+    {
+      int chunk = first_chunk + t;
+      int end_elmt = (chunk + 1) * chunk_elmts < mesh.num_elmts ? (chunk + 1) * chunk_elmts : mesh.num_elmts;
+      lengths[t] = FormatChunk(buffers[t], mesh, options, chunk * chunk_elmts, end_elmt, chunk_conn[chunk]);
+    };
+    if (n == 1)
+      format(0);
+    else
+    {
+      std::vector<std::thread> threads;
+      for (int t = 0; t < n; t++)
+        threads.emplace_back(format, t);
+      for (int t = 0; t < n; t++)
+        threads[t].join();
+    }
+    for (int t = 0; t < n; t++)
+    {
+      if (fwrite(buffers[t].data(), 1, lengths[t], fp) != lengths[t])
+        return -1;
+    }
+  }
+  return F_NO_ERROR;
+}
+
+static long ExportMeshBinary(FILE* fp, const MeshGeometry& mesh, const MeshExportOptions& options)
+{
+  int32_t header[4] = { mesh.num_nodes, mesh.num_elmts, mesh.num_conn, options.elmt_values ? 1 : 0 };
+  bool ok = fwrite("MESHBIN1", 1, 8, fp) == 8 &&
+            fwrite(header, sizeof(int32_t), 4, fp) == 4 &&
+            fwrite(mesh.node_x, sizeof(double), mesh.num_nodes, fp) == (size_t)mesh.num_nodes &&
+            fwrite(mesh.node_y, sizeof(double), mesh.num_nodes, fp) == (size_t)mesh.num_nodes &&
+            fwrite(mesh.elmt_ids, sizeof(int32_t), mesh.num_elmts, fp) == (size_t)mesh.num_elmts &&
+            fwrite(mesh.elmt_num_nodes, sizeof(int32_t), mesh.num_elmts, fp) == (size_t)mesh.num_elmts;
+
+  // Connectivity is stored zero based, convert in blocks
+  std::vector<int32_t> conn(65536);
+  for (int i = 0; i < mesh.num_conn && ok; i += (int)conn.size())
+  {
+    int n = mesh.num_conn - i < (int)conn.size() ? mesh.num_conn - i : (int)conn.size();
+    for (int j = 0; j < n; j++)
+      conn[j] = mesh.elmt_conn[i + j] - 1;
+    ok = fwrite(conn.data(), sizeof(int32_t), n, fp) == (size_t)n;
+  }
+
+  if (ok && options.elmt_values)
+    ok = fwrite(options.elmt_values, sizeof(float), mesh.num_elmts, fp) == (size_t)mesh.num_elmts;
+  return ok ? F_NO_ERROR : -1;
+}
+
+long ExportMesh(LPCTSTR filename, const MeshGeometry& mesh, const MeshExportOptions& options)
+{
+  bool binary = options.format == MeshExportBinary;
+  FILE* fp = fopen(filename, binary ? "wb" : "w");
+  if (!fp)
+  {
+    LOG("Could not open file for writing: %s", filename);
+    return -1;
+  }
+  // Large stdio buffer, formatted chunks are written in few large writes
+  setvbuf(fp, nullptr, _IOFBF, 1 << 20);
+
+  long rc = binary ? ExportMeshBinary(fp, mesh, options) : ExportMeshText(fp, mesh, options);
+  if (fclose(fp) != 0)
+    rc = -1;
+  if (rc != F_NO_ERROR)
+    LOG("Error writing file: %s", filename);
+  return rc;
+}
+
+long ExportDfsuMesh(LPCTSTR dfsuFilename, LPCTSTR outFilename, MeshExportFormat format, int item_number, long tstep)
+{
+  LPHEAD pdfs;
+  LPFILE fp;
+  long rc = dfsFileRead(dfsuFilename, &pdfs, &fp);
+  CheckRc(rc, "Error opening file");
+
+  MeshGeometry mesh;
+  ReadDfsuGeometry(pdfs, fp, &mesh);
+
+  MeshExportOptions options;
+  options.format = format;
+  std::vector<float> values;
+  LPCTSTR item_name = nullptr;
+  if (item_number > 0)
+  {
+    if (item_number > dfsGetNoOfItems(pdfs) || dfsGetItemElements(dfsItemD(pdfs, item_number)) != mesh.num_elmts)
+    {
+      LOG("Item %d is not an element item: %s", item_number, dfsuFilename);
+      rc = -1;
+    }
+    else
+    {
+      LONG          item_type;
+      LPCTSTR       item_type_str;
+      LONG          item_unit;
+      LPCTSTR       item_unit_str;
+      SimpleType    item_datatype;
+      rc = dfsGetItemInfo(dfsItemD(pdfs, item_number), &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
+      CheckRc(rc, "Error reading dynamic item info");
+      if (item_datatype != UFS_FLOAT)
+      {
+        LOG("Item %d is not a float item: %s", item_number, dfsuFilename);
+        rc = -1;
+      }
+    }
+    if (rc == F_NO_ERROR)
+    {
+      values.resize(mesh.num_elmts);
+      double time;
+      rc = dfsFindItemDynamic(pdfs, fp, tstep, item_number);
+      CheckRc(rc, "Error finding item-timestep");
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, values.data());
+      CheckRc(rc, "Error reading dynamic item data");
+      options.elmt_values = values.data();
+      options.value_name = item_name;
+      options.delete_value = dfsGetDeleteValFloat(pdfs);
+    }
+  }
+
+  if (rc == F_NO_ERROR)
+    rc = ExportMesh(outFilename, mesh, options);
+
+  CleanupMeshGeometry(&mesh);
+  dfsFileClose(pdfs, &fp);
+  dfsHeaderDestroy(&pdfs);
+  return rc;
+}
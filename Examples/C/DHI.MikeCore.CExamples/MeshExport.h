@@ -0,0 +1,49 @@
+#pragma once
+
+#include "pch.h"
+#include "DfsuUtil.h"
+
+/** Output formats of ExportMesh */
+enum MeshExportFormat
+{
+  MeshExportGnuplot,  ///< Closed polygon per element, "x y [value]" lines, empty line between elements
+  MeshExportCsv,      ///< One row per element node: "element_id,node,x,y[,value]"
+  MeshExportWkt,      ///< One row per element: "element_id;POLYGON ((x y, ...))[;value]"
+  MeshExportBinary,   ///< Little-endian vertex/index dump, see ExportMesh
+};
+
+struct MeshExportOptions
+{
+  MeshExportFormat format = MeshExportGnuplot;
+  const float* elmt_values = nullptr;   ///< Optional value for each element, e.g. an item-timestep of a dfsu file
+  LPCTSTR      value_name = "value";    ///< Name of value column in CSV and WKT header
+  float        delete_value = 1e-35f;   ///< Values equal to this are written as missing
+  int          num_threads = 0;         ///< Number of formatting threads, 0 for one per hardware thread
+  int          chunk_elmts = 16384;     ///< Number of elements formatted as one chunk by one thread
+};
+
+/**
+ * Export the element polygons of a 2D mesh, and optionally a value for each element, to a file.
+ *
+ * Coordinates and values are written with the shortest representation that reads back
+ * to the same double/float value. Elements are formatted in chunks in parallel, each chunk
+ * into its own preallocated buffer, and chunks are written to the file in element order.
+ *
+ * The binary format is, all little-endian:
+ *   char[8] "MESHBIN1", int32 num_nodes, int32 num_elmts, int32 num_conn, int32 has_values,
+ *   double x[num_nodes], double y[num_nodes], int32 elmt_ids[num_elmts],
+ *   int32 elmt_num_nodes[num_elmts], int32 elmt_conn[num_conn] (zero based),
+ *   float values[num_elmts] (only if has_values).
+ *
+ * Returns F_NO_ERROR on success, or -1 if the file could not be written.
+ */
+long ExportMesh(LPCTSTR filename, const MeshGeometry& mesh, const MeshExportOptions& options);
+
+/**
+ * Export the mesh of a 2D dfsu file. If item_number is larger than 0, the values of
+ * that item at time step tstep (zero based) are exported as element values. The item
+ * must be a float item.
+ *
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long ExportDfsuMesh(LPCTSTR dfsuFilename, LPCTSTR outFilename, MeshExportFormat format, int item_number = 0, long tstep = 0);
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsuUtil.h"
+#include "MeshExport.h"
+#include <CppUnitTest.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(MeshExport_tests)
+  {
+  public:
+
+    /// Export OresundHD.dfsu mesh in all formats, and check that coordinates read back exactly
+    TEST_METHOD(ExportDfsuMeshTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      MeshGeometry mesh;
+      ReadDfsuGeometry(pdfs, fp, &mesh);
+      std::vector<float> values(mesh.num_elmts);
+      double time;
+      rc = dfsFindItemDynamic(pdfs, fp, 0, 1);
+      CheckRc(rc, "Error finding item-timestep");
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, values.data());
+      CheckRc(rc, "Error reading item-timestep");
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+
+      MeshExportOptions options;
+      options.elmt_values = values.data();
+
+      // Formatting in one chunk and in many small parallel chunks must give the same file
+      char gplot1FullPath[_MAX_PATH];
+      snprintf(gplot1FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cexport1.gplot.txt");
+      char gplot2FullPath[_MAX_PATH];
+      snprintf(gplot2FullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cexport2.gplot.txt");
+      options.format = MeshExportGnuplot;
+      options.num_threads = 1;
+      options.chunk_elmts = mesh.num_elmts;
+      Assert::AreEqual((long)F_NO_ERROR, ExportMesh(gplot1FullPath, mesh, options));
+      options.num_threads = 4;
+      options.chunk_elmts = 100;
+      Assert::AreEqual((long)F_NO_ERROR, ExportMesh(gplot2FullPath, mesh, options));
+      Assert::IsTrue(ReadFile(gplot1FullPath) == ReadFile(gplot2FullPath));
+
+      // CSV: one row per element node, coordinates read back exactly
+      char csvFullPath[_MAX_PATH];
+      snprintf(csvFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cexport.csv");
+      options.format = MeshExportCsv;
+      Assert::AreEqual((long)F_NO_ERROR, ExportMesh(csvFullPath, mesh, options));
+      std::string csv = ReadFile(csvFullPath);
+      Assert::AreEqual(mesh.num_conn + 1, CountLines(csv));
+      const char* row = strchr(csv.c_str(), '\n') + 1;
+      char* end;
+      Assert::AreEqual(mesh.elmt_ids[0], (int)strtol(row, &end, 10));
+      Assert::AreEqual(1, (int)strtol(end + 1, &end, 10));
+      Assert::AreEqual(mesh.node_x[mesh.elmt_conn[0] - 1], strtod(end + 1, &end));
+      Assert::AreEqual(mesh.node_y[mesh.elmt_conn[0] - 1], strtod(end + 1, &end));
+      Assert::AreEqual(values[0], strtof(end + 1, &end));
+
+      // WKT: one row per element
+      char wktFullPath[_MAX_PATH];
+      snprintf(wktFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cexport.wkt.txt");
+      options.format = MeshExportWkt;
+      Assert::AreEqual((long)F_NO_ERROR, ExportMesh(wktFullPath, mesh, options));
+      std::string wkt = ReadFile(wktFullPath);
+      Assert::AreEqual(mesh.num_elmts + 1, CountLines(wkt));
+      Assert::IsTrue(wkt.find(";POLYGON ((") != std::string::npos);
+
+      // Binary: arrays read back exactly
+      char binFullPath[_MAX_PATH];
+      snprintf(binFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cexport.bin");
+      options.format = MeshExportBinary;
+      Assert::AreEqual((long)F_NO_ERROR, ExportMesh(binFullPath, mesh, options));
+      std::string bin = ReadFile(binFullPath, "rb");
+      const char* p = bin.data();
+      Assert::AreEqual(0, memcmp(p, "MESHBIN1", 8));
+      int32_t header[4];
+      memcpy(header, p + 8, sizeof(header));
+      Assert::AreEqual(mesh.num_nodes, (int)header[0]);
+      Assert::AreEqual(mesh.num_elmts, (int)header[1]);
+      Assert::AreEqual(mesh.num_conn, (int)header[2]);
+      Assert::AreEqual(1, (int)header[3]);
+      p += 8 + sizeof(header);
+      Assert::AreEqual(0, memcmp(p, mesh.node_x, mesh.num_nodes * sizeof(double)));
+      p += 2 * mesh.num_nodes * sizeof(double) + 2 * mesh.num_elmts * sizeof(int32_t);
+      int32_t conn0;
+      memcpy(&conn0, p, sizeof(conn0));
+      Assert::AreEqual(mesh.elmt_conn[0] - 1, (int)conn0);
+      Assert::AreEqual(bin.size(), 8 + sizeof(header) + 2 * mesh.num_nodes * sizeof(double) +
+                       (2 * mesh.num_elmts + mesh.num_conn) * sizeof(int32_t) + mesh.num_elmts * sizeof(float));
+
+      CleanupMeshGeometry(&mesh);
+    }
+
+    static std::string ReadFile(LPCTSTR filename, LPCTSTR mode = "r")
+    {
+      std::string content;
+      FILE* fp = fopen(filename, mode);
+      Assert::IsNotNull(fp);
+      char buf[65536];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        content.append(buf, n);
+      fclose(fp);
+      return content;
+    }
+
+    static int CountLines(const std::string& content)
+    {
+      int num_lines = 0;
+      for (size_t i = 0; i < content.size(); i++)
+        if (content[i] == '\n')
+          num_lines++;
+      return num_lines;
+    }
+
+  };
+}
@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "MeshMetrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+
+
+/**
+ * Metrics of element e, a polygon of n nodes. Coordinates are taken relative to the first
+ * node, for precision of the shoelace sums with large projected coordinates.
+ */
+static inline void PolygonMetrics(const double* x, const double* y, int n, int e, MeshMetrics* metrics)
+{
+  double area2 = 0, sx = 0, sy = 0;
+  double xmin = x[0], xmax = x[0], ymin = y[0], ymax = y[0];
+  for (int i = 0; i < n; i++)
+  {
+    int j = i + 1 < n ? i + 1 : 0;
+    double xi = x[i] - x[0], yi = y[i] - y[0];
+    double xj = x[j] - x[0], yj = y[j] - y[0];
+    double cross = xi * yj - xj * yi;
+    area2 += cross;
+    sx += (xi + xj) * cross;
+    sy += (yi + yj) * cross;
+    xmin = std::min(xmin, x[i]);
+    xmax = std::max(xmax, x[i]);
+    ymin = std::min(ymin, y[i]);
+    ymax = std::max(ymax, y[i]);
+  }
+  if (area2 != 0)
+  {
+    metrics->center_x[e] = x[0] + sx / (3 * area2);
+    metrics->center_y[e] = y[0] + sy / (3 * area2);
+  }
+  else
+  {
+    // Degenerate element, use node average
+    double mx = 0, my = 0;
+    for (int i = 0; i < n; i++)
+    {
+      mx += x[i];
+      my += y[i];
+    }
+    metrics->center_x[e] = mx / n;
+    metrics->center_y[e] = my / n;
+  }
+  metrics->area[e] = 0.5 * area2;
+  metrics->xmin[e] = xmin;
+  metrics->xmax[e] = xmax;
+  metrics->ymin[e] = ymin;
+  metrics->ymax[e] = ymax;
+}
+
+/**
+ * Metrics of element e with N horizontal nodes, N known at compile time for triangles and
+ * quadrilaterals. Elements of 3D meshes have N bottom nodes followed by N top nodes.
+ */
+template <int N, bool layered>
+static inline void ElementMetrics(const MeshGeometry& mesh, const int* conn, int e, MeshMetrics* metrics)
+{
+  double x[N], y[N];
+  for (int i = 0; i < N; i++)
+  {
+    // Connectivity is 1 based node numbers
+    x[i] = mesh.node_x[conn[i] - 1];
+    y[i] = mesh.node_y[conn[i] - 1];
+  }
+  PolygonMetrics(x, y, N, e, metrics);
+  if constexpr (layered)
+  {
+    double z_bottom = 0, z_top = 0;
+    for (int i = 0; i < N; i++)
+    {
+      z_bottom += mesh.node_z[conn[i] - 1];
+      z_top += mesh.node_z[conn[N + i] - 1];
+    }
+    metrics->layer_thickness[e] = (z_top - z_bottom) / N;
+  }
+}
+
+/** Metrics of element e of a type that is not known, all NaN */
+static void ElementMetricsUnknown(int e, MeshMetrics* metrics)
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  metrics->center_x[e] = nan;
+  metrics->center_y[e] = nan;
+  metrics->area[e] = nan;
+  metrics->xmin[e] = nan;
+  metrics->xmax[e] = nan;
+  metrics->ymin[e] = nan;
+  metrics->ymax[e] = nan;
+  if (!metrics->layer_thickness.empty())
+    metrics->layer_thickness[e] = nan;
+}
+
+int ComputeMeshMetrics(const MeshGeometry& mesh, MeshMetrics* metrics, int num_threads)
+{
+  if (num_threads < 1)
+    num_threads = (int)std::thread::hardware_concurrency();
+  if (num_threads > mesh.num_elmts)
+    num_threads = mesh.num_elmts;
+  if (num_threads < 1)
+    num_threads = 1;
+
+  size_t n = mesh.num_elmts;
+  metrics->center_x.resize(n);
+  metrics->center_y.resize(n);
+  metrics->area.resize(n);
+  metrics->xmin.resize(n);
+  metrics->xmax.resize(n);
+  metrics->ymin.resize(n);
+  metrics->ymax.resize(n);
+  metrics->layer_thickness.resize(mesh.dimension == 3 ? n : 0);
+
+  std::vector<int> conn_offsets(mesh.num_elmts + 1, 0);
+  for (int e = 0; e < mesh.num_elmts; e++)
+    conn_offsets[e + 1] = conn_offsets[e] + mesh.elmt_num_nodes[e];
+
+  // Each thread computes a contiguous range of elements
+  std::atomic<int> num_unknown(0);
+  auto compute = [&](int t)
+  {
+    int first = (int)((long long)mesh.num_elmts * t / num_threads);
+    int last = (int)((long long)mesh.num_elmts * (t + 1) / num_threads);
+    for (int e = first; e < last; e++)
+    {
+      const int* conn = &mesh.elmt_conn[conn_offsets[e]];
+      switch (mesh.elmt_types[e])
+      {
+      // Quadratic elements have the corner nodes first, followed by the mid-side nodes
+      case 21: // Triangle
+      case 22: // Quadratic triangle
+        ElementMetrics<3, false>(mesh, conn, e, metrics);
+        break;
+      case 24: // Quadratic quadrilateral
+      case 25: // Quadrilateral
+        ElementMetrics<4, false>(mesh, conn, e, metrics);
+        break;
+      case 32: // Triangular prism of 3D mesh
+        ElementMetrics<3, true>(mesh, conn, e, metrics);
+        break;
+      case 33: // Quadrilateral prism of 3D mesh
+        ElementMetrics<4, true>(mesh, conn, e, metrics);
+        break;
+      default:
+        ElementMetricsUnknown(e, metrics);
+        num_unknown++;
+        break;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++)
+    threads.emplace_back(compute, t);
+  for (std::thread& thread : threads)
+    thread.join();
+  return num_unknown;
+}
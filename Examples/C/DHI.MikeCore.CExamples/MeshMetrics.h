@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pch.h"
+#include "DfsuUtil.h"
+
+#include <vector>
+
+/**
+ * Geometric metrics of the elements of a mesh, computed once in one parallel pass over
+ * the elements, instead of from the node coordinates on every lookup.
+ *
+ * Metrics are stored as one array per metric (structure of arrays), indexed by zero
+ * based element index, such that kernels over all elements, e.g. area weighted statistics,
+ * read contiguous memory. Triangles and quadrilaterals, by elmt_types, are computed by
+ * code specialized for their number of nodes. Quadratic triangles and quadrilaterals use
+ * their corner nodes only. Elements of other types get NaN metrics.
+ *
+ * For 3D meshes, the horizontal metrics are those of the bottom face of each element,
+ * and the layer thickness is the difference in mean z of the top and bottom nodes.
+ */
+struct MeshMetrics
+{
+  std::vector<double> center_x;          ///< X coordinate of area centroid of each element
+  std::vector<double> center_y;          ///< Y coordinate of area centroid of each element
+  std::vector<double> area;              ///< Signed area, positive for counter clockwise nodes
+  std::vector<double> xmin, xmax;        ///< Bounding box of each element
+  std::vector<double> ymin, ymax;
+  std::vector<double> layer_thickness;   ///< Thickness of each element of 3D meshes, empty for 2D meshes
+};
+
+/**
+ * Compute metrics of all elements of mesh, using num_threads threads, 0 for one per
+ * hardware thread. Returns the number of elements of a type that is not known, their
+ * metrics being NaN.
+ */
+int ComputeMeshMetrics(const MeshGeometry& mesh, MeshMetrics* metrics, int num_threads = 0);
@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsuUtil.h"
+#include "MeshMetrics.h"
+#include <CppUnitTest.h>
+
+#include <math.h>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(MeshMetrics_tests)
+  {
+  public:
+
+    /// Triangle and quadrilateral with known centroids and areas
+    TEST_METHOD(MeshMetricsSmallTest)
+    {
+      double node_x[] = { 0, 2, 0, 4, 4 };
+      double node_y[] = { 0, 0, 2, 0, 1 };
+      int    elmt_types[] = { 21, 25 };
+      int    elmt_num_nodes[] = { 3, 4 };
+      int    elmt_conn[] = { 1, 2, 3,  2, 4, 5, 3 };
+      MeshGeometry mesh;
+      mesh.num_nodes = 5;
+      mesh.num_elmts = 2;
+      mesh.dimension = 2;
+      mesh.num_conn = 7;
+      mesh.node_x = node_x;
+      mesh.node_y = node_y;
+      mesh.elmt_types = elmt_types;
+      mesh.elmt_num_nodes = elmt_num_nodes;
+      mesh.elmt_conn = elmt_conn;
+
+      MeshMetrics metrics;
+      ComputeMeshMetrics(mesh, &metrics, 2);
+      Assert::AreEqual(2.0, metrics.area[0]);
+      Assert::AreEqual(2.0 / 3, metrics.center_x[0], 1e-12);
+      Assert::AreEqual(2.0 / 3, metrics.center_y[0], 1e-12);
+
+      // Quadrilateral (2,0) (4,0) (4,1) (0,2): Area 4, centroid from the shoelace sums
+      Assert::AreEqual(4.0, metrics.area[1], 1e-12);
+      Assert::AreEqual(7.0 / 3, metrics.center_x[1], 1e-12);
+      Assert::AreEqual(5.0 / 6, metrics.center_y[1], 1e-12);
+      Assert::AreEqual(0.0, metrics.xmin[1]);
+      Assert::AreEqual(4.0, metrics.xmax[1]);
+      Assert::AreEqual(0.0, metrics.ymin[1]);
+      Assert::AreEqual(2.0, metrics.ymax[1]);
+      Assert::IsTrue(metrics.layer_thickness.empty());
+    }
+
+    /// Quadratic elements use their corner nodes, elements of unknown types get NaN metrics
+    TEST_METHOD(MeshMetricsQuadraticTest)
+    {
+      // Quadratic triangle (0,0) (2,0) (0,2) with mid-side nodes, and an unknown element type
+      double node_x[] = { 0, 2, 0, 1, 1, 0 };
+      double node_y[] = { 0, 0, 2, 0, 1, 1 };
+      int    elmt_types[] = { 22, 99 };
+      int    elmt_num_nodes[] = { 6, 3 };
+      int    elmt_conn[] = { 1, 2, 3, 4, 5, 6,  1, 2, 3 };
+      MeshGeometry mesh;
+      mesh.num_nodes = 6;
+      mesh.num_elmts = 2;
+      mesh.dimension = 2;
+      mesh.num_conn = 9;
+      mesh.node_x = node_x;
+      mesh.node_y = node_y;
+      mesh.elmt_types = elmt_types;
+      mesh.elmt_num_nodes = elmt_num_nodes;
+      mesh.elmt_conn = elmt_conn;
+
+      MeshMetrics metrics;
+      Assert::AreEqual(1, ComputeMeshMetrics(mesh, &metrics, 1));
+      Assert::AreEqual(2.0, metrics.area[0]);
+      Assert::AreEqual(2.0 / 3, metrics.center_x[0], 1e-12);
+      Assert::AreEqual(2.0 / 3, metrics.center_y[0], 1e-12);
+      Assert::IsTrue(isnan(metrics.area[1]));
+      Assert::IsTrue(isnan(metrics.center_x[1]));
+    }
+
+    /// Metrics of OresundHD.dfsu are the same for any number of threads, centroids inside bounding boxes
+    TEST_METHOD(MeshMetricsDfsuTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      MeshGeometry mesh;
+      ReadDfsuGeometry(pdfs, fp, &mesh);
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+
+      MeshMetrics metrics1, metrics4;
+      ComputeMeshMetrics(mesh, &metrics1, 1);
+      ComputeMeshMetrics(mesh, &metrics4, 4);
+      Assert::IsTrue(metrics1.area == metrics4.area);
+      Assert::IsTrue(metrics1.center_x == metrics4.center_x);
+      for (int e = 0; e < mesh.num_elmts; e++)
+      {
+        Assert::IsTrue(metrics1.area[e] > 0);
+        Assert::IsTrue(metrics1.xmin[e] <= metrics1.center_x[e] && metrics1.center_x[e] <= metrics1.xmax[e]);
+        Assert::IsTrue(metrics1.ymin[e] <= metrics1.center_y[e] && metrics1.center_y[e] <= metrics1.ymax[e]);
+      }
+      CleanupMeshGeometry(&mesh);
+    }
+
+  };
+}
@@ -0,0 +1,306 @@
+#include "pch.h"
+#include "eum.h"
+#include <dfsio.h>
+#include "Util.h"
+#include "DfsTyped.h"
+#include "MeshAdjacency.h"
+#include "MeshRenumber.h"
+
+#include <CppUnitTestLogger.h>
+#include <algorithm>
+#include <math.h>
+#include <numeric>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/** Index of the first node of each element in elmt_conn, and the total size last */
+static std::vector<int> ElementConnOffsets(const MeshGeometry& mesh)
+{
+  std::vector<int> offsets(mesh.num_elmts + 1, 0);
+  for (int i_elmt = 0; i_elmt < mesh.num_elmts; i_elmt++)
+    offsets[i_elmt + 1] = offsets[i_elmt] + mesh.elmt_num_nodes[i_elmt];
+  return offsets;
+}
+
+/**
+ * Breadth first search from start, appending the elements reached to order. The
+ * unvisited neighbours of an element are appended by increasing degree.
+ */
+static void CuthillMcKee(int start, const std::vector<int>& xadj, const std::vector<int>& adj,
+                         std::vector<char>* visited, std::vector<int>* order)
+{
+  auto degree = [&](int e) { return xadj[e + 1] - xadj[e]; };
+  size_t head = order->size();
+  order->push_back(start);
+  (*visited)[start] = 1;
+  std::vector<int> nbrs;
+  while (head < order->size())
+  {
+    int e = (*order)[head++];
+    nbrs.clear();
+    for (int k = xadj[e]; k < xadj[e + 1]; k++)
+    {
+      if (!(*visited)[adj[k]])
+      {
+        (*visited)[adj[k]] = 1;
+        nbrs.push_back(adj[k]);
+      }
+    }
+    std::sort(nbrs.begin(), nbrs.end(), [&](int a, int b) { return degree(a) < degree(b) || (degree(a) == degree(b) && a < b); });
+    order->insert(order->end(), nbrs.begin(), nbrs.end());
+  }
+}
+
+/** Reverse Cuthill-McKee order of the elements, each connected part of the mesh after the other */
+static void RcmElementOrder(const MeshGeometry& mesh, std::vector<int>* order)
+{
+  MeshAdjacency adjacency;
+  BuildMeshAdjacency(mesh, &adjacency);
+  const std::vector<int>& xadj = adjacency.nbr_offsets;
+  const std::vector<int>& adj = adjacency.nbrs;
+
+  std::vector<int> by_degree(mesh.num_elmts);
+  std::iota(by_degree.begin(), by_degree.end(), 0);
+  std::stable_sort(by_degree.begin(), by_degree.end(), [&](int a, int b) { return xadj[a + 1] - xadj[a] < xadj[b + 1] - xadj[b]; });
+
+  std::vector<char> visited(mesh.num_elmts, 0);
+  order->clear();
+  order->reserve(mesh.num_elmts);
+  for (int root : by_degree)
+  {
+    if (visited[root])
+      continue;
+    // Start from a pseudo peripheral element: The last element reached from root
+    size_t first = order->size();
+    CuthillMcKee(root, xadj, adj, &visited, order);
+    int start = order->back();
+    for (size_t i = first; i < order->size(); i++)
+      visited[(*order)[i]] = 0;
+    order->resize(first);
+    CuthillMcKee(start, xadj, adj, &visited, order);
+  }
+  std::reverse(order->begin(), order->end());
+}
+
+/** Index of (x,y) along a Hilbert curve filling a 65536 x 65536 grid */
+static uint64_t HilbertIndex(uint32_t x, uint32_t y)
+{
+  const uint32_t n = 1u << 16;
+  uint64_t d = 0;
+  for (uint32_t s = n / 2; s > 0; s /= 2)
+  {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += (uint64_t)s * s * ((3 * rx) ^ ry);
+    // Rotate the quadrant, such that the curve is continuous
+    if (ry == 0)
+    {
+      if (rx == 1)
+      {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+/** Order of the elements along a Hilbert curve through the element centers */
+static void HilbertElementOrder(const MeshGeometry& mesh, std::vector<int>* order)
+{
+  std::vector<double> xc(mesh.num_elmts), yc(mesh.num_elmts);
+  double xmin = INFINITY, xmax = -INFINITY, ymin = INFINITY, ymax = -INFINITY;
+  const int* conn = mesh.elmt_conn;
+  for (int i_elmt = 0; i_elmt < mesh.num_elmts; i_elmt++)
+  {
+    int num_nodes = mesh.elmt_num_nodes[i_elmt];
+    double x = 0, y = 0;
+    for (int j = 0; j < num_nodes; j++)
+    {
+      x += mesh.node_x[conn[j] - 1];
+      y += mesh.node_y[conn[j] - 1];
+    }
+    xc[i_elmt] = x / num_nodes;
+    yc[i_elmt] = y / num_nodes;
+    xmin = std::min(xmin, xc[i_elmt]);
+    xmax = std::max(xmax, xc[i_elmt]);
+    ymin = std::min(ymin, yc[i_elmt]);
+    ymax = std::max(ymax, yc[i_elmt]);
+    conn += num_nodes;
+  }
+
+  // Same scale in x and y, such that the curve is not distorted
+  double scale = std::max(xmax - xmin, ymax - ymin);
+  scale = scale > 0 ? 65535.0 / scale : 0;
+  std::vector<std::pair<uint64_t, int>> keys(mesh.num_elmts);
+  for (int i_elmt = 0; i_elmt < mesh.num_elmts; i_elmt++)
+  {
+    uint32_t x = (uint32_t)((xc[i_elmt] - xmin) * scale);
+    uint32_t y = (uint32_t)((yc[i_elmt] - ymin) * scale);
+    keys[i_elmt] = std::make_pair(HilbertIndex(x, y), i_elmt);
+  }
+  std::sort(keys.begin(), keys.end());
+  order->resize(mesh.num_elmts);
+  for (int i = 0; i < mesh.num_elmts; i++)
+    (*order)[i] = keys[i].second;
+}
+
+void GetMeshRenumbering(const MeshGeometry& mesh, MeshRenumberMethod method, MeshPermutation* perm)
+{
+  if (method == MeshRenumberHilbert)
+    HilbertElementOrder(mesh, &perm->elmt_order);
+  else
+    RcmElementOrder(mesh, &perm->elmt_order);
+
+  // Nodes in the order they are first referenced by the renumbered elements
+  std::vector<int> offsets = ElementConnOffsets(mesh);
+  perm->node_new.assign(mesh.num_nodes, -1);
+  perm->node_order.clear();
+  perm->node_order.reserve(mesh.num_nodes);
+  for (int i_old : perm->elmt_order)
+  {
+    for (int k = offsets[i_old]; k < offsets[i_old + 1]; k++)
+    {
+      int node = mesh.elmt_conn[k] - 1;
+      if (perm->node_new[node] < 0)
+      {
+        perm->node_new[node] = (int)perm->node_order.size();
+        perm->node_order.push_back(node);
+      }
+    }
+  }
+  for (int node = 0; node < mesh.num_nodes; node++)
+  {
+    if (perm->node_new[node] < 0)
+    {
+      perm->node_new[node] = (int)perm->node_order.size();
+      perm->node_order.push_back(node);
+    }
+  }
+}
+
+void RenumberMeshGeometry(const MeshGeometry& mesh, const MeshPermutation& perm, MeshGeometry* renumbered)
+{
+  renumbered->num_nodes        = mesh.num_nodes;
+  renumbered->num_elmts        = mesh.num_elmts;
+  renumbered->dimension        = mesh.dimension;
+  renumbered->max_num_layers   = mesh.max_num_layers;
+  renumbered->num_sigma_layers = mesh.num_sigma_layers;
+  renumbered->num_conn         = mesh.num_conn;
+
+  // Arrays are malloc'ed like those of ReadDfsuGeometry, for CleanupMeshGeometry
+  renumbered->node_ids       = (int*)   malloc(mesh.num_nodes * sizeof(int));
+  renumbered->node_x         = (double*)malloc(mesh.num_nodes * sizeof(double));
+  renumbered->node_y         = (double*)malloc(mesh.num_nodes * sizeof(double));
+  renumbered->node_z         = (float*) malloc(mesh.num_nodes * sizeof(float));
+  renumbered->node_codes     = (int*)   malloc(mesh.num_nodes * sizeof(int));
+  renumbered->elmt_ids       = (int*)   malloc(mesh.num_elmts * sizeof(int));
+  renumbered->elmt_types     = (int*)   malloc(mesh.num_elmts * sizeof(int));
+  renumbered->elmt_num_nodes = (int*)   malloc(mesh.num_elmts * sizeof(int));
+  renumbered->elmt_conn      = (int*)   malloc(mesh.num_conn * sizeof(int));
+
+  PermuteMeshValues(perm.node_order, mesh.node_x, renumbered->node_x);
+  PermuteMeshValues(perm.node_order, mesh.node_y, renumbered->node_y);
+  PermuteMeshValues(perm.node_order, mesh.node_z, renumbered->node_z);
+  PermuteMeshValues(perm.node_order, mesh.node_codes, renumbered->node_codes);
+  PermuteMeshValues(perm.elmt_order, mesh.elmt_types, renumbered->elmt_types);
+  PermuteMeshValues(perm.elmt_order, mesh.elmt_num_nodes, renumbered->elmt_num_nodes);
+  for (int i = 0; i < mesh.num_nodes; i++)
+    renumbered->node_ids[i] = i + 1;
+  for (int i = 0; i < mesh.num_elmts; i++)
+    renumbered->elmt_ids[i] = i + 1;
+
+  // Connectivity of the elements in the new order, referring to the new node numbers
+  std::vector<int> offsets = ElementConnOffsets(mesh);
+  int k_new = 0;
+  for (int i_old : perm.elmt_order)
+  {
+    for (int k = offsets[i_old]; k < offsets[i_old + 1]; k++)
+      renumbered->elmt_conn[k_new++] = perm.node_new[mesh.elmt_conn[k] - 1] + 1;
+  }
+}
+
+int MeshBandwidth(const MeshGeometry& mesh)
+{
+  int bandwidth = 0;
+  const int* conn = mesh.elmt_conn;
+  for (int i_elmt = 0; i_elmt < mesh.num_elmts; i_elmt++)
+  {
+    int num_nodes = mesh.elmt_num_nodes[i_elmt];
+    auto minmax = std::minmax_element(conn, conn + num_nodes);
+    bandwidth = std::max(bandwidth, *minmax.second - *minmax.first);
+    conn += num_nodes;
+  }
+  return bandwidth;
+}
+
+long RenumberDfsuFile(LPCTSTR inputFilename, LPCTSTR outputFilename, MeshRenumberMethod method)
+{
+  LPHEAD pdfsIn, pdfsWr;
+  LPFILE fpIn, fpWr;
+  long rc = dfsFileRead(inputFilename, &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening file");
+  if (dfsGetDataType(pdfsIn) != 2001 || !IsDfsu2D(pdfsIn))
+  {
+    LOG("Not a 2D dfsu file: %s", inputFilename);
+    rc = dfsFileClose(pdfsIn, &fpIn);
+    rc = dfsHeaderDestroy(&pdfsIn);
+    return -1;
+  }
+
+  MeshGeometry mesh;
+  ReadDfsuGeometry(pdfsIn, fpIn, &mesh);
+  MeshPermutation perm;
+  GetMeshRenumbering(mesh, method, &perm);
+  MeshGeometry renumbered;
+  RenumberMeshGeometry(mesh, perm, &renumbered);
+
+  // Header, custom blocks and item info as the input, the mesh being written renumbered
+  long num_items = dfsGetNoOfItems(pdfsIn);
+  long num_timesteps = CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+  rc = dfsFileCreate(outputFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating file");
+  WriteDfsuGeometryStatic(pdfsWr, fpWr, &renumbered);
+
+  // Element items are permuted by the element order, node items by the node order
+  std::vector<const std::vector<int>*> item_orders(num_items, nullptr);
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    long num_elmts = dfsGetItemElements(dfsItemD(pdfsIn, i_item));
+    if (num_elmts == mesh.num_elmts)
+      item_orders[i_item - 1] = &perm.elmt_order;
+    else if (num_elmts == mesh.num_nodes)
+      item_orders[i_item - 1] = &perm.node_order;
+  }
+
+  if (num_timesteps > 0)
+  {
+    rc = dfsFindTimeStep(pdfsIn, fpIn, 0);
+    CheckRc(rc, "Error finding time step");
+  }
+  std::vector<double> scratch;
+  CopyDfsTemporalDataTyped(pdfsIn, fpIn, pdfsWr, fpWr, num_timesteps, num_items, [&](int i_item, auto values)
+  {
+    using T = typename decltype(values)::element_type;
+    const std::vector<int>* order = item_orders[i_item - 1];
+    if (!order)
+      return;
+    // Values in the old order, double for alignment of any item type
+    scratch.resize((values.size_bytes() + sizeof(double) - 1) / sizeof(double));
+    memcpy(scratch.data(), values.data(), values.size_bytes());
+    PermuteMeshValues(*order, (const T*)scratch.data(), values.data());
+  });
+
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  rc = dfsFileClose(pdfsIn, &fpIn);
+  rc = dfsHeaderDestroy(&pdfsIn);
+  CleanupMeshGeometry(&renumbered);
+  CleanupMeshGeometry(&mesh);
+  return F_NO_ERROR;
+}
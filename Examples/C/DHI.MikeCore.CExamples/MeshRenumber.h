@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pch.h"
+#include "DfsuUtil.h"
+
+#include <vector>
+
+/**
+ * Renumbering of the elements and nodes of a 2D mesh, for locality of memory access.
+ *
+ * Elements and nodes are stored in the order the mesh generator emitted them, and
+ * neighbouring elements can be far apart in memory. Renumbering places neighbours
+ * close together, such that kernels visiting an element and its neighbours, e.g.
+ * interpolation and gradients, access memory that is already in cache.
+ *
+ * Elements are ordered by one of the methods below. Nodes are then numbered in the
+ * order they are first referenced by the renumbered elements, nodes not referenced by
+ * any element being last.
+ */
+
+/** Element ordering methods of GetMeshRenumbering */
+enum MeshRenumberMethod
+{
+  MeshRenumberRcm,      ///< Reverse Cuthill-McKee over elements sharing a face, minimizing the bandwidth
+  MeshRenumberHilbert,  ///< Hilbert curve index of the element centers
+};
+
+/** Permutation of elements and nodes, all zero based indices */
+struct MeshPermutation
+{
+  std::vector<int> elmt_order;   ///< elmt_order[new] is the old index of element new
+  std::vector<int> node_order;   ///< node_order[new] is the old index of node new
+  std::vector<int> node_new;     ///< node_new[old] is the new index of node old
+};
+
+/** Get the permutation of elements and nodes of mesh, by the method */
+void GetMeshRenumbering(const MeshGeometry& mesh, MeshRenumberMethod method, MeshPermutation* perm);
+
+/**
+ * Create renumbered, a copy of mesh with elements and nodes in the order of perm.
+ * Node and element ids are set to 1..n in the new order, and the connectivity refers
+ * to the new node numbers. The arrays of renumbered are released with CleanupMeshGeometry.
+ */
+void RenumberMeshGeometry(const MeshGeometry& mesh, const MeshPermutation& perm, MeshGeometry* renumbered);
+
+/** Bandwidth of the mesh: Largest difference between the numbers of two nodes of an element */
+int MeshBandwidth(const MeshGeometry& mesh);
+
+/** Reorder values of old elements or nodes into the new order: out[new] = in[order[new]] */
+template <typename T>
+void PermuteMeshValues(const std::vector<int>& order, const T* in, T* out)
+{
+  for (size_t i = 0; i < order.size(); i++)
+    out[i] = in[order[i]];
+}
+
+/**
+ * Renumber the mesh of 2D dfsu file inputFilename and write it to outputFilename.
+ * Dynamic items on elements (or nodes) are permuted accordingly. The header, time axis
+ * and item info are copied from the input.
+ * Returns F_NO_ERROR on success, or -1 on failure.
+ */
+long RenumberDfsuFile(LPCTSTR inputFilename, LPCTSTR outputFilename, MeshRenumberMethod method);
@@ -0,0 +1,122 @@
+#include "pch.h"
+#include "eum.h"
+#include "dfsio.h"
+#include "Util.h"
+#include "DfsuUtil.h"
+#include "MeshRenumber.h"
+#include <CppUnitTest.h>
+
+#include <algorithm>
+#include <vector>
+
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitestForC_MikeCore
+{
+  TEST_CLASS(MeshRenumber_tests)
+  {
+  public:
+
+    /// Both methods give permutations, and RCM reduces the bandwidth of OresundHD.dfsu
+    TEST_METHOD(MeshRenumberingTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+      MeshGeometry mesh;
+      ReadMesh(inputFullPath, &mesh, nullptr);
+
+      for (MeshRenumberMethod method : { MeshRenumberRcm, MeshRenumberHilbert })
+      {
+        MeshPermutation perm;
+        GetMeshRenumbering(mesh, method, &perm);
+        Assert::IsTrue(IsPermutation(perm.elmt_order, mesh.num_elmts));
+        Assert::IsTrue(IsPermutation(perm.node_order, mesh.num_nodes));
+        for (int i = 0; i < mesh.num_nodes; i++)
+          Assert::AreEqual(i, perm.node_new[perm.node_order[i]]);
+
+        MeshGeometry renumbered;
+        RenumberMeshGeometry(mesh, perm, &renumbered);
+        Assert::AreEqual(mesh.num_conn, renumbered.num_conn);
+        Assert::AreEqual(1, renumbered.elmt_ids[0]);
+        Assert::AreEqual(mesh.num_nodes, renumbered.node_ids[mesh.num_nodes - 1]);
+        if (method == MeshRenumberRcm)
+          Assert::IsTrue(MeshBandwidth(renumbered) < MeshBandwidth(mesh));
+        CleanupMeshGeometry(&renumbered);
+      }
+      CleanupMeshGeometry(&mesh);
+    }
+
+    /// Renumbered OresundHD.dfsu has the same element polygons and values, in the new order
+    TEST_METHOD(RenumberDfsuFileTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfsu");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_renumbered.dfsu");
+
+      Assert::AreEqual((long)F_NO_ERROR, RenumberDfsuFile(inputFullPath, outputFullPath, MeshRenumberRcm));
+
+      MeshGeometry mesh, renumbered;
+      std::vector<float> values, renumbered_values;
+      ReadMesh(inputFullPath, &mesh, &values);
+      ReadMesh(outputFullPath, &renumbered, &renumbered_values);
+      MeshPermutation perm;
+      GetMeshRenumbering(mesh, MeshRenumberRcm, &perm);
+
+      Assert::AreEqual(mesh.num_elmts, renumbered.num_elmts);
+      Assert::AreEqual(mesh.num_nodes, renumbered.num_nodes);
+      int k_new = 0;
+      for (int i_new = 0; i_new < mesh.num_elmts; i_new++)
+      {
+        int i_old = perm.elmt_order[i_new];
+        Assert::AreEqual(values[i_old], renumbered_values[i_new]);
+        Assert::AreEqual(mesh.elmt_types[i_old], renumbered.elmt_types[i_new]);
+        int k_old = 0;
+        for (int i = 0; i < i_old; i++)
+          k_old += mesh.elmt_num_nodes[i];
+        for (int j = 0; j < mesh.elmt_num_nodes[i_old]; j++)
+        {
+          int node_old = mesh.elmt_conn[k_old + j] - 1;
+          int node_new = renumbered.elmt_conn[k_new++] - 1;
+          Assert::AreEqual(mesh.node_x[node_old], renumbered.node_x[node_new]);
+          Assert::AreEqual(mesh.node_y[node_old], renumbered.node_y[node_new]);
+          Assert::AreEqual(mesh.node_codes[node_old], renumbered.node_codes[node_new]);
+        }
+      }
+      CleanupMeshGeometry(&renumbered);
+      CleanupMeshGeometry(&mesh);
+    }
+
+    /// Read mesh, and optionally values of item 1 at the first time step
+    static void ReadMesh(LPCTSTR filename, MeshGeometry* mesh, std::vector<float>* values)
+    {
+      LPHEAD pdfs;
+      LPFILE fp;
+      long rc = dfsFileRead(filename, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      ReadDfsuGeometry(pdfs, fp, mesh);
+      if (values)
+      {
+        values->resize(mesh->num_elmts);
+        double time;
+        rc = dfsFindItemDynamic(pdfs, fp, 0, 1);
+        CheckRc(rc, "Error finding item-timestep");
+        rc = dfsReadItemTimeStep(pdfs, fp, &time, values->data());
+        CheckRc(rc, "Error reading item-timestep");
+      }
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+    }
+
+    static bool IsPermutation(std::vector<int> order, int n)
+    {
+      std::sort(order.begin(), order.end());
+      for (int i = 0; i < n; i++)
+        if (i >= (int)order.size() || order[i] != i)
+          return false;
+      return (int)order.size() == n;
+    }
+
+  };
+}
@@ -3,8 +3,11 @@
 #include <dfsio.h>
 #include <CppUnitTestAssert.h>
 #include "Util.h"
+#include "DfsTyped.h"
 
 #include <CppUnitTestLogger.h>
+#include <math.h>
+#include <vector>
 
 
 void CheckRc(LONG rc, LPCTSTR errMsg)
@@ -164,6 +167,60 @@ void GetDfsTimeAxis(
   }
 }
 
+/** Number of seconds in an EUM time unit, as used by the time axis */
+double GetDfsTimeUnitSeconds(long neum_unit)
+{
+  switch (neum_unit)
+  {
+  case 1400: return 1;       // eumUsec
+  case 1401: return 60;      // eumUminute
+  case 1402: return 3600;    // eumUhour
+  case 1403: return 86400;   // eumUday
+  default:
+    LOG("Time unit not supported: %ld, assuming seconds", neum_unit);
+    return 1;
+  }
+}
+
+/** Convert a date "yyyy-MM-dd" and time "HH:mm:ss" to seconds since 1970-01-01 00:00:00 */
+double DfsDateTimeToSeconds(LPCTSTR date, LPCTSTR time)
+{
+  int year = 1970, month = 1, day = 1, hour = 0, minute = 0;
+  double second = 0;
+  sscanf(date, "%d-%d-%d", &year, &month, &day);
+  sscanf(time, "%d:%d:%lf", &hour, &minute, &second);
+  // Days since 1970-01-01 in the proleptic Gregorian calendar
+  int y = month <= 2 ? year - 1 : year;
+  int era = (y >= 0 ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  double days = (double)era * 146097 + doe - 719468;
+  return days * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+}
+
+/**
+ * Get start time and time step of the time axis in seconds.
+ * For calendar axes, the start time is the start date and time, in
+ * seconds since 1970-01-01, plus the tstart offset.
+ * For time axes, the start time is the tstart offset.
+ * For non-equidistant axes, the time step is zero.
+ */
+TimeAxisType GetDfsTimeAxisSeconds(LPHEAD pdfsIn, double* start_sec, double* tstep_sec, long* num_timesteps)
+{
+  TimeAxisType taxis_type;
+  LPCTSTR start_date, start_time;
+  double tstart = 0, tstep = 0, tspan = 0;
+  long neum_unit, index;
+  GetDfsTimeAxis(pdfsIn, &taxis_type, num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+  *start_sec = tstart * unit_sec;
+  if (taxis_type == F_CAL_EQ_AXIS || taxis_type == F_CAL_NEQ_AXIS)
+    *start_sec += DfsDateTimeToSeconds(start_date, start_time);
+  *tstep_sec = (taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS) ? tstep * unit_sec : 0;
+  return taxis_type;
+}
+
 /**
  * Set item info to dynamic item, adding dummy 0D or 1D axis.
  * Used by DFS0 and DFSU dynamic items.
@@ -186,6 +243,8 @@ void SetDfsDynamicItemInfo(LPHEAD pdfs, int i_item, LPCSTR item_name, int item_t
  * Read static item and return the content of the static item
  * The name and the sitemtype are validated.
  * Automatic conversion from float to double will be performed
+ * See DfsTyped.h for a typed version, converting between all types, that returns false
+ * on a name mismatch instead of exiting.
  */
 void* ReadDfsStaticItem(LPFILE fp, LPHEAD pdfs, LPCSTR name, SimpleType sitemtype, int* size)
 {
@@ -378,7 +437,8 @@ LONG CopyDfsTimeAxis(LPHEAD pdfsIn, LPHEAD pdfsWr)
   return num_timesteps;
 }
 
-void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, int num_items)
+/** Copy dynamic item info, source items being items[i_item-1], or i_item if items is null */
+static void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, int num_items, int item_offset, const int* items)
 {
   LONG rc;
 
@@ -392,11 +452,11 @@ void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, int num_items)
   for (int i_item = 1; i_item <= num_items; i_item++)
   {
     // Name, quantity type and unit, and datatype of sourc efile
-    LPITEM itemIn = dfsItemD(pdfsIn, i_item);
+    LPITEM itemIn = dfsItemD(pdfsIn, items ? items[i_item - 1] : i_item);
     rc = dfsGetItemInfo(itemIn, &item_type, &item_type_str, &item_name, &item_unit, &item_unit_str, &item_datatype);
     CheckRc(rc, "Error getting dynamic item info");
     // Copy to target file item
-    LPITEM itemWr = dfsItemD(pdfsWr, i_item);
+    LPITEM itemWr = dfsItemD(pdfsWr, i_item + item_offset);
     rc = dfsSetItemInfo(pdfsWr, itemWr, item_type, item_name, item_unit, item_datatype);
     CheckRc(rc, "Error setting dynamic item info");
 
@@ -464,6 +524,24 @@ void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, int num_items)
   }
 }
 
+/**
+ * Copy dynamic item info, items 1..num_items in source are copied to
+ * items (item_offset+1)..(item_offset+num_items) in target.
+ */
+void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, int num_items, int item_offset)
+{
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items, item_offset, nullptr);
+}
+
+/**
+ * Copy dynamic item info of selected items, item items[k] in source is copied to
+ * item k+1 in target, for k = 0..num_items-1.
+ */
+void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, const int* items, int num_items)
+{
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items, 0, items);
+}
+
 void CopyDfsCustomBlocks(LPHEAD pdfsIn, LPHEAD pdfsWr)
 {
   LPBLOCK customblock_ptr;
@@ -484,6 +562,30 @@ void CopyDfsCustomBlocks(LPHEAD pdfsIn, LPHEAD pdfsWr)
   }
 }
 
+bool GetDfsLandValue(LPHEAD pdfsIn, float* land_value)
+{
+  LPBLOCK customblock_ptr;
+  long rc = dfsGetCustomBlockRef(pdfsIn, &customblock_ptr);
+  CheckRc(rc, "Error reading custom block");
+  // Search for "M21_MISC" custom block containing float data, land value at index 3
+  while (customblock_ptr)
+  {
+    SimpleType csdata_type;
+    LPCTSTR name;
+    LONG size;
+    void* customblock_data_ptr;
+    rc = dfsGetCustomBlock(customblock_ptr, &csdata_type, &name,
+      &size, &customblock_data_ptr, &customblock_ptr);
+    CheckRc(rc, "Error reading custom block");
+    if (0 == strcmp(name, "M21_MISC") && csdata_type == UFS_FLOAT && size > 3)
+    {
+      *land_value = ((float*)customblock_data_ptr)[3];
+      return true;
+    }
+  }
+  return false;
+}
+
 
 void CopyDfsStaticItems(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr)
 {
@@ -586,6 +688,35 @@ void CopyDfsStaticItems(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr)
   }
 }
 
+/**
+ * Create a new header from a source header, copying header info, time axis,
+ * delete values, projection and custom blocks. Dynamic item info is not copied,
+ * use CopyDfsDynamicItemInfo for that.
+ * Returns the number of time steps in the source.
+ */
+long CreateDfsHeaderFromSource(LPHEAD pdfsIn, LPHEAD* pdfsWr, long num_items)
+{
+  CopyDfsHeader(pdfsIn, pdfsWr, num_items);
+  long num_timesteps = CopyDfsTimeAxis(pdfsIn, *pdfsWr);
+
+  DeleteValues delVals;
+  GetDfsDeleteVals(pdfsIn, &delVals);
+  SetDfsDeleteVals(*pdfsWr, delVals);
+
+  if (dfsGetGeoInfoType(pdfsIn) == F_UTM_PROJECTION)
+  {
+    LPCTSTR projection_id;
+    double lon0, lat0, orientation;
+    long rc = GetDfsGeoInfo(pdfsIn, &projection_id, &lon0, &lat0, &orientation);
+    CheckRc(rc, "Error reading projection");
+    rc = dfsSetGeoInfoUTMProj(*pdfsWr, projection_id, lon0, lat0, orientation);
+    CheckRc(rc, "Error setting projection");
+  }
+
+  CopyDfsCustomBlocks(pdfsIn, *pdfsWr);
+  return num_timesteps;
+}
+
 void CopyDfsTemporalData(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, void** item_timestep_dataf, long num_timesteps, long num_items)
 {
   long rc;
@@ -610,6 +741,237 @@ void CopyDfsTemporalData(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr,
   }
 }
 
+void CopyDfsTemporalData(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, long num_timesteps, long num_items)
+{
+  // Buffers of the data type of each item, copying data as it is
+  CopyDfsTemporalDataTyped(pdfsIn, fpIn, pdfsWr, fpWr, num_timesteps, num_items, [](int, auto) {});
+}
+
+
+/** Convert seconds since 1970-01-01 00:00:00 to date "yyyy-MM-dd" and time "HH:mm:ss", truncating fractional seconds */
+void DfsSecondsToDateTime(double seconds, char* date, char* time)
+{
+  long long secs = (long long)floor(seconds);
+  long long days = secs >= 0 ? secs / 86400 : -((-secs + 86399) / 86400);
+  long long sod = secs - days * 86400;
+  // Civil date from days since 1970-01-01, the inverse of DfsDateTimeToSeconds
+  long long z = days + 719468;
+  long long era = (z >= 0 ? z : z - 146096) / 146097;
+  long long doe = z - era * 146097;
+  long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long long mp = (5 * doy + 2) / 153;
+  int day = (int)(doy - (153 * mp + 2) / 5 + 1);
+  int month = (int)(mp < 10 ? mp + 3 : mp - 9);
+  int year = (int)(yoe + era * 400 + (month <= 2 ? 1 : 0));
+  snprintf(date, 11, "%04d-%02d-%02d", year, month, day);
+  snprintf(time, 9, "%02d:%02d:%02d", (int)(sod / 3600), (int)(sod / 60 % 60), (int)(sod % 60));
+}
+
+/** Number of time steps in window, for a file with num_timesteps time steps */
+long GetDfsTimeWindowCount(const DfsTimeWindow& window, long num_timesteps)
+{
+  long end = (window.end < 0 || window.end >= num_timesteps) ? num_timesteps - 1 : window.end;
+  if (window.start < 0 || window.stride < 1 || window.start > end)
+    return 0;
+  return (end - window.start) / window.stride + 1;
+}
+
+/**
+ * Time of time step, in seconds since 1970-01-01 for calendar axes. Equidistant axes are given
+ * by start_sec and tstep_sec, see GetDfsTimeAxisSeconds. Non-equidistant axes read the time of
+ * item 1, relative to the start date, date_sec, in time units of unit_sec seconds.
+ */
+static double GetDfsTimeStepSeconds(LPHEAD pdfsIn, LPFILE fpIn, TimeAxisType taxis_type, double start_sec, double tstep_sec,
+                                    double date_sec, double unit_sec, long tstep, std::vector<char>& buffer)
+{
+  if (taxis_type == F_TM_EQ_AXIS || taxis_type == F_CAL_EQ_AXIS)
+    return start_sec + tstep * tstep_sec;
+
+  double time;
+  long rc = dfsFindItemDynamic(pdfsIn, fpIn, tstep, 1);
+  CheckRc(rc, "Error finding item-timestep");
+  rc = dfsReadItemTimeStep(pdfsIn, fpIn, &time, buffer.data());
+  CheckRc(rc, "Error reading dynamic item data");
+  return date_sec + time * unit_sec;
+}
+
+/**
+ * Resolve a time window from date-times "yyyy-MM-dd HH:mm:ss": The first time step at or after
+ * start_datetime, to the last time step at or before end_datetime. nullptr means the start or the
+ * end of the file. For time axes, that are not calendar axes, the date-times are relative to 1970-01-01.
+ * Equidistant axes are resolved without reading, non-equidistant axes by a binary search
+ * reading only the time of item 1 of a few time steps. The reading moves the file position of
+ * fpIn into the dynamic data, so callers reading the file afterwards must position it first,
+ * e.g. with dfsFindBlockStatic or dfsFindItemDynamic.
+ * Returns false if no time step is within the window.
+ */
+bool GetDfsTimeWindow(LPHEAD pdfsIn, LPFILE fpIn, LPCTSTR start_datetime, LPCTSTR end_datetime, long stride, DfsTimeWindow* window)
+{
+  // Read the time axis once, for all time steps probed
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  TimeAxisType taxis_type = GetDfsTimeAxisSeconds(pdfsIn, &start_sec, &tstep_sec, &num_timesteps);
+  TimeAxisType t;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep, tspan;
+  long n, neum_unit, index;
+  GetDfsTimeAxis(pdfsIn, &t, &n, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+  double date_sec = taxis_type == F_CAL_NEQ_AXIS ? DfsDateTimeToSeconds(start_date, start_time) : 0;
+  std::vector<char> buffer(dfsGetNoOfItems(pdfsIn) > 0 ? dfsGetItemBytes(dfsItemD(pdfsIn, 1)) : 0);
+
+  double limits[2];
+  LPCTSTR datetimes[2] = { start_datetime, end_datetime };
+  for (int i = 0; i < 2; i++)
+  {
+    char date[32] = "1970-01-01", time[32] = "00:00:00";
+    if (datetimes[i])
+      sscanf(datetimes[i], "%31s %31s", date, time);
+    limits[i] = DfsDateTimeToSeconds(date, time);
+  }
+
+  // First time step with time >= start, and first time step with time > end
+  long bounds[2];
+  for (int i = 0; i < 2; i++)
+  {
+    long lo = 0, hi = num_timesteps;
+    if (!datetimes[i])
+      lo = hi = (i == 0) ? 0 : num_timesteps;
+    while (lo < hi)
+    {
+      long mid = lo + (hi - lo) / 2;
+      double sec = GetDfsTimeStepSeconds(pdfsIn, fpIn, taxis_type, start_sec, tstep_sec, date_sec, unit_sec, mid, buffer);
+      if (i == 0 ? sec < limits[0] : sec <= limits[1])
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    bounds[i] = lo;
+  }
+  window->start = bounds[0];
+  window->end = bounds[1] - 1;
+  window->stride = stride;
+  return GetDfsTimeWindowCount(*window, num_timesteps) > 0;
+}
+
+/**
+ * Set time axis of target for the time steps of the window in the source.
+ * Equidistant axes get the start of the window and the time step times the stride,
+ * calendar axes with the start date and time moved to the start of the window.
+ * Non-equidistant axes are copied as is, the times being written with each time step.
+ * Returns the number of time steps in the window.
+ */
+long CopyDfsTimeAxisWindow(LPHEAD pdfsIn, LPHEAD pdfsWr, const DfsTimeWindow& window)
+{
+  TimeAxisType taxis_type;
+  LPCTSTR start_date, start_time;
+  double tstart, tstep, tspan;
+  long num_timesteps, neum_unit, index;
+  GetDfsTimeAxis(pdfsIn, &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+  long rc;
+  switch (taxis_type)
+  {
+  case F_TM_EQ_AXIS:
+    rc = dfsSetEqTimeAxis(pdfsWr, neum_unit, tstart + window.start * tstep, tstep * window.stride, index);
+    CheckRc(rc, "Error setting time axis");
+    break;
+  case F_CAL_EQ_AXIS:
+  {
+    // Whole seconds in the start date and time, remainder as tstart offset
+    double unit_sec = GetDfsTimeUnitSeconds(neum_unit);
+    double start_sec = DfsDateTimeToSeconds(start_date, start_time) + (tstart + window.start * tstep) * unit_sec;
+    char date[11], time[9];
+    DfsSecondsToDateTime(start_sec, date, time);
+    double offset = (start_sec - floor(start_sec)) / unit_sec;
+    rc = dfsSetEqCalendarAxis(pdfsWr, date, time, neum_unit, offset, tstep * window.stride, 0);
+    CheckRc(rc, "Error setting time axis");
+    break;
+  }
+  default:
+    CopyDfsTimeAxis(pdfsIn, pdfsWr);
+    break;
+  }
+  return GetDfsTimeWindowCount(window, num_timesteps);
+}
+
+/**
+ * Copy the time steps of the window, seeking directly to each time step with dfsFindTimeStep,
+ * such that only the extracted time steps are read. The file pointer of the source may be anywhere.
+ * Returns the number of time steps copied.
+ */
+long CopyDfsTemporalDataWindow(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, void** item_timestep_data, long num_items, const DfsTimeWindow& window)
+{
+  double start_sec, tstep_sec;
+  long num_timesteps;
+  GetDfsTimeAxisSeconds(pdfsIn, &start_sec, &tstep_sec, &num_timesteps);
+  long count = GetDfsTimeWindowCount(window, num_timesteps);
+  long rc;
+  double time;
+  long next_tstep = -1;
+  for (long i = 0; i < count; i++)
+  {
+    long tstep = window.start + i * window.stride;
+    if (tstep != next_tstep)
+    {
+      rc = dfsFindTimeStep(pdfsIn, fpIn, tstep);
+      CheckRc(rc, "Error finding time step");
+    }
+    for (int i_item = 1; i_item <= num_items; i_item++)
+    {
+      rc = dfsReadItemTimeStep(pdfsIn, fpIn, &time, item_timestep_data[i_item - 1]);
+      CheckRc(rc, "Error reading dynamic item data");
+      rc = dfsWriteItemTimeStep(pdfsWr, fpWr, time, item_timestep_data[i_item - 1]);
+      CheckRc(rc, "Error writing dynamic item data");
+    }
+    next_tstep = tstep + 1;
+  }
+  return count;
+}
+
+/**
+ * Create a new file with the time steps of the window of the input file,
+ * copying header, items and static items, and with the time axis adjusted to the window.
+ * Returns F_NO_ERROR on success, or -1 if the window contains no time steps.
+ */
+long CopyDfsFileTimeWindow(LPCTSTR inputFilename, LPCTSTR outputFilename, const DfsTimeWindow& window)
+{
+  LPHEAD pdfsIn, pdfsWr;
+  LPFILE fpIn, fpWr;
+  long rc = dfsFileRead(inputFilename, &pdfsIn, &fpIn);
+  CheckRc(rc, "Error opening file");
+  long num_items = dfsGetNoOfItems(pdfsIn);
+  CreateDfsHeaderFromSource(pdfsIn, &pdfsWr, num_items);
+  long count = CopyDfsTimeAxisWindow(pdfsIn, pdfsWr, window);
+  if (count == 0)
+  {
+    LOG("No time steps in window %ld-%ld of file: %s", window.start, window.end, inputFilename);
+    rc = dfsHeaderDestroy(&pdfsWr);
+    rc = dfsFileClose(pdfsIn, &fpIn);
+    rc = dfsHeaderDestroy(&pdfsIn);
+    return -1;
+  }
+  CopyDfsDynamicItemInfo(pdfsIn, pdfsWr, num_items);
+  rc = dfsFileCreate(outputFilename, pdfsWr, &fpWr);
+  CheckRc(rc, "Error creating file");
+  CopyDfsStaticItems(pdfsIn, fpIn, pdfsWr, fpWr);
+
+  std::vector<std::vector<char>> buffers(num_items);
+  std::vector<void*> item_timestep_data(num_items);
+  for (int i_item = 1; i_item <= num_items; i_item++)
+  {
+    buffers[i_item - 1].resize(dfsGetItemBytes(dfsItemD(pdfsIn, i_item)));
+    item_timestep_data[i_item - 1] = buffers[i_item - 1].data();
+  }
+  CopyDfsTemporalDataWindow(pdfsIn, fpIn, pdfsWr, fpWr, item_timestep_data.data(), num_items, window);
+
+  rc = dfsFileClose(pdfsWr, &fpWr);
+  CheckRc(rc, "Error closing file");
+  rc = dfsHeaderDestroy(&pdfsWr);
+  rc = dfsFileClose(pdfsIn, &fpIn);
+  rc = dfsHeaderDestroy(&pdfsIn);
+  return F_NO_ERROR;
+}
 
 bool TestDataPathValueSet = false;
 char TestDataPathValue[_MAX_DIR];
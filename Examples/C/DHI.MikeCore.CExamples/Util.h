@@ -21,12 +21,19 @@ void GetDfsTimeAxis(LPHEAD pdfsIn, TimeAxisType* taxis_type, long* num_timesteps
                     double* tstart, double* tstep, double* tspan,
                     long* neum_unit, long* index);
 
+double GetDfsTimeUnitSeconds(long neum_unit);
+double DfsDateTimeToSeconds(LPCTSTR date, LPCTSTR time);
+TimeAxisType GetDfsTimeAxisSeconds(LPHEAD pdfsIn, double* start_sec, double* tstep_sec, long* num_timesteps);
+
 void  SetDfsDynamicItemInfo(LPHEAD pdfs, int i_item, LPCSTR item_name, int item_type, int item_unit, SimpleType item_datatype, int size);
 
 void* ReadDfsStaticItem(LPFILE fp, LPHEAD pdfs, LPCSTR name, SimpleType sitemtype, int* size = NULL);
 void  WriteDfsStaticItem(LPFILE fp, LPHEAD pdfs, LPCSTR name, SimpleType sitemtype, int size, void* data);
 int   GetNbOfStaticItems(LPHEAD pdfsIn, LPFILE fp);
 
+/** Land value of a MIKE 21 dfs2 file, from the "M21_MISC" custom block. False if the file has none */
+bool  GetDfsLandValue(LPHEAD pdfsIn, float* land_value);
+
 
 struct DeleteValues
 {
@@ -46,15 +53,29 @@ void SetDfsDeleteVals(LPHEAD pdfsWr, DeleteValues DelVals);
 
 void CopyDfsHeader(LPHEAD pdfsIn, LPHEAD* pdfsWr, long num_items);
 long CopyDfsTimeAxis(LPHEAD pdfsIn, LPHEAD pdfsWr);
-void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, int num_items);
+void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, int num_items, int item_offset = 0);
+void CopyDfsDynamicItemInfo(LPHEAD pdfsIn, LPHEAD pdfsWr, const int* items, int num_items);
 void CopyDfsCustomBlocks(LPHEAD pdfsIn, LPHEAD pdfsWr);
 void CopyDfsStaticItems(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr);
+long CreateDfsHeaderFromSource(LPHEAD pdfsIn, LPHEAD* pdfsWr, long num_items);
 void CopyDfsTemporalData(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, void** item_timestep_dataf, long num_timesteps, long num_items);
-inline void CopyDfsTemporalData(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, float** item_timestep_dataf, long num_timesteps, long num_items)
+/** Copy dynamic item data, with buffers of the data type of each item */
+void CopyDfsTemporalData(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, long num_timesteps, long num_items);
+
+/** Time steps of a time window: start, start + stride, ..., up to and including end */
+struct DfsTimeWindow
 {
-  void** item_timestep_data = (void**)item_timestep_dataf;
-  CopyDfsTemporalData(pdfsIn, fpIn, pdfsWr, fpWr, item_timestep_data, num_timesteps, num_items);
-}
+  long start  = 0;    ///< First time step, zero based
+  long end    = -1;   ///< Last time step, included. -1 for the last time step of the file
+  long stride = 1;    ///< Number of time steps between extracted time steps
+};
+
+void  DfsSecondsToDateTime(double seconds, char* date, char* time);
+long  GetDfsTimeWindowCount(const DfsTimeWindow& window, long num_timesteps);
+bool  GetDfsTimeWindow(LPHEAD pdfsIn, LPFILE fpIn, LPCTSTR start_datetime, LPCTSTR end_datetime, long stride, DfsTimeWindow* window);
+long  CopyDfsTimeAxisWindow(LPHEAD pdfsIn, LPHEAD pdfsWr, const DfsTimeWindow& window);
+long  CopyDfsTemporalDataWindow(LPHEAD pdfsIn, LPFILE fpIn, LPHEAD pdfsWr, LPFILE fpWr, void** item_timestep_data, long num_items, const DfsTimeWindow& window);
+long  CopyDfsFileTimeWindow(LPCTSTR inputFilename, LPCTSTR outputFilename, const DfsTimeWindow& window);
 
 
 /** LOG method, redirecting message to log files */
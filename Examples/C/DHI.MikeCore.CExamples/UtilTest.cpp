@@ -5,6 +5,8 @@
 #include "Util.h"
 #include <CppUnitTest.h>
 
+#include <vector>
+
 /******************************************
  * Example of how to generally read data from a dfs file,
  * especially dfs0, dfs1 and dfs2 files.
@@ -69,5 +71,55 @@ namespace UnitestForC_MikeCore
       rc = dfsHeaderDestroy(&pdfs);
     }
 
+
+    /// Extract every second day from 1993-12-04 to 1993-12-10 12:00 of OresundHD.dfs2
+    TEST_METHOD(CopyDfsFileTimeWindowTest)
+    {
+      char inputFullPath[_MAX_PATH];
+      snprintf(inputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "OresundHD.dfs2");
+      char outputFullPath[_MAX_PATH];
+      snprintf(outputFullPath, _MAX_PATH, "%s%s", TestDataPath(), "test_OresundHD_Cwindow.dfs2");
+      LPFILE      fp;
+      LPHEAD      pdfs;
+      long rc = dfsFileRead(inputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+
+      DfsTimeWindow window;
+      Assert::IsTrue(GetDfsTimeWindow(pdfs, fp, "1993-12-04 00:00:00", "1993-12-10 12:00:00", 2, &window));
+      Assert::AreEqual(2L, window.start);
+      Assert::AreEqual(8L, window.end);
+      Assert::AreEqual(4L, GetDfsTimeWindowCount(window, 13));
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+
+      rc = CopyDfsFileTimeWindow(inputFullPath, outputFullPath, window);
+      Assert::AreEqual((long)F_NO_ERROR, rc);
+
+      rc = dfsFileRead(outputFullPath, &pdfs, &fp);
+      CheckRc(rc, "Error opening file");
+      TimeAxisType taxis_type;
+      long num_timesteps, neum_unit, index;
+      LPCTSTR start_date, start_time;
+      double tstart, tstep, tspan;
+      GetDfsTimeAxis(pdfs, &taxis_type, &num_timesteps, &start_date, &start_time, &tstart, &tstep, &tspan, &neum_unit, &index);
+      Assert::AreEqual((int)F_CAL_EQ_AXIS, (int)taxis_type);
+      Assert::AreEqual(4L, num_timesteps);
+      Assert::AreEqual("1993-12-04", start_date);
+      Assert::AreEqual("00:00:00", start_time);
+      Assert::AreEqual(2 * 86400.0, tstep);
+
+      // First time step is time step 2 of the input, see ReadDfs2Test
+      std::vector<float> data(dfsGetItemElements(dfsItemD(pdfs, 1)));
+      double time;
+      rc = dfsReadItemTimeStep(pdfs, fp, &time, data.data());
+      CheckRc(rc, "Error reading item-timestep");
+      Assert::AreEqual(11.3634329f, data[71 * 4 + 3]);
+      rc = dfsFileClose(pdfs, &fp);
+      rc = dfsHeaderDestroy(&pdfs);
+
+      // Empty window
+      window.start = 20;
+      Assert::AreEqual(0L, GetDfsTimeWindowCount(window, 13));
+    }
   };
 }
\ No newline at end of file